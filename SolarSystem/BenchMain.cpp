@@ -0,0 +1,115 @@
+#include "GeometryBenchmarks.h"
+#include "RenderBenchmarks.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Headless benchmarks of the renderer, no window or device: the mesh loading and processing and the CPU side
+// of the scene and draw submission.
+//   SolarSystemBench [--obj-benchmark] [--geosphere-benchmark] [--lod-test] [--packing-test] [--cluster-cull-benchmark]
+//                    [--scene-benchmark] [--render-queue-benchmark] [--state-cache-benchmark] [--instancing-benchmark]
+// Runs the benchmarks given, or all of them without options, and exits with 1 when the check of any of them fails.
+// The lap simulation and the collision benchmarks are in SolarSystemSim.
+
+namespace
+{
+    // the meshes of the game
+    const char* const meshDirectory = "assets/mesh";
+
+    bool ObjLoading()
+    {
+        return mc::GeometryBenchmarks::ObjLoading(meshDirectory);
+    }
+
+    bool LodChain()
+    {
+        return mc::GeometryBenchmarks::LodChain(meshDirectory);
+    }
+
+    bool VertexPacking()
+    {
+        return mc::GeometryBenchmarks::VertexPacking(meshDirectory);
+    }
+
+    bool ClusterCulling()
+    {
+        return mc::GeometryBenchmarks::ClusterCulling(meshDirectory);
+    }
+
+    struct Benchmark
+    {
+        const char* option;
+        // false when the check of the benchmark failed
+        bool (*run)();
+    };
+
+    const Benchmark benchmarks[] = {
+        { "--obj-benchmark", ObjLoading },
+        { "--geosphere-benchmark", mc::GeometryBenchmarks::GeosphereSubdivision },
+        { "--lod-test", LodChain },
+        { "--packing-test", VertexPacking },
+        { "--cluster-cull-benchmark", ClusterCulling },
+        { "--scene-benchmark", mc::RenderBenchmarks::SceneHierarchy },
+        { "--render-queue-benchmark", mc::RenderBenchmarks::RenderQueueSort },
+        { "--state-cache-benchmark", mc::RenderBenchmarks::StateCache },
+        { "--instancing-benchmark", mc::RenderBenchmarks::Instancing }
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        std::vector<const Benchmark*> selected;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string option(argv[i]);
+            const Benchmark* found = nullptr;
+            for (const Benchmark& benchmark : benchmarks)
+            {
+                if (option == benchmark.option)
+                {
+                    found = &benchmark;
+                }
+            }
+            if (!found)
+            {
+                throw std::runtime_error("Error unknown option: " + option);
+            }
+            selected.push_back(found);
+        }
+        if (selected.empty())
+        {
+            for (const Benchmark& benchmark : benchmarks)
+            {
+                selected.push_back(&benchmark);
+            }
+        }
+
+        std::vector<const char*> failed;
+        for (const Benchmark* benchmark : selected)
+        {
+            std::cout << benchmark->option + 2 << ":\n";
+            if (!benchmark->run())
+            {
+                failed.push_back(benchmark->option + 2);
+            }
+        }
+        for (const char* name : failed)
+        {
+            std::cout << "FAILED " << name << "\n";
+        }
+        if (!failed.empty())
+        {
+            return 1;
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -1,5 +1,9 @@
 #include "Camera.h"
 #include "Ship.h"
+#include "CollisionQuery.h"
+
+#include <algorithm>
+
 namespace mc
 {
     Camera::Camera(const XMFLOAT3& position,
@@ -63,14 +67,31 @@ namespace mc
         CalculateViewMat();
     }
 
-    void Camera::FollowShip(const Ship& ship)
+    void Camera::FollowShip(const ShipPose& ship, CollisionData* collisionDataArray[], unsigned int collisionDataCount)
     {
         // TODO: fix this
-        XMFLOAT3 position = ship.GetPosition();
-        XMVECTOR shipPos = XMLoadFloat3(&position);
+        XMVECTOR shipPos = ship.position;
         XMVECTOR offset = worldUp_ * 0.125f;
 
-        XMVECTOR pos = shipPos - (ship.GetForward() * 0.25f) + offset;
+        XMVECTOR pos = shipPos - (ship.forward * 0.25f) + offset;
+
+        // pull the camera in front of the geometry between it and the ship, the sphere is a bit wider than
+        // the near plane so the rails are never clipped
+        CollisionRay ray;
+        XMVECTOR toCamera = pos - shipPos;
+        XMStoreFloat3(&ray.origin, shipPos);
+        XMStoreFloat3(&ray.direction, XMVector3Normalize(toCamera));
+        ray.maxDistance = XMVectorGetX(XMVector3Length(toCamera));
+        float distance = ray.maxDistance;
+        for (unsigned int i = 0; i < collisionDataCount; i++)
+        {
+            CollisionHit hit;
+            CollisionQuery::SphereCast(*collisionDataArray[i], &ray, 1, nearPlane_ * 2.0f, &hit);
+            distance = std::min(distance, hit.distance);
+        }
+        // closer than this the ship fills the screen
+        distance = std::max(distance, ray.maxDistance * 0.25f);
+        pos = shipPos + XMLoadFloat3(&ray.direction) * distance;
         XMStoreFloat3(&position_, pos);
 
         front_ = XMVector3Normalize(shipPos - pos);
@@ -79,10 +100,9 @@ namespace mc
         view_ = XMMatrixLookAtLH(pos, pos + front_, up_);
     }
 
-    void Camera::TargteShip(const Ship& ship)
+    void Camera::TargteShip(const ShipPose& ship)
     {
-        XMFLOAT3 shipPosition = ship.GetPosition();
-        XMVECTOR shipPos = XMLoadFloat3(&shipPosition);
+        XMVECTOR shipPos = ship.position;
         XMVECTOR position = XMLoadFloat3(&position_);
         front_ = XMVector3Normalize(shipPos - position);
         right_ = XMVector3Normalize(XMVector3Cross(worldUp_, front_));
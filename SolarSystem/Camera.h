@@ -7,7 +7,8 @@ using namespace DirectX;
 
 namespace mc
 {
-    class Ship;
+    struct ShipPose;
+    struct CollisionData;
 
     class Camera
     {
@@ -17,8 +18,9 @@ namespace mc
                float fovMin, float fovMax,
                float aspectRation);
         void Update(const InputManager& im, float dt);
-        void FollowShip(const Ship& ship);
-        void TargteShip(const Ship& ship);
+        // the camera stays on the ship side of the collision geometry
+        void FollowShip(const ShipPose& ship, CollisionData* collisionDataArray[], unsigned int collisionDataCount);
+        void TargteShip(const ShipPose& ship);
 
         const XMMATRIX& GetViewMat();
         const XMFLOAT3& GetPosition();
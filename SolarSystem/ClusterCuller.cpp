@@ -0,0 +1,46 @@
+#include "ClusterCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mc
+{
+    void ClusterCuller::Cull(const MeshCluster* clusters, unsigned int count, const XMMATRIX& model,
+        const Frustum& frustum, FXMVECTOR viewPos, bool backfaceCull, std::vector<IndexRange>& ranges, ClusterCullStats& stats)
+    {
+        // the radius grows with the largest axis scale so the sphere stays conservative
+        float maxScale = std::max(XMVectorGetX(XMVector3LengthSq(model.r[0])),
+            std::max(XMVectorGetX(XMVector3LengthSq(model.r[1])), XMVectorGetX(XMVector3LengthSq(model.r[2]))));
+        maxScale = std::sqrt(maxScale);
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            const MeshCluster& cluster = clusters[i];
+            XMVECTOR center = XMVector3Transform(XMLoadFloat3(&cluster.center), model);
+            float radius = cluster.radius * maxScale;
+
+            bool visible = frustum.IntersectsSphere(center, radius);
+            if (visible && backfaceCull && cluster.coneCutoff < 1.0f)
+            {
+                XMVECTOR axis = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&cluster.coneAxis), model));
+                XMVECTOR toCluster = center - viewPos;
+                float distance = XMVectorGetX(XMVector3Length(toCluster));
+                visible = XMVectorGetX(XMVector3Dot(toCluster, axis)) < cluster.coneCutoff * distance + radius;
+            }
+
+            stats.testedTriangles += cluster.indexCount / 3;
+            if (!visible)
+            {
+                stats.culledTriangles += cluster.indexCount / 3;
+            }
+            else if (!ranges.empty() && ranges.back().indexOffset + ranges.back().indexCount == cluster.indexOffset)
+            {
+                ranges.back().indexCount += cluster.indexCount;
+            }
+            else
+            {
+                ranges.push_back(IndexRange{ cluster.indexOffset, cluster.indexCount });
+            }
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+#include "Frustum.h"
+
+namespace mc
+{
+    struct IndexRange
+    {
+        unsigned int indexOffset;
+        unsigned int indexCount;
+    };
+
+    struct ClusterCullStats
+    {
+        unsigned long long testedTriangles;
+        unsigned long long culledTriangles;
+    };
+
+    class ClusterCuller
+    {
+    public:
+        // Appends to ranges the index ranges of the clusters that are inside the frustum and not facing away
+        // from viewPos, consecutive visible clusters are merged in one range. model is the world matrix of the
+        // mesh and must not mirror it. backfaceCull false skips the normal cone test, for meshes drawn without
+        // back face culling. The tested and culled triangles are added to stats.
+        static void Cull(const MeshCluster* clusters, unsigned int count, const XMMATRIX& model,
+            const Frustum& frustum, FXMVECTOR viewPos, bool backfaceCull, std::vector<IndexRange>& ranges, ClusterCullStats& stats);
+    };
+}
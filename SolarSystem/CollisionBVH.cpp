@@ -0,0 +1,343 @@
+#include "CollisionBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace mc
+{
+    namespace
+    {
+        const unsigned int maxLeafQuads = 4;
+        // leafs above this size are split even when SAH says they are cheaper
+        const unsigned int maxForcedLeafQuads = 16;
+        const unsigned int binCount = 16;
+        // cost of visiting a node relative to testing one quad
+        const float traversalCost = 1.0f;
+        // the queries use a fixed size stack, deeper nodes are made leafs
+        const unsigned int maxDepth = 60;
+
+        struct Aabb
+        {
+            float min[3];
+            float max[3];
+
+            void Reset()
+            {
+                min[0] = min[1] = min[2] = FLT_MAX;
+                max[0] = max[1] = max[2] = -FLT_MAX;
+            }
+
+            void Grow(const float* point)
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    min[i] = std::min(min[i], point[i]);
+                    max[i] = std::max(max[i], point[i]);
+                }
+            }
+
+            void Grow(const Aabb& other)
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    min[i] = std::min(min[i], other.min[i]);
+                    max[i] = std::max(max[i], other.max[i]);
+                }
+            }
+
+            float HalfArea() const
+            {
+                if (min[0] > max[0])
+                {
+                    return 0.0f;
+                }
+                float x = max[0] - min[0];
+                float y = max[1] - min[1];
+                float z = max[2] - min[2];
+                return x * y + y * z + z * x;
+            }
+        };
+
+        struct Bin
+        {
+            Aabb bounds;
+            unsigned int count;
+        };
+
+        struct BuildContext
+        {
+            std::vector<Aabb> quadBounds;
+            std::vector<XMFLOAT3> centroids;
+            std::vector<unsigned int>& order;
+            std::vector<CollisionBVHNode>& nodes;
+        };
+
+        unsigned int BinIndex(float centroid, float min, float scale)
+        {
+            int bin = static_cast<int>((centroid - min) * scale);
+            return static_cast<unsigned int>(std::min(std::max(bin, 0), static_cast<int>(binCount) - 1));
+        }
+
+        void BuildNode(BuildContext& context, unsigned int begin, unsigned int end, unsigned int depth)
+        {
+            unsigned int nodeIndex = static_cast<unsigned int>(context.nodes.size());
+            context.nodes.emplace_back();
+
+            Aabb bounds;
+            Aabb centroidBounds;
+            bounds.Reset();
+            centroidBounds.Reset();
+            for (unsigned int i = begin; i < end; i++)
+            {
+                unsigned int quad = context.order[i];
+                bounds.Grow(context.quadBounds[quad]);
+                centroidBounds.Grow(&context.centroids[quad].x);
+            }
+            CollisionBVHNode& node = context.nodes[nodeIndex];
+            node.min = XMFLOAT3(bounds.min[0], bounds.min[1], bounds.min[2]);
+            node.max = XMFLOAT3(bounds.max[0], bounds.max[1], bounds.max[2]);
+
+            unsigned int count = end - begin;
+            if (count <= maxLeafQuads || depth >= maxDepth)
+            {
+                node.offset = begin;
+                node.count = count;
+                return;
+            }
+
+            // binned SAH, every axis is tried and the split with the lowest cost wins
+            int bestAxis = -1;
+            unsigned int bestSplit = 0;
+            float bestCost = FLT_MAX;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+                if (extent <= 0.0f)
+                {
+                    continue;
+                }
+                float scale = binCount / extent;
+                Bin bins[binCount];
+                for (Bin& bin : bins)
+                {
+                    bin.bounds.Reset();
+                    bin.count = 0;
+                }
+                for (unsigned int i = begin; i < end; i++)
+                {
+                    unsigned int quad = context.order[i];
+                    Bin& bin = bins[BinIndex((&context.centroids[quad].x)[axis], centroidBounds.min[axis], scale)];
+                    bin.bounds.Grow(context.quadBounds[quad]);
+                    ++bin.count;
+                }
+
+                // sweep from the right to get the cost of every right side, then from the left
+                float rightAreas[binCount];
+                unsigned int rightCounts[binCount];
+                Aabb right;
+                right.Reset();
+                unsigned int rightCount = 0;
+                for (unsigned int b = binCount - 1; b > 0; b--)
+                {
+                    right.Grow(bins[b].bounds);
+                    rightCount += bins[b].count;
+                    rightAreas[b] = right.HalfArea();
+                    rightCounts[b] = rightCount;
+                }
+                Aabb left;
+                left.Reset();
+                unsigned int leftCount = 0;
+                for (unsigned int b = 1; b < binCount; b++)
+                {
+                    left.Grow(bins[b - 1].bounds);
+                    leftCount += bins[b - 1].count;
+                    if (leftCount == 0 || rightCounts[b] == 0)
+                    {
+                        continue;
+                    }
+                    float cost = leftCount * left.HalfArea() + rightCounts[b] * rightAreas[b];
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = b;
+                    }
+                }
+            }
+
+            float area = bounds.HalfArea();
+            float leafCost = static_cast<float>(count);
+            float splitCost = area > 0.0f ? traversalCost + bestCost / area : FLT_MAX;
+            if (splitCost >= leafCost && count <= maxForcedLeafQuads)
+            {
+                node.offset = begin;
+                node.count = count;
+                return;
+            }
+
+            unsigned int middle;
+            if (bestAxis >= 0)
+            {
+                float scale = binCount / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+                float min = centroidBounds.min[bestAxis];
+                auto middleIt = std::partition(context.order.begin() + begin, context.order.begin() + end,
+                    [&](unsigned int quad)
+                    {
+                        return BinIndex((&context.centroids[quad].x)[bestAxis], min, scale) < bestSplit;
+                    });
+                middle = static_cast<unsigned int>(middleIt - context.order.begin());
+            }
+            else
+            {
+                // all the centroids are in the same place, split the list in half
+                middle = begin + count / 2;
+            }
+
+            BuildNode(context, begin, middle, depth + 1);
+            context.nodes[nodeIndex].offset = static_cast<unsigned int>(context.nodes.size());
+            context.nodes[nodeIndex].count = 0;
+            BuildNode(context, middle, end, depth + 1);
+        }
+
+        bool SphereOverlaps(const CollisionBVHNode& node, const float* center, float radiusSq)
+        {
+            const float* min = &node.min.x;
+            const float* max = &node.max.x;
+            float distanceSq = 0.0f;
+            for (int i = 0; i < 3; i++)
+            {
+                float d = std::max(std::max(min[i] - center[i], center[i] - max[i]), 0.0f);
+                distanceSq += d * d;
+            }
+            return distanceSq <= radiusSq;
+        }
+
+        bool RayOverlaps(const CollisionBVHNode& node, const float* origin, const float* direction, const float* invDirection, float maxDistance)
+        {
+            const float* min = &node.min.x;
+            const float* max = &node.max.x;
+            float tMin = 0.0f;
+            float tMax = maxDistance;
+            for (int i = 0; i < 3; i++)
+            {
+                if (direction[i] == 0.0f)
+                {
+                    if (origin[i] < min[i] || origin[i] > max[i])
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+                float t0 = (min[i] - origin[i]) * invDirection[i];
+                float t1 = (max[i] - origin[i]) * invDirection[i];
+                tMin = std::max(tMin, std::min(t0, t1));
+                tMax = std::min(tMax, std::max(t0, t1));
+                if (tMin > tMax)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        template <typename Overlaps>
+        void Traverse(const CollisionData& collisionData, Overlaps overlaps, std::vector<unsigned int>& candidates)
+        {
+            candidates.clear();
+            const std::vector<CollisionBVHNode>& nodes = collisionData.bvhNodes;
+            if (nodes.empty())
+            {
+                return;
+            }
+
+            unsigned int stack[maxDepth + 4];
+            unsigned int stackSize = 0;
+            stack[stackSize++] = 0;
+            while (stackSize > 0)
+            {
+                unsigned int nodeIndex = stack[--stackSize];
+                const CollisionBVHNode& node = nodes[nodeIndex];
+                if (!overlaps(node))
+                {
+                    continue;
+                }
+                if (node.count > 0)
+                {
+                    candidates.insert(candidates.end(),
+                        collisionData.bvhQuads.begin() + node.offset,
+                        collisionData.bvhQuads.begin() + node.offset + node.count);
+                }
+                else
+                {
+                    stack[stackSize++] = node.offset;
+                    stack[stackSize++] = nodeIndex + 1;
+                }
+            }
+            std::sort(candidates.begin(), candidates.end());
+        }
+    }
+
+// PUBLICS:
+    void CollisionBVH::Build(CollisionData& collisionData)
+    {
+        collisionData.bvhNodes.clear();
+        collisionData.bvhQuads.clear();
+        size_t quadCount = collisionData.quads.size();
+        if (quadCount == 0)
+        {
+            return;
+        }
+
+        BuildContext context{ {}, {}, collisionData.bvhQuads, collisionData.bvhNodes };
+        context.quadBounds.resize(quadCount);
+        context.centroids.resize(quadCount);
+        context.order.resize(quadCount);
+        for (size_t i = 0; i < quadCount; i++)
+        {
+            const CollisionQuad& quad = collisionData.quads[i];
+            Aabb& bounds = context.quadBounds[i];
+            bounds.Reset();
+            for (int v = 0; v < 4; v++)
+            {
+                bounds.Grow(&quad.vertices[v].x);
+            }
+            context.centroids[i] = XMFLOAT3((bounds.min[0] + bounds.max[0]) * 0.5f,
+                                            (bounds.min[1] + bounds.max[1]) * 0.5f,
+                                            (bounds.min[2] + bounds.max[2]) * 0.5f);
+            context.order[i] = static_cast<unsigned int>(i);
+        }
+        context.nodes.reserve(2 * quadCount / maxLeafQuads + 1);
+
+        BuildNode(context, 0, static_cast<unsigned int>(quadCount), 0);
+        collisionData.bvhNodes.shrink_to_fit();
+    }
+
+    void CollisionBVH::QuerySphere(const CollisionData& collisionData, FXMVECTOR center, float radius,
+        std::vector<unsigned int>& candidates)
+    {
+        XMFLOAT3 c;
+        XMStoreFloat3(&c, center);
+        float radiusSq = radius * radius;
+        Traverse(collisionData, [&](const CollisionBVHNode& node)
+            {
+                return SphereOverlaps(node, &c.x, radiusSq);
+            }, candidates);
+    }
+
+    void CollisionBVH::QueryRay(const CollisionData& collisionData, FXMVECTOR origin, FXMVECTOR direction, float maxDistance,
+        std::vector<unsigned int>& candidates)
+    {
+        XMFLOAT3 o;
+        XMFLOAT3 d;
+        XMStoreFloat3(&o, origin);
+        XMStoreFloat3(&d, direction);
+        XMFLOAT3 inv(d.x != 0.0f ? 1.0f / d.x : 0.0f,
+                     d.y != 0.0f ? 1.0f / d.y : 0.0f,
+                     d.z != 0.0f ? 1.0f / d.z : 0.0f);
+        Traverse(collisionData, [&](const CollisionBVHNode& node)
+            {
+                return RayOverlaps(node, &o.x, &d.x, &inv.x, maxDistance);
+            }, candidates);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+
+namespace mc
+{
+    class CollisionBVH
+    {
+    public:
+        // Builds collisionData.bvhNodes over all the quads with binned SAH splits
+        static void Build(CollisionData& collisionData);
+
+        // The queries only test the bounds of the quads, candidates gets the indices of the quads
+        // whose bounds are touched, sorted so they are processed in the same order as the quads.
+        static void QuerySphere(const CollisionData& collisionData, FXMVECTOR center, float radius,
+            std::vector<unsigned int>& candidates);
+        // direction does not need to be normalized, maxDistance is measured in lengths of direction
+        static void QueryRay(const CollisionData& collisionData, FXMVECTOR origin, FXMVECTOR direction, float maxDistance,
+            std::vector<unsigned int>& candidates);
+    };
+}
@@ -0,0 +1,744 @@
+#include "CollisionBenchmarks.h"
+#include "CollisionBVH.h"
+#include "CollisionKernel.h"
+#include "CollisionQuery.h"
+#include "CollisionSDF.h"
+#include "ShipCollision.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace mc
+{
+    namespace
+    {
+        // rays per job of the ray benchmark
+        const size_t rayBatchSize = 256;
+        // ship positions of the quad basis benchmark
+        const unsigned int contactPointCount = 4096;
+        // sphere queries per synthetic track of the BVH benchmark, the linear test gets fewer on the long tracks
+        const unsigned int bvhQueryCount = 65536;
+        const unsigned long long linearQuadTests = 1ull << 26;
+        // the rails of the game are about this wide and high
+        const float ringQuadWidth = 0.05f;
+        const float ringQuadHeight = 0.1f;
+
+        // positions of the distance field test
+        const unsigned int fieldPointCount = 65536;
+
+        // the ships driven for the kernel test, each changes its keys at random every few steps
+        const unsigned int drivenShipCount = 16;
+        const unsigned int drivenStepRate = 120;
+        const unsigned int drivenSteps = 20 * drivenStepRate;
+        const unsigned int inputSteps = 30;
+
+        // ships fired at the rails by the tunnelling test, at every speed with every step
+        const unsigned int firedShipCount = 4096;
+        const float firedMinSpeed = 2.0f;
+        const float firedMaxSpeed = 40.0f;
+        const float firedSteps[] = { 1.0f / 120.0f, 1.0f / 30.0f, 1.0f / 10.0f };
+
+        // the two contact tests do not round the same way, a point this close to an edge of a quad can go either way
+        const float contactTolerance = 1e-4f;
+
+        // where a ship is relative to a quad: above it by penetration, along it by x
+        struct Contact
+        {
+            float penetration;
+            float x;
+            float width;
+        };
+
+        bool Touches(const Contact& contact)
+        {
+            return contact.penetration <= 0.0f && contact.penetration >= -1.0f && contact.x >= 0.0f && contact.x <= contact.width;
+        }
+
+        bool NearEdge(const Contact& contact)
+        {
+            return std::fabs(contact.penetration) < contactTolerance || std::fabs(contact.penetration + 1.0f) < contactTolerance ||
+                std::fabs(contact.x) < contactTolerance || std::fabs(contact.x - contact.width) < contactTolerance;
+        }
+
+        // The contact test of the ship before the bases were baked: the basis of the quad is built and inverted
+        // for every test.
+        Contact InverseContact(const CollisionQuad& quad, FXMVECTOR position, float radius)
+        {
+            XMVECTOR a = XMLoadFloat3(&quad.vertices[0]);
+            XMVECTOR b = XMLoadFloat3(&quad.vertices[1]);
+            XMVECTOR d = XMLoadFloat3(&quad.vertices[3]);
+            XMVECTOR n = XMLoadFloat3(&quad.normal);
+
+            Contact contact;
+            contact.width = XMVectorGetX(XMVector3Length(b - a));
+
+            XMVECTOR origin = XMVectorSetW(a, 1.0f) + n * radius;
+            XMMATRIX basisMatrix(XMVector3Normalize(b - a), n, XMVector3Normalize(d - a), origin);
+            XMVECTOR relPos = XMVector3Transform(position, XMMatrixInverse(nullptr, basisMatrix));
+            contact.penetration = XMVectorGetY(relPos);
+            contact.x = XMVectorGetX(relPos);
+            return contact;
+        }
+
+        Contact BakedContact(const CollisionQuadBasis& quad, FXMVECTOR position, float radius)
+        {
+            XMVECTOR relPos = position - quad.origin;
+            Contact contact;
+            contact.penetration = XMVectorGetX(XMVector3Dot(relPos, quad.inverseUp)) - radius;
+            contact.x = XMVectorGetX(XMVector3Dot(relPos, quad.inverseRight));
+            contact.width = quad.width;
+            return contact;
+        }
+
+        // The positions of ships driven with random keys from points along the track, colliding with the quads,
+        // and where their velocity takes them in one more step
+        std::vector<XMVECTOR> DrivenPositions(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            float radius)
+        {
+            std::mt19937 random(1);
+            std::vector<XMVECTOR> positions;
+            positions.reserve(drivenShipCount * drivenSteps * 2);
+            for (unsigned int i = 0; i < drivenShipCount; i++)
+            {
+                XMFLOAT3 start;
+                XMStoreFloat3(&start, track.GetPoint(track.GetLength() * i / drivenShipCount));
+                start.y = 0.0125f;
+                ShipTuning tuning;
+                tuning.mass = 2.0f;
+                Ship ship(start, tuning.mass, radius);
+                ship.SetTuning(tuning);
+                ship.SetCollisionMode(Ship::CollisionMode::Quads);
+
+                ShipInput input;
+                for (unsigned int step = 0; step < drivenSteps; step++)
+                {
+                    if (step % inputSteps == 0)
+                    {
+                        unsigned int keys = random();
+                        input.left = (keys & 1) != 0;
+                        input.right = (keys & 2) != 0;
+                        input.thrust = (keys & 12) != 0;
+                    }
+                    ship.Update(input, 1.0f / drivenStepRate, collisionDataArray, collisionDataCount);
+                    // the ship is already out of the rails, a step further on is where the next contact tests are
+                    XMFLOAT3 position = ship.GetPosition();
+                    positions.push_back(XMLoadFloat3(&position));
+                    positions.push_back(XMLoadFloat3(&position) + ship.GetVelocity() / drivenStepRate);
+                }
+            }
+            return positions;
+        }
+
+        // The contact bits of a block the way Ship tested one quad at a time
+        unsigned int ScalarBlockContacts(const CollisionData& collisionData, unsigned int block, FXMVECTOR position, float radius)
+        {
+            unsigned int mask = 0;
+            for (unsigned int lane = 0; lane < CollisionKernel::blockSize; lane++)
+            {
+                size_t quad = size_t(block) * CollisionKernel::blockSize + lane;
+                if (quad < collisionData.bases.size() && Touches(BakedContact(collisionData.bases[quad], position, radius)))
+                {
+                    mask |= 1u << lane;
+                }
+            }
+            return mask;
+        }
+
+        // ShipCollision::Resolve of a body at rest without the kernel: every candidate is tested and pushes the body
+        // out on its own, in quad order
+        void ScalarResolve(ShipCollision::Body& body, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            std::vector<unsigned int>& candidates)
+        {
+            for (unsigned int i = 0; i < collisionDataCount; i++)
+            {
+                const CollisionData& collisionData = *collisionDataArray[i];
+                CollisionBVH::QuerySphere(collisionData, body.position, body.radius, candidates);
+                for (unsigned int candidate : candidates)
+                {
+                    const CollisionQuadBasis& quad = collisionData.bases[candidate];
+                    Contact contact = BakedContact(quad, body.position, body.radius);
+                    if (Touches(contact))
+                    {
+                        float z = XMVectorGetX(XMVector3Dot(body.position - quad.origin, quad.inverseFront));
+                        XMVECTOR worldContactPoint = quad.origin + quad.up * body.radius + quad.right * contact.x + quad.front * z;
+                        body.position = worldContactPoint + quad.up * 0.001f;
+                        body.velocity = body.velocity - quad.up * XMVector3Dot(body.velocity, quad.up);
+                    }
+                }
+            }
+        }
+
+        // true when the segment crosses a rail
+        bool CrossesRail(FXMVECTOR from, FXMVECTOR to, CollisionData* collisionDataArray[], unsigned int collisionDataCount)
+        {
+            float length = XMVectorGetX(XMVector3Length(to - from));
+            if (length <= 0.0f)
+            {
+                return false;
+            }
+            CollisionRay ray;
+            XMStoreFloat3(&ray.origin, from);
+            XMStoreFloat3(&ray.direction, (to - from) / length);
+            ray.maxDistance = length;
+            for (unsigned int i = 0; i < collisionDataCount; i++)
+            {
+                CollisionHit hit;
+                CollisionQuery::Raycast(*collisionDataArray[i], &ray, 1, &hit);
+                if (hit.quad != CollisionQuery::noHit)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // A position is inside the track when nothing separates it from the closest point of the centerline
+        bool InsideTrack(const TrackSpline& track, FXMVECTOR position, CollisionData* collisionDataArray[], unsigned int collisionDataCount)
+        {
+            TrackLocation location = track.Project(position, TrackSpline::noSegment);
+            XMVECTOR center = XMVectorSetY(track.GetPoint(location.distance), XMVectorGetY(position));
+            return !CrossesRail(center, position, collisionDataArray, collisionDataCount);
+        }
+
+        // A circular wall of quadCount quads facing the center
+        CollisionData RingTrack(unsigned int quadCount)
+        {
+            CollisionData collisionData;
+            collisionData.quads.resize(quadCount);
+            float ringRadius = quadCount * ringQuadWidth / XM_2PI;
+            for (unsigned int i = 0; i < quadCount; i++)
+            {
+                float angle0 = XM_2PI * i / quadCount;
+                float angle1 = XM_2PI * (i + 1) / quadCount;
+                float angle = 0.5f * (angle0 + angle1);
+                CollisionQuad& quad = collisionData.quads[i];
+                quad.vertices[0] = XMFLOAT3(ringRadius * std::cos(angle0), 0.0f, ringRadius * std::sin(angle0));
+                quad.vertices[1] = XMFLOAT3(ringRadius * std::cos(angle1), 0.0f, ringRadius * std::sin(angle1));
+                quad.vertices[2] = XMFLOAT3(quad.vertices[1].x, ringQuadHeight, quad.vertices[1].z);
+                quad.vertices[3] = XMFLOAT3(quad.vertices[0].x, ringQuadHeight, quad.vertices[0].z);
+                quad.normal = XMFLOAT3(-std::cos(angle), 0.0f, -std::sin(angle));
+            }
+            return collisionData;
+        }
+
+        bool QuadTouchesSphere(const CollisionQuad& quad, const XMFLOAT3& center, float radiusSq)
+        {
+            XMVECTOR min = XMLoadFloat3(&quad.vertices[0]);
+            XMVECTOR max = min;
+            for (const XMFLOAT3& vertex : quad.vertices)
+            {
+                min = XMVectorMin(min, XMLoadFloat3(&vertex));
+                max = XMVectorMax(max, XMLoadFloat3(&vertex));
+            }
+            XMVECTOR c = XMLoadFloat3(&center);
+            XMVECTOR d = XMVectorMax(XMVectorMax(min - c, c - max), XMVectorZero());
+            return XMVectorGetX(XMVector3LengthSq(d)) <= radiusSq;
+        }
+
+        // Tests every point against every quad with the contact function, repeated for a quarter of a second.
+        // Returns the time of one pass and counts the contacts.
+        template <typename ContactFunction>
+        double TimeContacts(const std::vector<XMVECTOR>& points, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            ContactFunction contactFunction, size_t& contactCount)
+        {
+            // zero, but the compiler cant know it and move the tests out of the loop of the passes
+            volatile float zero = 0.0f;
+            unsigned int passCount = 0;
+            double time = 0.0;
+            auto start = std::chrono::steady_clock::now();
+            while (time < 0.25)
+            {
+                XMVECTOR offset = XMVectorReplicate(zero);
+                contactCount = 0;
+                for (const XMVECTOR& point : points)
+                {
+                    for (unsigned int i = 0; i < collisionDataCount; i++)
+                    {
+                        for (size_t q = 0; q < collisionDataArray[i]->quads.size(); q++)
+                        {
+                            contactCount += Touches(contactFunction(*collisionDataArray[i], q, point + offset)) ? 1 : 0;
+                        }
+                    }
+                }
+                ++passCount;
+                time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            return time / passCount;
+        }
+
+        void Cast(const CollisionData& collisionData, const CollisionRay* rays, size_t count, float radius, CollisionHit* hits)
+        {
+            if (radius > 0.0f)
+            {
+                CollisionQuery::SphereCast(collisionData, rays, count, radius, hits);
+            }
+            else
+            {
+                CollisionQuery::Raycast(collisionData, rays, count, hits);
+            }
+        }
+
+        // The quads of collisionData under a BVH of one leaf, a query on it tests every quad
+        CollisionData SingleLeaf(const CollisionData& collisionData)
+        {
+            CollisionData leaf;
+            leaf.quads = collisionData.quads;
+            leaf.bases = collisionData.bases;
+            CollisionBVHNode node{ XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX), 0, XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX),
+                static_cast<unsigned int>(leaf.quads.size()) };
+            for (unsigned int i = 0; i < leaf.quads.size(); i++)
+            {
+                for (const XMFLOAT3& vertex : leaf.quads[i].vertices)
+                {
+                    XMStoreFloat3(&node.min, XMVectorMin(XMLoadFloat3(&node.min), XMLoadFloat3(&vertex)));
+                    XMStoreFloat3(&node.max, XMVectorMax(XMLoadFloat3(&node.max), XMLoadFloat3(&vertex)));
+                }
+                leaf.bvhQuads.push_back(i);
+            }
+            leaf.bvhNodes.push_back(node);
+            return leaf;
+        }
+
+        // Times the casts and checks them against testing every quad, the BVH only skips quads so the closest
+        // hit must be at the same distance. Returns false when a hit differs.
+        bool CastRays(const char* name, const std::vector<CollisionRay>& rays, float radius,
+            CollisionData* collisionDataArray[], unsigned int collisionDataCount)
+        {
+            ThreadPool& threadPool = ThreadPool::Get();
+            std::vector<CollisionHit> hits(rays.size());
+            size_t batchCount = (rays.size() + rayBatchSize - 1) / rayBatchSize;
+            unsigned long long rayCount = 0;
+            size_t hitCount = 0;
+            double wallTime = 0.0;
+            auto start = std::chrono::steady_clock::now();
+            // repeat for a second so the timer and the thread pool wake up do not count
+            while (wallTime < 1.0)
+            {
+                threadPool.ParallelFor(batchCount, [&](size_t batch)
+                {
+                    size_t first = batch * rayBatchSize;
+                    size_t count = std::min(rayBatchSize, rays.size() - first);
+                    for (unsigned int i = 0; i < collisionDataCount; i++)
+                    {
+                        Cast(*collisionDataArray[i], &rays[first], count, radius, &hits[first]);
+                    }
+                });
+                rayCount += rays.size() * collisionDataCount;
+                wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            for (const CollisionHit& hit : hits)
+            {
+                hitCount += hit.quad != CollisionQuery::noHit ? 1 : 0;
+            }
+
+            size_t mismatches = 0;
+            std::vector<CollisionHit> allQuadHits(rays.size());
+            for (unsigned int i = 0; i < collisionDataCount; i++)
+            {
+                CollisionData leaf = SingleLeaf(*collisionDataArray[i]);
+                threadPool.ParallelFor(batchCount, [&](size_t batch)
+                {
+                    size_t first = batch * rayBatchSize;
+                    size_t count = std::min(rayBatchSize, rays.size() - first);
+                    Cast(*collisionDataArray[i], &rays[first], count, radius, &hits[first]);
+                    Cast(leaf, &rays[first], count, radius, &allQuadHits[first]);
+                });
+                for (size_t r = 0; r < rays.size(); r++)
+                {
+                    // two quads can be hit at the same distance, then either one is right
+                    bool hit = hits[r].quad != CollisionQuery::noHit;
+                    bool allQuadHit = allQuadHits[r].quad != CollisionQuery::noHit;
+                    mismatches += hit != allQuadHit || (hit && hits[r].distance != allQuadHits[r].distance) ? 1 : 0;
+                }
+            }
+
+            double raysPerSecond = rayCount / wallTime;
+            std::cout << name << ": " << rays.size() << " rays x " << collisionDataCount << " rails, " << hitCount << " hit the last rail, "
+                << raysPerSecond / 1e6 << " M rays/s, " << raysPerSecond / threadPool.GetThreadCount() / 1e6 << " M rays/s per core, "
+                << (mismatches == 0 ? "same hits as every quad" : "DIFFERENT HITS") << "\n";
+            return mismatches == 0;
+        }
+    }
+
+// PUBLICS:
+    bool CollisionBenchmarks::Rays(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+        float radius)
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        // sensors of ships spread along the track: a fan of rays ahead of every ship, the coherent case
+        const unsigned int shipCount = 4096;
+        const unsigned int fanRays = 16;
+        std::vector<CollisionRay> fans;
+        fans.reserve(shipCount * fanRays);
+        for (unsigned int ship = 0; ship < shipCount; ship++)
+        {
+            float distance = track.GetLength() * ship / shipCount;
+            XMVECTOR position = track.GetPoint(distance) + XMVectorSet(0.0f, 0.0125f, 0.0f, 0.0f);
+            XMVECTOR forward = XMVector3Normalize(track.GetPoint(distance + 0.05f) - track.GetPoint(distance));
+            float heading = std::atan2(XMVectorGetX(forward), XMVectorGetZ(forward));
+            for (unsigned int i = 0; i < fanRays; i++)
+            {
+                float angle = heading + XM_PIDIV2 * (2.0f * i / (fanRays - 1) - 1.0f);
+                CollisionRay ray;
+                XMStoreFloat3(&ray.origin, position);
+                ray.direction = XMFLOAT3(std::sin(angle), 0.0f, std::cos(angle));
+                ray.maxDistance = 1.0f;
+                fans.push_back(ray);
+            }
+        }
+
+        // rays from anywhere over the track in any direction, the incoherent case
+        std::vector<CollisionRay> scattered(fans.size());
+        for (CollisionRay& ray : scattered)
+        {
+            XMVECTOR position = track.GetPoint((unit(random) * 0.5f + 0.5f) * track.GetLength());
+            ray.origin = XMFLOAT3(XMVectorGetX(position) + unit(random) * 0.3f, unit(random) * 0.05f + 0.05f,
+                XMVectorGetZ(position) + unit(random) * 0.3f);
+            XMStoreFloat3(&ray.direction, XMVector3Normalize(XMVectorSet(unit(random), unit(random) * 0.25f, unit(random), 0.0f)));
+            ray.maxDistance = 2.0f;
+        }
+
+        std::cout << "Casting rays on " << ThreadPool::Get().GetThreadCount() << " threads\n";
+        bool passed = CastRays("Sensor fans", fans, 0.0f, collisionDataArray, collisionDataCount);
+        passed = CastRays("Scattered rays", scattered, 0.0f, collisionDataArray, collisionDataCount) && passed;
+        passed = CastRays("Sensor fans sphere cast", fans, radius, collisionDataArray, collisionDataCount) && passed;
+        return passed;
+    }
+
+    bool CollisionBenchmarks::QuadBasis(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+        float radius)
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        // ships anywhere on and around the track, some of them inside the rails
+        std::vector<XMVECTOR> points(contactPointCount);
+        for (XMVECTOR& point : points)
+        {
+            XMVECTOR position = track.GetPoint((unit(random) * 0.5f + 0.5f) * track.GetLength());
+            point = XMVectorSet(XMVectorGetX(position) + unit(random) * 0.3f, unit(random) * 0.1f + 0.05f,
+                XMVectorGetZ(position) + unit(random) * 0.3f, 1.0f);
+        }
+
+        size_t inverseContacts = 0;
+        double inverseTime = TimeContacts(points, collisionDataArray, collisionDataCount,
+            [radius](const CollisionData& collisionData, size_t q, FXMVECTOR point)
+            {
+                return InverseContact(collisionData.quads[q], point, radius);
+            }, inverseContacts);
+        size_t bakedContacts = 0;
+        double bakedTime = TimeContacts(points, collisionDataArray, collisionDataCount,
+            [radius](const CollisionData& collisionData, size_t q, FXMVECTOR point)
+            {
+                return BakedContact(collisionData.bases[q], point, radius);
+            }, bakedContacts);
+
+        size_t testCount = 0;
+        size_t mismatches = 0;
+        float maxDifference = 0.0f;
+        for (const XMVECTOR& point : points)
+        {
+            for (unsigned int i = 0; i < collisionDataCount; i++)
+            {
+                const CollisionData& collisionData = *collisionDataArray[i];
+                for (size_t q = 0; q < collisionData.quads.size(); q++)
+                {
+                    Contact inverse = InverseContact(collisionData.quads[q], point, radius);
+                    Contact baked = BakedContact(collisionData.bases[q], point, radius);
+                    float difference = std::max(std::fabs(inverse.penetration - baked.penetration), std::fabs(inverse.x - baked.x));
+                    maxDifference = std::max(maxDifference, difference);
+                    bool sameContact = Touches(inverse) == Touches(baked) || NearEdge(inverse);
+                    mismatches += difference > contactTolerance || !sameContact ? 1 : 0;
+                    ++testCount;
+                }
+            }
+        }
+
+        std::cout << "Quad contact tests: " << testCount << " per pass\n"
+            << "Inverted basis: " << inverseContacts << " contacts in " << inverseTime * 1e3 << " ms, "
+            << inverseTime / testCount * 1e9 << " ns per test\n"
+            << "Baked basis: " << bakedContacts << " contacts in " << bakedTime * 1e3 << " ms, "
+            << bakedTime / testCount * 1e9 << " ns per test, " << inverseTime / bakedTime << "x faster\n"
+            << "Largest difference " << maxDifference << ", "
+            << (mismatches == 0 ? "same contacts" : "DIFFERENT CONTACTS") << "\n";
+        return mismatches == 0;
+    }
+
+    bool CollisionBenchmarks::BVHScaling(const TrackSpline&, CollisionData*[], unsigned int, float radius)
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        bool passed = true;
+        for (unsigned int quadCount = 1000; quadCount <= 1000000; quadCount *= 10)
+        {
+            CollisionData collisionData = RingTrack(quadCount);
+            auto start = std::chrono::steady_clock::now();
+            CollisionBVH::Build(collisionData);
+            double buildTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            // ships on both sides of the wall, close enough for some to touch it
+            float ringRadius = quadCount * ringQuadWidth / XM_2PI;
+            std::vector<XMFLOAT3> centers(bvhQueryCount);
+            for (XMFLOAT3& center : centers)
+            {
+                float angle = (unit(random) * 0.5f + 0.5f) * XM_2PI;
+                float distance = ringRadius + unit(random) * 0.1f;
+                center = XMFLOAT3(distance * std::cos(angle), (unit(random) * 0.5f + 0.5f) * ringQuadHeight, distance * std::sin(angle));
+            }
+
+            std::vector<unsigned int> candidates;
+            std::vector<std::vector<unsigned int>> queryCandidates(centers.size());
+            size_t candidateCount = 0;
+            start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < centers.size(); i++)
+            {
+                CollisionBVH::QuerySphere(collisionData, XMLoadFloat3(&centers[i]), radius, queryCandidates[i]);
+                candidateCount += queryCandidates[i].size();
+            }
+            double bvhTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            // the linear test is also the reference, every quad it finds must be a candidate
+            size_t linearCount = std::min<size_t>(centers.size(), linearQuadTests / quadCount);
+            size_t missing = 0;
+            float radiusSq = radius * radius;
+            start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < linearCount; i++)
+            {
+                candidates.clear();
+                for (unsigned int q = 0; q < quadCount; q++)
+                {
+                    if (QuadTouchesSphere(collisionData.quads[q], centers[i], radiusSq))
+                    {
+                        candidates.push_back(q);
+                    }
+                }
+                for (unsigned int q : candidates)
+                {
+                    missing += std::binary_search(queryCandidates[i].begin(), queryCandidates[i].end(), q) ? 0 : 1;
+                }
+            }
+            double linearTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            double bvhQueryTime = bvhTime / centers.size();
+            double linearQueryTime = linearTime / linearCount;
+            std::cout << quadCount << " quads: " << collisionData.bvhNodes.size() << " nodes built in " << buildTime * 1e3 << " ms, "
+                << bvhQueryTime * 1e9 << " ns per query with " << static_cast<double>(candidateCount) / centers.size()
+                << " candidates, linear " << linearQueryTime * 1e9 << " ns, " << linearQueryTime / bvhQueryTime << "x faster, "
+                << (missing == 0 ? "no quad missed" : "MISSED QUADS") << "\n";
+            passed = passed && missing == 0;
+        }
+        return passed;
+    }
+
+    bool CollisionBenchmarks::DistanceField(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+        float)
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        // Around the rails and the track between them, within the height of the rails. Past their top and bottom
+        // edges the signed distance jumps from one side of the rail to the other and the interpolation across the
+        // jump is close to zero, the ship never gets there.
+        float bottom = FLT_MAX;
+        float top = -FLT_MAX;
+        for (unsigned int i = 0; i < collisionDataCount; i++)
+        {
+            for (const CollisionQuad& quad : collisionDataArray[i]->quads)
+            {
+                for (const XMFLOAT3& vertex : quad.vertices)
+                {
+                    bottom = std::min(bottom, vertex.y);
+                    top = std::max(top, vertex.y);
+                }
+            }
+        }
+        std::vector<XMFLOAT3> points(fieldPointCount);
+        for (XMFLOAT3& point : points)
+        {
+            XMVECTOR position = track.GetPoint((unit(random) * 0.5f + 0.5f) * track.GetLength());
+            point = XMFLOAT3(XMVectorGetX(position) + unit(random) * 0.3f, bottom + (unit(random) * 0.5f + 0.5f) * (top - bottom),
+                XMVectorGetZ(position) + unit(random) * 0.3f);
+        }
+
+        bool passed = true;
+        std::vector<CollisionHit> hits(points.size());
+        std::vector<float> distances(points.size());
+        std::vector<XMVECTOR> normals(points.size());
+        std::vector<char> sampled(points.size());
+        for (unsigned int i = 0; i < collisionDataCount; i++)
+        {
+            const CollisionData& collisionData = *collisionDataArray[i];
+            const CollisionDistanceField& field = collisionData.distanceField;
+            // the trilinear interpolation stays within half a voxel, the ends of the band are clamped
+            const float distanceBound = 0.5f * field.voxelSize;
+            const float bandEnd = field.maxDistance - 2.0f * field.voxelSize;
+
+            auto start = std::chrono::steady_clock::now();
+            CollisionQuery::ClosestPoints(collisionData, points.data(), points.size(), field.maxDistance, hits.data());
+            double exactTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            start = std::chrono::steady_clock::now();
+            for (size_t p = 0; p < points.size(); p++)
+            {
+                sampled[p] = CollisionSDF::Sample(field, XMLoadFloat3(&points[p]), distances[p], normals[p]) ? 1 : 0;
+            }
+            double fieldTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            size_t inBand = 0;
+            size_t failures = 0;
+            float maxError = 0.0f;
+            for (size_t p = 0; p < points.size(); p++)
+            {
+                const CollisionHit& hit = hits[p];
+                if (hit.quad == CollisionQuery::noHit || hit.distance > bandEnd)
+                {
+                    continue;
+                }
+                ++inBand;
+                if (!sampled[p])
+                {
+                    ++failures;
+                    continue;
+                }
+                float error = std::fabs(std::fabs(distances[p]) - hit.distance);
+                maxError = std::max(maxError, error);
+                bool failed = error > distanceBound;
+
+                // next to the surface the side of an edge between two quads can go either way
+                if (hit.distance > 2.0f * field.voxelSize)
+                {
+                    XMVECTOR offset = XMLoadFloat3(&points[p]) - XMLoadFloat3(&hit.point);
+                    bool front = XMVectorGetX(XMVector3Dot(offset, collisionData.bases[hit.quad].up)) >= 0.0f;
+                    XMVECTOR direction = XMVector3Normalize(front ? offset : -offset);
+                    failed = failed || front != (distances[p] >= 0.0f) ||
+                        XMVectorGetX(XMVector3Dot(direction, normals[p])) < 0.9f;
+                }
+                failures += failed ? 1 : 0;
+            }
+
+            std::cout << "Rail " << i << ": " << CollisionSDF::GetBrickCount(field) << " bricks, " << inBand << " of " << points.size()
+                << " points in the band, largest distance error " << maxError << " for voxels of " << field.voxelSize << ", "
+                << fieldTime / points.size() * 1e9 << " ns per sample, closest point " << exactTime / points.size() * 1e9 << " ns, "
+                << (failures == 0 ? "same as the quads" : "DIFFERENT FROM THE QUADS") << "\n";
+            passed = passed && failures == 0;
+        }
+        return passed;
+    }
+
+    bool CollisionBenchmarks::KernelParity(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+        float radius)
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        // anywhere around the track, inside the rails or near them, then where the ships actually go
+        std::vector<XMVECTOR> positions(contactPointCount);
+        for (XMVECTOR& position : positions)
+        {
+            XMVECTOR point = track.GetPoint((unit(random) * 0.5f + 0.5f) * track.GetLength());
+            position = XMVectorSet(XMVectorGetX(point) + unit(random) * 0.3f, unit(random) * 0.1f + 0.05f,
+                XMVectorGetZ(point) + unit(random) * 0.3f, 0.0f);
+        }
+        size_t gridCount = positions.size();
+        std::vector<XMVECTOR> driven = DrivenPositions(track, collisionDataArray, collisionDataCount, radius);
+        positions.insert(positions.end(), driven.begin(), driven.end());
+
+        size_t blockTests = 0;
+        size_t contacts = 0;
+        size_t bitMismatches = 0;
+        for (const XMVECTOR& position : positions)
+        {
+            for (unsigned int i = 0; i < collisionDataCount; i++)
+            {
+                const CollisionData& collisionData = *collisionDataArray[i];
+                for (unsigned int block = 0; block < collisionData.quadBlocks.size(); block++)
+                {
+                    unsigned int mask = CollisionKernel::TestBlock(collisionData.quadBlocks[block], position, radius);
+                    unsigned int scalarMask = ScalarBlockContacts(collisionData, block, position, radius);
+                    bitMismatches += mask != scalarMask ? 1 : 0;
+                    for (; scalarMask != 0; scalarMask &= scalarMask - 1)
+                    {
+                        ++contacts;
+                    }
+                    ++blockTests;
+                }
+            }
+        }
+
+        // the body is at rest so only the contact tests move it, no sweep
+        size_t pushed = 0;
+        size_t resolveMismatches = 0;
+        std::vector<unsigned int> candidates;
+        for (const XMVECTOR& position : positions)
+        {
+            ShipCollision::Body body{ position, XMVectorZero(), position, radius };
+            ShipCollision::Body scalarBody = body;
+            ShipCollision::Resolve(body, 1.0f / drivenStepRate, Ship::CollisionMode::Quads, collisionDataArray, collisionDataCount,
+                candidates);
+            ScalarResolve(scalarBody, collisionDataArray, collisionDataCount, candidates);
+            bool same = XMVector3Equal(body.position, scalarBody.position) && XMVector3Equal(body.velocity, scalarBody.velocity);
+            resolveMismatches += same ? 0 : 1;
+            pushed += XMVector3Equal(body.position, position) ? 0 : 1;
+        }
+
+        std::cout << positions.size() << " positions, " << gridCount << " around the track and " << driven.size() << " of "
+            << drivenShipCount << " driven ships: " << blockTests << " blocks of " << CollisionKernel::blockSize << " quads, "
+            << contacts << " contacts, " << pushed << " positions pushed out, "
+            << (bitMismatches == 0 && resolveMismatches == 0 ? "same as one quad at a time" : "DIFFERENT FROM ONE QUAD AT A TIME");
+        if (bitMismatches != 0 || resolveMismatches != 0)
+        {
+            std::cout << ": " << bitMismatches << " blocks, " << resolveMismatches << " resolves";
+        }
+        std::cout << "\n";
+        return bitMismatches == 0 && resolveMismatches == 0;
+    }
+
+    bool CollisionBenchmarks::Tunnelling(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+        float radius)
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        bool passed = true;
+        for (Ship::CollisionMode mode : { Ship::CollisionMode::Quads, Ship::CollisionMode::DistanceField })
+        {
+            for (float dt : firedSteps)
+            {
+                size_t pastRail = 0;
+                size_t escaped = 0;
+                std::vector<unsigned int> candidates;
+                for (unsigned int i = 0; i < firedShipCount; i++)
+                {
+                    XMVECTOR start = XMVectorSetY(track.GetPoint(unit(random) * track.GetLength()), 0.0125f);
+                    float angle = unit(random) * XM_2PI;
+                    float speed = firedMinSpeed + unit(random) * (firedMaxSpeed - firedMinSpeed);
+                    XMVECTOR velocity = XMVectorSet(std::cos(angle) * speed, 0.0f, std::sin(angle) * speed, 0.0f);
+
+                    // one step of the integrator, the collision gets the ship where it would be without the rails
+                    ShipCollision::Body body{ start + velocity * dt, velocity, start, radius };
+                    pastRail += CrossesRail(start, body.position, collisionDataArray, collisionDataCount) ? 1 : 0;
+                    ShipCollision::Resolve(body, dt, mode, collisionDataArray, collisionDataCount, candidates);
+                    escaped += InsideTrack(track, body.position, collisionDataArray, collisionDataCount) ? 0 : 1;
+                }
+
+                std::cout << (mode == Ship::CollisionMode::Quads ? "Quads" : "Distance field") << ", step " << dt * 1e3 << " ms: "
+                    << pastRail << " of " << firedShipCount << " ships fired past a rail, "
+                    << (escaped == 0 ? "none went through" : "SOME WENT THROUGH");
+                if (escaped != 0)
+                {
+                    std::cout << ": " << escaped;
+                }
+                std::cout << "\n";
+                passed = passed && escaped == 0;
+            }
+        }
+        return passed;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+#include "TrackSpline.h"
+
+namespace mc
+{
+    // Headless benchmarks of the track collision, run by SolarSystemSim on the rails of the game with the radius
+    // of its ship. They all take the same arguments and return false when their check fails.
+    class CollisionBenchmarks
+    {
+    public:
+        // Casts rays and sphere casts of the given radius against the rails with CollisionQuery on all the cores,
+        // prints the rays per second per core and checks the hits against testing every quad
+        static bool Rays(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            float radius);
+        // Times the contact test of a ship of the given radius with every quad of the rails, building and inverting
+        // the basis of the quad like the ship did against the baked CollisionQuadBasis, and checks they agree
+        static bool QuadBasis(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            float radius);
+        // Builds the BVH over synthetic ring tracks of 1k to 1M quads and times sphere queries of the given radius
+        // against testing the bounds of every quad, checking that the candidates have every quad those touch
+        static bool BVHScaling(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            float radius);
+        // Samples the distance fields of the rails around the track and checks the distance, side and normal against
+        // the closest point on the quads, timing both. The fields must be baked.
+        static bool DistanceField(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            float radius);
+        // Tests positions around the track and the positions of ships driven around it with CollisionKernel and
+        // with the scalar test of one quad at a time, the contact bits and the resolved ships must be identical
+        static bool KernelParity(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            float radius);
+        // Fires ships of the given radius from the centerline at the rails, faster and with longer steps than the
+        // game, through ShipCollision::Resolve and checks that none of them ends up past a rail
+        static bool Tunnelling(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            float radius);
+    };
+}
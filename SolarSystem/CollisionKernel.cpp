@@ -0,0 +1,98 @@
+#include "CollisionKernel.h"
+
+#include <immintrin.h>
+
+namespace mc
+{
+    namespace
+    {
+#if !defined(__AVX__)
+        // the sums are done in the same order as XMVector3Dot so the lanes match the scalar test bit for bit
+        unsigned int TestLanes(const CollisionQuadBlock& block, unsigned int first, __m128 px, __m128 py, __m128 pz, __m128 radius)
+        {
+            __m128 rx = _mm_sub_ps(px, _mm_load_ps(block.originX + first));
+            __m128 ry = _mm_sub_ps(py, _mm_load_ps(block.originY + first));
+            __m128 rz = _mm_sub_ps(pz, _mm_load_ps(block.originZ + first));
+
+            __m128 up = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(rx, _mm_load_ps(block.inverseUpX + first)),
+                _mm_mul_ps(ry, _mm_load_ps(block.inverseUpY + first))),
+                _mm_mul_ps(rz, _mm_load_ps(block.inverseUpZ + first)));
+            __m128 penetration = _mm_sub_ps(up, radius);
+            __m128 x = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(rx, _mm_load_ps(block.inverseRightX + first)),
+                _mm_mul_ps(ry, _mm_load_ps(block.inverseRightY + first))),
+                _mm_mul_ps(rz, _mm_load_ps(block.inverseRightZ + first)));
+
+            __m128 hit = _mm_and_ps(
+                _mm_and_ps(_mm_cmple_ps(penetration, _mm_setzero_ps()), _mm_cmpge_ps(penetration, _mm_set1_ps(-1.0f))),
+                _mm_and_ps(_mm_cmpge_ps(x, _mm_setzero_ps()), _mm_cmple_ps(x, _mm_load_ps(block.width + first))));
+            return static_cast<unsigned int>(_mm_movemask_ps(hit));
+        }
+#endif
+    }
+
+// PUBLICS:
+    void CollisionKernel::BuildBlocks(CollisionData& collisionData)
+    {
+        size_t quadCount = collisionData.bases.size();
+        collisionData.quadBlocks.assign((quadCount + blockSize - 1) / blockSize, CollisionQuadBlock{});
+        for (size_t i = 0; i < collisionData.quadBlocks.size() * blockSize; i++)
+        {
+            CollisionQuadBlock& block = collisionData.quadBlocks[i / blockSize];
+            size_t lane = i % blockSize;
+            if (i >= quadCount)
+            {
+                block.width[lane] = -1.0f;
+                continue;
+            }
+
+            const CollisionQuadBasis& basis = collisionData.bases[i];
+            block.originX[lane] = XMVectorGetX(basis.origin);
+            block.originY[lane] = XMVectorGetY(basis.origin);
+            block.originZ[lane] = XMVectorGetZ(basis.origin);
+            block.inverseUpX[lane] = XMVectorGetX(basis.inverseUp);
+            block.inverseUpY[lane] = XMVectorGetY(basis.inverseUp);
+            block.inverseUpZ[lane] = XMVectorGetZ(basis.inverseUp);
+            block.inverseRightX[lane] = XMVectorGetX(basis.inverseRight);
+            block.inverseRightY[lane] = XMVectorGetY(basis.inverseRight);
+            block.inverseRightZ[lane] = XMVectorGetZ(basis.inverseRight);
+            block.width[lane] = basis.width;
+        }
+    }
+
+    unsigned int CollisionKernel::TestBlock(const CollisionQuadBlock& block, FXMVECTOR center, float radius)
+    {
+        XMFLOAT3 c;
+        XMStoreFloat3(&c, center);
+#if defined(__AVX__)
+        __m256 rx = _mm256_sub_ps(_mm256_set1_ps(c.x), _mm256_load_ps(block.originX));
+        __m256 ry = _mm256_sub_ps(_mm256_set1_ps(c.y), _mm256_load_ps(block.originY));
+        __m256 rz = _mm256_sub_ps(_mm256_set1_ps(c.z), _mm256_load_ps(block.originZ));
+
+        // no fused multiply add, the sums are done in the same order as XMVector3Dot
+        __m256 up = _mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(rx, _mm256_load_ps(block.inverseUpX)),
+            _mm256_mul_ps(ry, _mm256_load_ps(block.inverseUpY))),
+            _mm256_mul_ps(rz, _mm256_load_ps(block.inverseUpZ)));
+        __m256 penetration = _mm256_sub_ps(up, _mm256_set1_ps(radius));
+        __m256 x = _mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(rx, _mm256_load_ps(block.inverseRightX)),
+            _mm256_mul_ps(ry, _mm256_load_ps(block.inverseRightY))),
+            _mm256_mul_ps(rz, _mm256_load_ps(block.inverseRightZ)));
+
+        __m256 hit = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(penetration, _mm256_setzero_ps(), _CMP_LE_OQ),
+                          _mm256_cmp_ps(penetration, _mm256_set1_ps(-1.0f), _CMP_GE_OQ)),
+            _mm256_and_ps(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GE_OQ),
+                          _mm256_cmp_ps(x, _mm256_load_ps(block.width), _CMP_LE_OQ)));
+        return static_cast<unsigned int>(_mm256_movemask_ps(hit));
+#else
+        __m128 px = _mm_set1_ps(c.x);
+        __m128 py = _mm_set1_ps(c.y);
+        __m128 pz = _mm_set1_ps(c.z);
+        __m128 r = _mm_set1_ps(radius);
+        return TestLanes(block, 0, px, py, pz, r) | (TestLanes(block, 4, px, py, pz, r) << 4);
+#endif
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+
+namespace mc
+{
+    class CollisionKernel
+    {
+    public:
+        static const unsigned int blockSize = 8;
+
+        // Fills collisionData.quadBlocks from collisionData.bases
+        static void BuildBlocks(CollisionData& collisionData);
+
+        // Bit i of the result is set when the sphere touches quad i of the block the same way Ship tests
+        // one quad: at most 1 below the plane of the quad raised by the radius and inside its width.
+        // Uses AVX when the project is built with it, two SSE halves otherwise.
+        static unsigned int TestBlock(const CollisionQuadBlock& block, FXMVECTOR center, float radius);
+
+        static unsigned int FirstLane(unsigned int mask)
+        {
+            unsigned int lane = 0;
+            while ((mask & 1u) == 0)
+            {
+                mask >>= 1;
+                ++lane;
+            }
+            return lane;
+        }
+    };
+}
@@ -0,0 +1,350 @@
+#include "CollisionQuery.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <immintrin.h>
+
+namespace mc
+{
+    namespace
+    {
+        // CollisionBVH makes every node deeper than 60 a leaf, a depth first walk never holds more nodes than that
+        const unsigned int maxStackSize = 64;
+        // stands in for 1 / 0 in the slab test so a ray parallel to a slab gives +-huge instead of nan
+        const float hugeInverse = 1e30f;
+
+        // four rays, one per lane
+        struct RayPacket
+        {
+            __m128 originX, originY, originZ;
+            __m128 directionX, directionY, directionZ;
+            __m128 inverseX, inverseY, inverseZ;
+            // distance of the closest hit so far, starts at the length of the ray
+            __m128 best;
+            __m128 bestSide;
+            // lanes without a ray are all zero
+            __m128 active;
+            unsigned int quad[4];
+        };
+
+        __m128 Splat(float value)
+        {
+            return _mm_set1_ps(value);
+        }
+
+        __m128 Dot(__m128 x, __m128 y, __m128 z, FXMVECTOR v)
+        {
+            return _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(x, Splat(XMVectorGetX(v))),
+                _mm_mul_ps(y, Splat(XMVectorGetY(v)))),
+                _mm_mul_ps(z, Splat(XMVectorGetZ(v))));
+        }
+
+        float InverseOrHuge(float d)
+        {
+            if (d != 0.0f)
+            {
+                return 1.0f / d;
+            }
+            return std::signbit(d) ? -hugeInverse : hugeInverse;
+        }
+
+        void LoadPacket(const CollisionRay* rays, size_t count, RayPacket& packet)
+        {
+            alignas(16) float values[10][4];
+            alignas(16) unsigned int active[4];
+            for (size_t lane = 0; lane < 4; lane++)
+            {
+                // the empty lanes copy the first ray so the node tests stay finite, they are masked out anyway
+                const CollisionRay& ray = rays[lane < count ? lane : 0];
+                values[0][lane] = ray.origin.x;
+                values[1][lane] = ray.origin.y;
+                values[2][lane] = ray.origin.z;
+                values[3][lane] = ray.direction.x;
+                values[4][lane] = ray.direction.y;
+                values[5][lane] = ray.direction.z;
+                values[6][lane] = InverseOrHuge(ray.direction.x);
+                values[7][lane] = InverseOrHuge(ray.direction.y);
+                values[8][lane] = InverseOrHuge(ray.direction.z);
+                values[9][lane] = ray.maxDistance;
+                active[lane] = lane < count ? ~0u : 0u;
+                packet.quad[lane] = CollisionQuery::noHit;
+            }
+            packet.originX = _mm_load_ps(values[0]);
+            packet.originY = _mm_load_ps(values[1]);
+            packet.originZ = _mm_load_ps(values[2]);
+            packet.directionX = _mm_load_ps(values[3]);
+            packet.directionY = _mm_load_ps(values[4]);
+            packet.directionZ = _mm_load_ps(values[5]);
+            packet.inverseX = _mm_load_ps(values[6]);
+            packet.inverseY = _mm_load_ps(values[7]);
+            packet.inverseZ = _mm_load_ps(values[8]);
+            packet.best = _mm_load_ps(values[9]);
+            packet.bestSide = _mm_setzero_ps();
+            packet.active = _mm_castsi128_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(active)));
+        }
+
+        void SlabLimits(__m128 origin, __m128 inverse, float min, float max, __m128& tNear, __m128& tFar)
+        {
+            __m128 t0 = _mm_mul_ps(_mm_sub_ps(Splat(min), origin), inverse);
+            __m128 t1 = _mm_mul_ps(_mm_sub_ps(Splat(max), origin), inverse);
+            tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+            tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+        }
+
+        // lanes whose ray enters the node before their closest hit, grow is how far the quads reach out of it
+        int PacketOverlaps(const RayPacket& packet, const CollisionBVHNode& node, float grow)
+        {
+            __m128 tNear = _mm_setzero_ps();
+            __m128 tFar = packet.best;
+            SlabLimits(packet.originX, packet.inverseX, node.min.x - grow, node.max.x + grow, tNear, tFar);
+            SlabLimits(packet.originY, packet.inverseY, node.min.y - grow, node.max.y + grow, tNear, tFar);
+            SlabLimits(packet.originZ, packet.inverseZ, node.min.z - grow, node.max.z + grow, tNear, tFar);
+            return _mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(tNear, tFar), packet.active));
+        }
+
+        // The quad is its plane raised by the radius towards the ray origin and widened by the radius on all four
+        // sides, only a ray going towards the plane hits it. A ray that starts within the radius of the plane
+        // hits at 0.
+        void IntersectQuad(RayPacket& packet, const CollisionQuadBasis& basis, unsigned int quad, float radius)
+        {
+            __m128 relX = _mm_sub_ps(packet.originX, Splat(XMVectorGetX(basis.origin)));
+            __m128 relY = _mm_sub_ps(packet.originY, Splat(XMVectorGetY(basis.origin)));
+            __m128 relZ = _mm_sub_ps(packet.originZ, Splat(XMVectorGetZ(basis.origin)));
+
+            __m128 signMask = Splat(-0.0f);
+            __m128 distance = Dot(relX, relY, relZ, basis.inverseUp);
+            __m128 approach = Dot(packet.directionX, packet.directionY, packet.directionZ, basis.inverseUp);
+            // +-1 for the side of the plane the ray starts on
+            __m128 side = _mm_or_ps(_mm_and_ps(distance, signMask), Splat(1.0f));
+            __m128 raised = _mm_mul_ps(side, Splat(radius));
+            __m128 touching = _mm_cmple_ps(_mm_andnot_ps(signMask, distance), Splat(radius));
+            __m128 towards = _mm_cmplt_ps(_mm_mul_ps(approach, side), _mm_setzero_ps());
+
+            __m128 t = _mm_div_ps(_mm_sub_ps(raised, distance), approach);
+            t = _mm_andnot_ps(touching, t);
+            __m128 hit = _mm_and_ps(_mm_and_ps(towards, packet.active),
+                _mm_and_ps(_mm_cmpge_ps(t, _mm_setzero_ps()), _mm_cmplt_ps(t, packet.best)));
+            if (_mm_movemask_ps(hit) == 0)
+            {
+                return;
+            }
+
+            // where the ray meets the raised plane, moved back down on the quad
+            __m128 height = _mm_or_ps(_mm_and_ps(touching, distance), _mm_andnot_ps(touching, raised));
+            XMVECTOR up = basis.up;
+            __m128 pointX = _mm_sub_ps(_mm_add_ps(relX, _mm_mul_ps(packet.directionX, t)), _mm_mul_ps(height, Splat(XMVectorGetX(up))));
+            __m128 pointY = _mm_sub_ps(_mm_add_ps(relY, _mm_mul_ps(packet.directionY, t)), _mm_mul_ps(height, Splat(XMVectorGetY(up))));
+            __m128 pointZ = _mm_sub_ps(_mm_add_ps(relZ, _mm_mul_ps(packet.directionZ, t)), _mm_mul_ps(height, Splat(XMVectorGetZ(up))));
+            __m128 x = Dot(pointX, pointY, pointZ, basis.inverseRight);
+            __m128 z = Dot(pointX, pointY, pointZ, basis.inverseFront);
+            __m128 border = Splat(-radius);
+            hit = _mm_and_ps(hit, _mm_and_ps(
+                _mm_and_ps(_mm_cmpge_ps(x, border), _mm_cmple_ps(x, Splat(basis.width + radius))),
+                _mm_and_ps(_mm_cmpge_ps(z, border), _mm_cmple_ps(z, Splat(basis.height + radius)))));
+
+            int mask = _mm_movemask_ps(hit);
+            if (mask == 0)
+            {
+                return;
+            }
+            packet.best = _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, packet.best));
+            packet.bestSide = _mm_or_ps(_mm_and_ps(hit, side), _mm_andnot_ps(hit, packet.bestSide));
+            for (unsigned int lane = 0; lane < 4; lane++)
+            {
+                if (mask & (1 << lane))
+                {
+                    packet.quad[lane] = quad;
+                }
+            }
+        }
+
+        float NodeDistanceSq(const CollisionBVHNode& node, const float* point)
+        {
+            const float* min = &node.min.x;
+            const float* max = &node.max.x;
+            float distanceSq = 0.0f;
+            for (int i = 0; i < 3; i++)
+            {
+                float d = std::max(std::max(min[i] - point[i], point[i] - max[i]), 0.0f);
+                distanceSq += d * d;
+            }
+            return distanceSq;
+        }
+
+        float NodeCenterAlong(const CollisionBVHNode& node, const float* direction)
+        {
+            return (node.min.x + node.max.x) * direction[0] +
+                   (node.min.y + node.max.y) * direction[1] +
+                   (node.min.z + node.max.z) * direction[2];
+        }
+
+        void CastPackets(const CollisionData& collisionData, const CollisionRay* rays, size_t count, float radius,
+            CollisionHit* hits)
+        {
+            const std::vector<CollisionBVHNode>& nodes = collisionData.bvhNodes;
+            for (size_t first = 0; first < count; first += 4)
+            {
+                size_t packetCount = std::min<size_t>(4, count - first);
+                RayPacket packet;
+                LoadPacket(rays + first, packetCount, packet);
+
+                unsigned int stack[maxStackSize];
+                unsigned int stackSize = 0;
+                if (!nodes.empty())
+                {
+                    stack[stackSize++] = 0;
+                }
+                // the near child is visited first so the closest hit prunes the far one early, the packet
+                // shares the order of its first ray
+                const float* order = &rays[first].direction.x;
+                // a quad widened and raised by the radius along its own axes reaches sqrt(3) * radius out of its bounds
+                float grow = radius * 1.7321f;
+                while (stackSize > 0)
+                {
+                    unsigned int nodeIndex = stack[--stackSize];
+                    const CollisionBVHNode& node = nodes[nodeIndex];
+                    if (PacketOverlaps(packet, node, grow) == 0)
+                    {
+                        continue;
+                    }
+                    if (node.count > 0)
+                    {
+                        for (unsigned int i = node.offset; i < node.offset + node.count; i++)
+                        {
+                            unsigned int quad = collisionData.bvhQuads[i];
+                            IntersectQuad(packet, collisionData.bases[quad], quad, radius);
+                        }
+                        continue;
+                    }
+                    unsigned int left = nodeIndex + 1;
+                    unsigned int right = node.offset;
+                    if (NodeCenterAlong(nodes[left], order) > NodeCenterAlong(nodes[right], order))
+                    {
+                        std::swap(left, right);
+                    }
+                    stack[stackSize++] = right;
+                    stack[stackSize++] = left;
+                }
+
+                alignas(16) float best[4];
+                alignas(16) float side[4];
+                _mm_store_ps(best, packet.best);
+                _mm_store_ps(side, packet.bestSide);
+                for (size_t lane = 0; lane < packetCount; lane++)
+                {
+                    const CollisionRay& ray = rays[first + lane];
+                    CollisionHit& hit = hits[first + lane];
+                    XMVECTOR center = XMLoadFloat3(&ray.origin) + XMLoadFloat3(&ray.direction) * best[lane];
+                    hit.distance = best[lane];
+                    hit.quad = packet.quad[lane];
+                    if (hit.quad == CollisionQuery::noHit)
+                    {
+                        XMStoreFloat3(&hit.point, center);
+                        hit.normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
+                        continue;
+                    }
+                    XMVECTOR normal = XMVector3Normalize(collisionData.bases[hit.quad].up) * side[lane];
+                    XMStoreFloat3(&hit.normal, normal);
+                    XMStoreFloat3(&hit.point, center - normal * radius);
+                }
+            }
+        }
+    }
+
+// PUBLICS:
+    void CollisionQuery::Raycast(const CollisionData& collisionData, const CollisionRay* rays, size_t count, CollisionHit* hits)
+    {
+        CastPackets(collisionData, rays, count, 0.0f, hits);
+    }
+
+    void CollisionQuery::SphereCast(const CollisionData& collisionData, const CollisionRay* rays, size_t count, float radius,
+        CollisionHit* hits)
+    {
+        CastPackets(collisionData, rays, count, radius, hits);
+    }
+
+    void CollisionQuery::ClosestPoints(const CollisionData& collisionData, const XMFLOAT3* points, size_t count, float maxDistance,
+        CollisionHit* hits)
+    {
+        const std::vector<CollisionBVHNode>& nodes = collisionData.bvhNodes;
+        for (size_t p = 0; p < count; p++)
+        {
+            const float* point = &points[p].x;
+            XMVECTOR position = XMLoadFloat3(&points[p]);
+            float bestDistanceSq = maxDistance * maxDistance;
+            XMVECTOR bestPoint = position;
+            unsigned int bestQuad = noHit;
+
+            unsigned int stack[maxStackSize];
+            unsigned int stackSize = 0;
+            if (!nodes.empty())
+            {
+                stack[stackSize++] = 0;
+            }
+            while (stackSize > 0)
+            {
+                unsigned int nodeIndex = stack[--stackSize];
+                const CollisionBVHNode& node = nodes[nodeIndex];
+                if (NodeDistanceSq(node, point) > bestDistanceSq)
+                {
+                    continue;
+                }
+                if (node.count > 0)
+                {
+                    for (unsigned int i = node.offset; i < node.offset + node.count; i++)
+                    {
+                        unsigned int quad = collisionData.bvhQuads[i];
+                        const CollisionQuad& vertices = collisionData.quads[quad];
+                        XMVECTOR a = XMLoadFloat3(&vertices.vertices[0]);
+                        XMVECTOR b = XMLoadFloat3(&vertices.vertices[1]);
+                        XMVECTOR c = XMLoadFloat3(&vertices.vertices[2]);
+                        XMVECTOR d = XMLoadFloat3(&vertices.vertices[3]);
+                        XMVECTOR closest[2] = {
+                            Utils::ClosestPointOnTriangle(position, a, b, c),
+                            Utils::ClosestPointOnTriangle(position, a, c, d)
+                        };
+                        for (XMVECTOR candidate : closest)
+                        {
+                            float distanceSq = XMVectorGetX(XMVector3LengthSq(position - candidate));
+                            if (distanceSq <= bestDistanceSq)
+                            {
+                                bestDistanceSq = distanceSq;
+                                bestPoint = candidate;
+                                bestQuad = quad;
+                            }
+                        }
+                    }
+                    continue;
+                }
+                unsigned int left = nodeIndex + 1;
+                unsigned int right = node.offset;
+                if (NodeDistanceSq(nodes[left], point) > NodeDistanceSq(nodes[right], point))
+                {
+                    std::swap(left, right);
+                }
+                stack[stackSize++] = right;
+                stack[stackSize++] = left;
+            }
+
+            CollisionHit& hit = hits[p];
+            hit.quad = bestQuad;
+            XMStoreFloat3(&hit.point, bestPoint);
+            if (bestQuad == noHit)
+            {
+                hit.distance = maxDistance;
+                hit.normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
+                continue;
+            }
+            hit.distance = std::sqrt(bestDistanceSq);
+            XMVECTOR normal = XMVector3Normalize(collisionData.bases[bestQuad].up);
+            if (XMVectorGetX(XMVector3Dot(position - bestPoint, normal)) < 0.0f)
+            {
+                normal = -normal;
+            }
+            XMStoreFloat3(&hit.normal, normal);
+        }
+    }
+}
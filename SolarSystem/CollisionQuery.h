@@ -0,0 +1,47 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+
+namespace mc
+{
+    // direction must be normalized, maxDistance is in world units
+    struct CollisionRay
+    {
+        XMFLOAT3 origin;
+        XMFLOAT3 direction;
+        float maxDistance;
+    };
+
+    struct CollisionHit
+    {
+        // point on the quad, for a sphere cast where the sphere touches it
+        XMFLOAT3 point;
+        // normal of the quad on the side of the query
+        XMFLOAT3 normal;
+        // along the ray for the casts, from the point for ClosestPoints
+        float distance;
+        // CollisionQuery::noHit when nothing was found
+        unsigned int quad;
+    };
+
+    // Batched queries against the quads of a CollisionData through its BVH: N queries in, N hits out.
+    // They only read the CollisionData and keep their state on the stack, so any number of threads can
+    // query the same data at the same time without locks.
+    class CollisionQuery
+    {
+    public:
+        static const unsigned int noHit = ~0u;
+
+        // First quad hit by every ray, from either side. The rays go down the BVH four at a time in SSE lanes,
+        // rays that start close together and point the same way share most of the nodes.
+        static void Raycast(const CollisionData& collisionData, const CollisionRay* rays, size_t count, CollisionHit* hits);
+        // Same as Raycast for a sphere moved along every ray. The quad is tested as its plane raised by the radius
+        // towards the sphere and widened by the radius, like CollisionSweep. Only a sphere moving towards a quad
+        // hits it, at distance 0 when it already touches it.
+        static void SphereCast(const CollisionData& collisionData, const CollisionRay* rays, size_t count, float radius,
+            CollisionHit* hits);
+        // Closest point of the quads to every point, no hit when all the quads are further than maxDistance
+        static void ClosestPoints(const CollisionData& collisionData, const XMFLOAT3* points, size_t count, float maxDistance,
+            CollisionHit* hits);
+    };
+}
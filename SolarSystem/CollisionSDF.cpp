@@ -0,0 +1,255 @@
+#include "CollisionSDF.h"
+#include "CollisionBVH.h"
+#include "ThreadPool.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+
+namespace mc
+{
+    namespace
+    {
+        const unsigned int brickCells = 8;
+        const unsigned int brickSamples = brickCells + 1;
+        const unsigned int brickSampleCount = brickSamples * brickSamples * brickSamples;
+        const unsigned int emptyBrick = ~0u;
+        const float sampleScale = 32767.0f;
+
+        float SignedDistance(const CollisionData& collisionData, const std::vector<unsigned int>& candidates,
+            FXMVECTOR position, float maxDistance)
+        {
+            float bestDistanceSq = FLT_MAX;
+            float bestSide = 0.0f;
+            for (unsigned int candidate : candidates)
+            {
+                const CollisionQuad& quad = collisionData.quads[candidate];
+                XMVECTOR normal = collisionData.bases[candidate].up;
+                XMVECTOR a = XMLoadFloat3(&quad.vertices[0]);
+                XMVECTOR b = XMLoadFloat3(&quad.vertices[1]);
+                XMVECTOR c = XMLoadFloat3(&quad.vertices[2]);
+                XMVECTOR d = XMLoadFloat3(&quad.vertices[3]);
+                XMVECTOR closest[2] = {
+                    Utils::ClosestPointOnTriangle(position, a, b, c),
+                    Utils::ClosestPointOnTriangle(position, a, c, d)
+                };
+                for (XMVECTOR point : closest)
+                {
+                    XMVECTOR offset = position - point;
+                    float distanceSq = XMVectorGetX(XMVector3LengthSq(offset));
+                    float side = XMVectorGetX(XMVector3Dot(offset, normal));
+                    // on a shared edge the quad that faces the position decides the sign
+                    float tolerance = 1e-12f + bestDistanceSq * 1e-5f;
+                    if (distanceSq < bestDistanceSq - tolerance ||
+                        (distanceSq <= bestDistanceSq + tolerance && std::fabs(side) > std::fabs(bestSide)))
+                    {
+                        bestDistanceSq = std::min(distanceSq, bestDistanceSq);
+                        bestSide = side;
+                    }
+                }
+            }
+            if (bestDistanceSq == FLT_MAX)
+            {
+                return maxDistance;
+            }
+            float distance = std::min(std::sqrt(bestDistanceSq), maxDistance);
+            return bestSide >= 0.0f ? distance : -distance;
+        }
+
+        short QuantizeDistance(float distance, float maxDistance)
+        {
+            float value = std::min(std::max(distance / maxDistance, -1.0f), 1.0f);
+            return static_cast<short>(std::lround(value * sampleScale));
+        }
+
+        struct BrickRow
+        {
+            std::vector<unsigned int> bricks;
+            std::vector<short> samples;
+        };
+    }
+
+// PUBLICS:
+    void CollisionSDF::Bake(CollisionData& collisionData, float voxelSize, float maxDistance)
+    {
+        if (voxelSize <= 0.0f || maxDistance <= 0.0f)
+        {
+            throw std::runtime_error("Error distance field needs a positive voxel size and max distance");
+        }
+
+        CollisionDistanceField& field = collisionData.distanceField;
+        field = CollisionDistanceField{};
+        field.voxelSize = voxelSize;
+        field.maxDistance = maxDistance;
+        if (collisionData.quads.empty())
+        {
+            return;
+        }
+
+        XMVECTOR min = XMLoadFloat3(&collisionData.quads[0].vertices[0]);
+        XMVECTOR max = min;
+        for (const CollisionQuad& quad : collisionData.quads)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                XMVECTOR vertex = XMLoadFloat3(&quad.vertices[i]);
+                min = XMVectorMin(min, vertex);
+                max = XMVectorMax(max, vertex);
+            }
+        }
+        min -= XMVectorReplicate(maxDistance);
+        max += XMVectorReplicate(maxDistance);
+        XMStoreFloat3(&field.origin, min);
+
+        float brickSize = voxelSize * brickCells;
+        XMFLOAT3 extent;
+        XMStoreFloat3(&extent, max - min);
+        field.brickCounts[0] = std::max(static_cast<unsigned int>(std::ceil(extent.x / brickSize)), 1u);
+        field.brickCounts[1] = std::max(static_cast<unsigned int>(std::ceil(extent.y / brickSize)), 1u);
+        field.brickCounts[2] = std::max(static_cast<unsigned int>(std::ceil(extent.z / brickSize)), 1u);
+        unsigned int countX = field.brickCounts[0];
+        size_t rowCount = static_cast<size_t>(field.brickCounts[1]) * field.brickCounts[2];
+
+        // every job bakes one row of bricks along x, a brick is kept when any of its samples is inside the band
+        std::vector<BrickRow> rows(rowCount);
+        float brickRadius = brickSize * 0.5f * std::sqrt(3.0f);
+        ThreadPool::Get().ParallelFor(rowCount, [&](size_t row)
+        {
+            unsigned int by = static_cast<unsigned int>(row % field.brickCounts[1]);
+            unsigned int bz = static_cast<unsigned int>(row / field.brickCounts[1]);
+            std::vector<unsigned int> candidates;
+            std::vector<short> samples(brickSampleCount);
+            for (unsigned int bx = 0; bx < countX; bx++)
+            {
+                XMVECTOR brickMin = min + XMVectorSet(bx * brickSize, by * brickSize, bz * brickSize, 0.0f);
+                XMVECTOR center = brickMin + XMVectorReplicate(brickSize * 0.5f);
+                CollisionBVH::QuerySphere(collisionData, center, brickRadius + maxDistance, candidates);
+                if (candidates.empty())
+                {
+                    continue;
+                }
+
+                bool inside = false;
+                short* sample = samples.data();
+                for (unsigned int z = 0; z < brickSamples; z++)
+                {
+                    for (unsigned int y = 0; y < brickSamples; y++)
+                    {
+                        for (unsigned int x = 0; x < brickSamples; x++)
+                        {
+                            XMVECTOR position = brickMin + XMVectorSet(x * voxelSize, y * voxelSize, z * voxelSize, 0.0f);
+                            float distance = SignedDistance(collisionData, candidates, position, maxDistance);
+                            inside |= std::fabs(distance) < maxDistance;
+                            *sample++ = QuantizeDistance(distance, maxDistance);
+                        }
+                    }
+                }
+                if (inside)
+                {
+                    rows[row].bricks.push_back(bx);
+                    rows[row].samples.insert(rows[row].samples.end(), samples.begin(), samples.end());
+                }
+            }
+        });
+
+        field.bricks.assign(rowCount * countX, emptyBrick);
+        size_t sampleCount = 0;
+        for (const BrickRow& row : rows)
+        {
+            sampleCount += row.samples.size();
+        }
+        field.samples.reserve(sampleCount);
+        for (size_t row = 0; row < rowCount; row++)
+        {
+            for (size_t i = 0; i < rows[row].bricks.size(); i++)
+            {
+                field.bricks[row * countX + rows[row].bricks[i]] = static_cast<unsigned int>(field.samples.size());
+                field.samples.insert(field.samples.end(),
+                    rows[row].samples.begin() + i * brickSampleCount,
+                    rows[row].samples.begin() + (i + 1) * brickSampleCount);
+            }
+        }
+    }
+
+    bool CollisionSDF::Sample(const CollisionDistanceField& field, FXMVECTOR position, float& distance, XMVECTOR& normal)
+    {
+        if (field.bricks.empty())
+        {
+            return false;
+        }
+
+        XMFLOAT3 p;
+        XMStoreFloat3(&p, (position - XMLoadFloat3(&field.origin)) / field.voxelSize);
+        if (!(p.x >= 0.0f && p.y >= 0.0f && p.z >= 0.0f))
+        {
+            return false;
+        }
+        unsigned int vx = static_cast<unsigned int>(p.x);
+        unsigned int vy = static_cast<unsigned int>(p.y);
+        unsigned int vz = static_cast<unsigned int>(p.z);
+        unsigned int bx = vx / brickCells;
+        unsigned int by = vy / brickCells;
+        unsigned int bz = vz / brickCells;
+        if (bx >= field.brickCounts[0] || by >= field.brickCounts[1] || bz >= field.brickCounts[2])
+        {
+            return false;
+        }
+        unsigned int brick = field.bricks[(static_cast<size_t>(bz) * field.brickCounts[1] + by) * field.brickCounts[0] + bx];
+        if (brick == emptyBrick)
+        {
+            return false;
+        }
+
+        const unsigned int strideY = brickSamples;
+        const unsigned int strideZ = brickSamples * brickSamples;
+        const short* s = field.samples.data() + brick +
+            (vz - bz * brickCells) * strideZ + (vy - by * brickCells) * strideY + (vx - bx * brickCells);
+        float c000 = s[0];
+        float c100 = s[1];
+        float c010 = s[strideY];
+        float c110 = s[strideY + 1];
+        float c001 = s[strideZ];
+        float c101 = s[strideZ + 1];
+        float c011 = s[strideZ + strideY];
+        float c111 = s[strideZ + strideY + 1];
+        float fx = p.x - vx;
+        float fy = p.y - vy;
+        float fz = p.z - vz;
+
+        float x00 = c000 + (c100 - c000) * fx;
+        float x10 = c010 + (c110 - c010) * fx;
+        float x01 = c001 + (c101 - c001) * fx;
+        float x11 = c011 + (c111 - c011) * fx;
+        float y0 = x00 + (x10 - x00) * fy;
+        float y1 = x01 + (x11 - x01) * fy;
+        float value = y0 + (y1 - y0) * fz;
+        if (std::fabs(value) >= sampleScale)
+        {
+            return false;
+        }
+
+        // derivatives of the trilinear interpolation, the scale does not matter because the normal is normalized
+        float dx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * fy;
+        float dx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * fy;
+        float dx = dx0 + (dx1 - dx0) * fz;
+        float dy = (x10 - x00) + ((x11 - x01) - (x10 - x00)) * fz;
+        float dz = y1 - y0;
+        XMVECTOR gradient = XMVectorSet(dx, dy, dz, 0.0f);
+        float lengthSq = XMVectorGetX(XMVector3LengthSq(gradient));
+        if (lengthSq <= 0.0f)
+        {
+            return false;
+        }
+
+        distance = value * (field.maxDistance / sampleScale);
+        normal = gradient / std::sqrt(lengthSq);
+        return true;
+    }
+
+    size_t CollisionSDF::GetBrickCount(const CollisionDistanceField& field)
+    {
+        return field.samples.size() / brickSampleCount;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+
+namespace mc
+{
+    class CollisionSDF
+    {
+    public:
+        // Bakes collisionData.distanceField on all the threads of the ThreadPool, distances are exact up to
+        // maxDistance from the quads and only the bricks inside that band are stored. Needs the BVH of the quads.
+        static void Bake(CollisionData& collisionData, float voxelSize, float maxDistance);
+
+        // Trilinear sample of the field, normal is the normalized gradient of the same sample. Returns false
+        // when the position is outside the stored bricks or maxDistance away from the quads.
+        static bool Sample(const CollisionDistanceField& field, FXMVECTOR position, float& distance, XMVECTOR& normal);
+
+        static size_t GetBrickCount(const CollisionDistanceField& field);
+    };
+}
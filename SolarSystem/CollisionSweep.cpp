@@ -0,0 +1,50 @@
+#include "CollisionSweep.h"
+
+#include <cfloat>
+
+namespace mc
+{
+// PUBLICS:
+    bool CollisionSweep::SweepSphere(const CollisionData& collisionData, const std::vector<unsigned int>& candidates,
+        FXMVECTOR from, FXMVECTOR to, float radius, float& toi, unsigned int& quad)
+    {
+        bool hit = false;
+        float first = FLT_MAX;
+        for (unsigned int candidate : candidates)
+        {
+            const CollisionQuadBasis& basis = collisionData.bases[candidate];
+            XMVECTOR relFrom = from - basis.origin;
+            XMVECTOR relTo = to - basis.origin;
+
+            // only a motion that starts on the front of the raised plane and ends behind it hits the quad
+            float distanceFrom = XMVectorGetX(XMVector3Dot(relFrom, basis.inverseUp)) - radius;
+            float distanceTo = XMVectorGetX(XMVector3Dot(relTo, basis.inverseUp)) - radius;
+            if (distanceFrom < 0.0f || distanceTo >= 0.0f)
+            {
+                continue;
+            }
+            float t = distanceFrom / (distanceFrom - distanceTo);
+            if (t >= first)
+            {
+                continue;
+            }
+
+            float xFrom = XMVectorGetX(XMVector3Dot(relFrom, basis.inverseRight));
+            float xTo = XMVectorGetX(XMVector3Dot(relTo, basis.inverseRight));
+            float x = xFrom + (xTo - xFrom) * t;
+            // the raised planes of two quads leave a gap at a convex joint of the rail, widening the quads
+            // by the radius closes it so the ship can not slip out between them
+            if (x >= -radius && x <= basis.width + radius)
+            {
+                first = t;
+                quad = candidate;
+                hit = true;
+            }
+        }
+        if (hit)
+        {
+            toi = first;
+        }
+        return hit;
+    }
+}
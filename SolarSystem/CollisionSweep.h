@@ -0,0 +1,17 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+
+namespace mc
+{
+    class CollisionSweep
+    {
+    public:
+        // Moves a sphere from one point to another against the candidate quads, with the same quad test as Ship:
+        // the front side of the plane raised by the radius, inside the width of the quad widened by the radius.
+        // Returns false when nothing is hit, otherwise toi is the fraction of the motion before the first hit
+        // and quad its index.
+        static bool SweepSphere(const CollisionData& collisionData, const std::vector<unsigned int>& candidates,
+            FXMVECTOR from, FXMVECTOR to, float radius, float& toi, unsigned int& quad);
+    };
+}
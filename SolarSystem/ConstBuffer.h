@@ -53,15 +53,15 @@ namespace mc
         {
             if (bindTo & ConstBufferBind::BIND_TO_VS)
             {
-                GetDeviceContext(gm)->VSSetConstantBuffers(slot, 1, buffer.GetAddressOf());
+                GetStateCache(gm).SetConstantBuffer(ShaderStage::Vertex, slot, buffer.Get());
             }
             if (bindTo & ConstBufferBind::BIND_TO_PS)
             {
-                GetDeviceContext(gm)->PSSetConstantBuffers(slot, 1, buffer.GetAddressOf());
+                GetStateCache(gm).SetConstantBuffer(ShaderStage::Pixel, slot, buffer.Get());
             }
             if (bindTo & ConstBufferBind::BIND_TO_GS)
             {
-                GetDeviceContext(gm)->GSSetConstantBuffers(slot, 1, buffer.GetAddressOf());
+                GetStateCache(gm).SetConstantBuffer(ShaderStage::Geometry, slot, buffer.Get());
             }
         }
     private:
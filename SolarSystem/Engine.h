@@ -13,6 +13,7 @@
 #include "Texture.h"
 
 #include "GeometryGenerator.h"
+#include "MeshCache.h"
 #include "Mesh.h"
 #include "Camera.h"
 #include "ParticleSystem.h"
@@ -45,6 +45,8 @@ namespace mc
     void FrameBuffer::Bind(const GraphicsManager& gm)
     {
         GetDeviceContext(gm)->OMSetRenderTargets(1, renderTargetView_.GetAddressOf(), depthStencilView_.Get());
+        // d3d unbinds the inputs that read the new target
+        GetStateCache(gm).ForgetShaderResources();
         gm.SetViewport(static_cast<float>(x_), static_cast<float>(y_), static_cast<float>(w_), static_cast<float>(h_));
     }
 
@@ -57,13 +59,12 @@ namespace mc
 
     void FrameBuffer::BindAsTexture(const GraphicsManager& gm, unsigned int slot)
     {
-        GetDeviceContext(gm)->PSSetShaderResources(slot, 1, shaderResourceView_.GetAddressOf());
+        GetStateCache(gm).SetShaderResource(ShaderStage::Pixel, slot, shaderResourceView_.Get());
     }
 
     void FrameBuffer::UnbindAsTexture(const GraphicsManager& gm, unsigned int slot)
     {
-        ID3D11ShaderResourceView* null[] = { nullptr };
-        GetDeviceContext(gm)->PSSetShaderResources(slot, 1, null);
+        GetStateCache(gm).SetShaderResource(ShaderStage::Pixel, slot, nullptr);
     }
 
 
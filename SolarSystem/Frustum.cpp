@@ -0,0 +1,105 @@
+#include "Frustum.h"
+
+#include <algorithm>
+#include <xmmintrin.h>
+
+namespace mc
+{
+    Frustum::Frustum()
+    {
+        // without a camera nothing is culled
+        for (int i = 0; i < 6; i++)
+        {
+            planes_[i] = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+    }
+
+    Frustum::Frustum(const XMMATRIX& viewProj)
+    {
+        // Gribb and Hartmann, with row vectors the planes come from the columns of the matrix.
+        // D3D clip space z goes from 0 to w, so the near plane is the third column alone.
+        XMMATRIX m = XMMatrixTranspose(viewProj);
+        XMVECTOR planes[6] = {
+            m.r[3] + m.r[0], // left
+            m.r[3] - m.r[0], // right
+            m.r[3] + m.r[1], // bottom
+            m.r[3] - m.r[1], // top
+            m.r[2],          // near
+            m.r[3] - m.r[2]  // far
+        };
+        for (int i = 0; i < 6; i++)
+        {
+            XMStoreFloat4(&planes_[i], XMPlaneNormalize(planes[i]));
+        }
+    }
+
+    bool Frustum::IntersectsSphere(FXMVECTOR center, float radius) const
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            if (XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&planes_[i]), center)) < -radius)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Frustum::IntersectsSpheres(const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+        size_t count, unsigned char* visible) const
+    {
+        __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+        for (int i = 0; i < 6; i++)
+        {
+            planeX[i] = _mm_set1_ps(planes_[i].x);
+            planeY[i] = _mm_set1_ps(planes_[i].y);
+            planeZ[i] = _mm_set1_ps(planes_[i].z);
+            planeW[i] = _mm_set1_ps(planes_[i].w);
+        }
+
+        for (size_t first = 0; first < count; first += 4)
+        {
+            size_t blockCount = std::min<size_t>(4, count - first);
+            __m128 x, y, z, r;
+            if (blockCount == 4)
+            {
+                x = _mm_loadu_ps(centerX + first);
+                y = _mm_loadu_ps(centerY + first);
+                z = _mm_loadu_ps(centerZ + first);
+                r = _mm_loadu_ps(radius + first);
+            }
+            else
+            {
+                // the last spheres are copied to a full block with a negative radius in the empty lanes
+                alignas(16) float block[4][4];
+                for (size_t lane = 0; lane < 4; lane++)
+                {
+                    bool used = lane < blockCount;
+                    block[0][lane] = used ? centerX[first + lane] : 0.0f;
+                    block[1][lane] = used ? centerY[first + lane] : 0.0f;
+                    block[2][lane] = used ? centerZ[first + lane] : 0.0f;
+                    block[3][lane] = used ? radius[first + lane] : -1.0f;
+                }
+                x = _mm_load_ps(block[0]);
+                y = _mm_load_ps(block[1]);
+                z = _mm_load_ps(block[2]);
+                r = _mm_load_ps(block[3]);
+            }
+
+            // a sphere is outside when it is behind any plane by more than its radius
+            __m128 inside = _mm_cmpge_ps(r, _mm_setzero_ps());
+            __m128 minusR = _mm_sub_ps(_mm_setzero_ps(), r);
+            for (int i = 0; i < 6; i++)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+                    _mm_mul_ps(x, planeX[i]), _mm_mul_ps(y, planeY[i])), _mm_mul_ps(z, planeZ[i])), planeW[i]);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, minusR));
+            }
+            int mask = _mm_movemask_ps(inside);
+            for (size_t lane = 0; lane < blockCount; lane++)
+            {
+                visible[first + lane] = (mask >> lane) & 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+
+using namespace DirectX;
+
+namespace mc
+{
+    // View frustum as six planes with the normals pointing inside
+    class Frustum
+    {
+    public:
+        Frustum();
+        // viewProj is view * proj, planes are in the space of the points the matrix transforms (usually world)
+        Frustum(const XMMATRIX& viewProj);
+
+        bool IntersectsSphere(FXMVECTOR center, float radius) const;
+        // Same test for count spheres in structure of arrays form, four at a time. visible[i] is 1 when sphere i
+        // touches the frustum, 0 otherwise. A negative radius is never visible.
+        void IntersectsSpheres(const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+            size_t count, unsigned char* visible) const;
+
+    private:
+        XMFLOAT4 planes_[6];
+    };
+}
@@ -5,7 +5,7 @@ using namespace DirectX;
 namespace mc
 {
     Game::Game()
-        : ship(XMFLOAT3(-2.5, 0.0125f, 0), 2.0f, 0.04f), currentCheckPoint(0)
+        : ship(XMFLOAT3(-2.5, 0.0125f, 0), 2.0f, 0.04f)
     {
         // Initialize the engine and get pointer to the main systems
         engine = std::make_unique<Engine>("Solar System Racing", windowWidth, windowHeight);
@@ -41,6 +41,9 @@ namespace mc
         gameTime = 0.0;
         timeScale = 1.0f;
 
+        previousShipPose = ship.GetPose();
+        shipPose = previousShipPose;
+
         // Set initial state
         gm->SetAlphaBlending();
         sm->Get("vert")->Bind(*gm);
@@ -52,6 +55,20 @@ namespace mc
         am->Start();
     }
 
+    void Game::RecordInput(const std::string& filepath)
+    {
+        inputLogPath = filepath;
+    }
+
+    void Game::ReplayInput(const std::string& filepath)
+    {
+        inputReplay = std::make_unique<InputLog>(filepath);
+        if (inputReplay->GetStepRate() != physicsRate)
+        {
+            throw std::runtime_error("Error input log recorded at " + std::to_string(inputReplay->GetStepRate()) + " Hz: " + filepath);
+        }
+    }
+
     void Game::Run()
     {
         while (engine->IsRunning())
@@ -70,13 +87,13 @@ namespace mc
             sm->HotReaload(*gm);
 
             // Process the ship and camera movement
-            UpdateShip(dt);
+            UpdatePhysics(dt);
 
             if (freeCamera)
             {
                 if (targetShip)
                 {
-                    camera->TargteShip(ship);
+                    camera->TargteShip(shipPose);
                 }
                 else
                 {
@@ -85,9 +102,12 @@ namespace mc
             }
             else
             {
-                camera->FollowShip(ship);
+                mc::CollisionData* collisionDataArray[] = {
+                    &collisionDataOuter,
+                    &collisionDataInner
+                };
+                camera->FollowShip(shipPose, collisionDataArray, 2);
             }
-            UpdateShipLapsAndTimes(dt);
 
             // update the pich of the ship engine sound and on the ship thrust
             am->Update(ship.GetThrust() / ship.GetThrustMax());
@@ -126,12 +146,20 @@ namespace mc
             lastCounter = currentCounter;
             gameTime += dt;
         }
+
+        if (!inputLogPath.empty())
+        {
+            inputLog.Save(inputLogPath);
+            std::cout << "Input log: " << inputLogPath << " " << inputLog.GetStepCount() << " steps\n";
+        }
     }
 
     void Game::LoadShaders()
     {
         // Init Shaders
         sm->AddVertexShader("vert", *gm, "assets/vertex/vert.hlsl");
+        sm->AddVertexShader("vertPacked", *gm, "assets/vertex/vertPacked.hlsl");
+        sm->AddVertexShader("vertPackedInstanced", *gm, "assets/vertex/vertPackedInstanced.hlsl");
         sm->AddVertexShader("fontVert", *gm, "assets/vertex/fontVert.hlsl");
         sm->AddPixelShader("fontPixel", *gm, "assets/pixel/fontPixel.hlsl");
         sm->AddPixelShader("postProcess", *gm, "assets/pixel/postProcess.hlsl");
@@ -207,6 +235,35 @@ namespace mc
         };
         IL = std::make_unique<InputLayout>(*gm, *(mc::VertexShader*)sm->Get("vert"), desc);
 
+        // create the input layout for the mc::PackedVertex meshes
+        mc::InputLayoutDesc packedDesc = {
+            {
+                {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+                {"NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,       0,  8, D3D11_INPUT_PER_VERTEX_DATA, 0},
+                {"TEXCOORD", 0, DXGI_FORMAT_R16G16_SNORM,       0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+                {"TEXCOORD", 1, DXGI_FORMAT_R16G16_FLOAT,       0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0}
+            },
+            4
+        };
+        packedIL = std::make_unique<InputLayout>(*gm, *(mc::VertexShader*)sm->Get("vertPacked"), packedDesc);
+
+        // the packed vertices and one mc::ObjectInstance per instance for the instanced scene nodes
+        mc::InputLayoutDesc packedInstancedDesc = {
+            {
+                {"POSITION",       0, DXGI_FORMAT_R16G16B16A16_UNORM, 0,  0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+                {"NORMAL",         0, DXGI_FORMAT_R16G16_SNORM,       0,  8, D3D11_INPUT_PER_VERTEX_DATA, 0},
+                {"TEXCOORD",       0, DXGI_FORMAT_R16G16_SNORM,       0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+                {"TEXCOORD",       1, DXGI_FORMAT_R16G16_FLOAT,       0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0},
+                {"MODEL",          0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1,  0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+                {"MODEL",          1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+                {"MODEL",          2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+                {"POSITIONSCALE",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+                {"POSITIONOFFSET", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1}
+            },
+            9
+        };
+        packedInstancedIL = std::make_unique<InputLayout>(*gm, *(mc::VertexShader*)sm->Get("vertPackedInstanced"), packedInstancedDesc);
+
         // create the input layout for the particle system
         mc::InputLayoutDesc particleILDesc = {
             {
@@ -228,47 +285,70 @@ namespace mc
         quadVB = std::make_unique<VertexBuffer>(*gm, quadData.vertices.data(), quadData.vertices.size(), sizeof(mc::Vertex));
         quadMesh = std::make_unique<Mesh>(*gm, quadVB.get(), IL.get(), nullptr, quadData.vertices.size(), false);
 
+        // The cached meshes are baked in the compressed vertex format, uploaded as mapped
+
         // Create track base
-        MeshData trackBaseData;
-        GeometryGenerator::LoadOBJFile(trackBaseData, "assets/mesh/track_base_tri.obj");
-        trackBaseVB = std::make_unique<VertexBuffer>(*gm, trackBaseData.vertices.data(), trackBaseData.vertices.size(), sizeof(mc::Vertex));
-        trackBaseMesh = std::make_unique<Mesh>(*gm, trackBaseVB.get(), IL.get(), nullptr, trackBaseData.vertices.size(), false);
+        MeshCache trackBaseData("assets/mesh/track_base_tri.obj");
+        trackBaseVB = std::make_unique<VertexBuffer>(*gm, trackBaseData.GetVertices(), trackBaseData.GetVertexCount(), sizeof(mc::PackedVertex));
+        trackBaseIB = std::make_unique<IndexBuffer>(*gm, trackBaseData.GetIndices(), trackBaseData.GetIndexCount());
+        trackBaseMesh = std::make_unique<Mesh>(*gm, trackBaseVB.get(), packedIL.get(), trackBaseIB.get(), trackBaseData.GetIndexCount(), true);
+        trackBaseMesh->SetLods(trackBaseData.GetLods(), trackBaseData.GetLodCount());
+        trackBaseMesh->SetBounds(trackBaseData.GetBounds());
+        trackBaseMesh->SetClusters(trackBaseData.GetClusters(), trackBaseData.GetClusterCount());
 
         // Create track inner
-        MeshData trackInnerData;
-        GeometryGenerator::LoadOBJFile(trackInnerData, "assets/mesh/track_inner_tri.obj");
-        trackInnerVB = std::make_unique<VertexBuffer>(*gm, trackInnerData.vertices.data(), trackInnerData.vertices.size(), sizeof(mc::Vertex));
-        trackInnerMesh = std::make_unique<Mesh>(*gm, trackInnerVB.get(), IL.get(), nullptr, trackInnerData.vertices.size(), false);
+        MeshCache trackInnerData("assets/mesh/track_inner_tri.obj");
+        trackInnerVB = std::make_unique<VertexBuffer>(*gm, trackInnerData.GetVertices(), trackInnerData.GetVertexCount(), sizeof(mc::PackedVertex));
+        trackInnerIB = std::make_unique<IndexBuffer>(*gm, trackInnerData.GetIndices(), trackInnerData.GetIndexCount());
+        trackInnerMesh = std::make_unique<Mesh>(*gm, trackInnerVB.get(), packedIL.get(), trackInnerIB.get(), trackInnerData.GetIndexCount(), true);
+        trackInnerMesh->SetLods(trackInnerData.GetLods(), trackInnerData.GetLodCount());
+        trackInnerMesh->SetBounds(trackInnerData.GetBounds());
+        trackInnerMesh->SetClusters(trackInnerData.GetClusters(), trackInnerData.GetClusterCount());
 
         // Create track outer
-        MeshData trackOuterData;
-        GeometryGenerator::LoadOBJFile(trackOuterData, "assets/mesh/track_outer_tri.obj");
-        trackOuterVB = std::make_unique<VertexBuffer>(*gm, trackOuterData.vertices.data(), trackOuterData.vertices.size(), sizeof(mc::Vertex));
-        trackOuterMesh = std::make_unique<Mesh>(*gm, trackOuterVB.get(), IL.get(), nullptr, trackOuterData.vertices.size(), false);
+        MeshCache trackOuterData("assets/mesh/track_outer_tri.obj");
+        trackOuterVB = std::make_unique<VertexBuffer>(*gm, trackOuterData.GetVertices(), trackOuterData.GetVertexCount(), sizeof(mc::PackedVertex));
+        trackOuterIB = std::make_unique<IndexBuffer>(*gm, trackOuterData.GetIndices(), trackOuterData.GetIndexCount());
+        trackOuterMesh = std::make_unique<Mesh>(*gm, trackOuterVB.get(), packedIL.get(), trackOuterIB.get(), trackOuterData.GetIndexCount(), true);
+        trackOuterMesh->SetLods(trackOuterData.GetLods(), trackOuterData.GetLodCount());
+        trackOuterMesh->SetBounds(trackOuterData.GetBounds());
+        trackOuterMesh->SetClusters(trackOuterData.GetClusters(), trackOuterData.GetClusterCount());
 
         // Create ship
-        MeshData shipData;
-        GeometryGenerator::LoadOBJFile(shipData, "assets/mesh/ship.obj");
-        shipVB = std::make_unique<VertexBuffer>(*gm, shipData.vertices.data(), shipData.vertices.size(), sizeof(mc::Vertex));
-        shipMesh = std::make_unique<Mesh>(*gm, shipVB.get(), IL.get(), nullptr, shipData.vertices.size(), false);
+        MeshCache shipData("assets/mesh/ship.obj");
+        shipVB = std::make_unique<VertexBuffer>(*gm, shipData.GetVertices(), shipData.GetVertexCount(), sizeof(mc::PackedVertex));
+        shipIB = std::make_unique<IndexBuffer>(*gm, shipData.GetIndices(), shipData.GetIndexCount());
+        shipMesh = std::make_unique<Mesh>(*gm, shipVB.get(), packedIL.get(), shipIB.get(), shipData.GetIndexCount(), true);
+        shipMesh->SetLods(shipData.GetLods(), shipData.GetLodCount());
+        shipMesh->SetBounds(shipData.GetBounds());
+        shipMesh->SetClusters(shipData.GetClusters(), shipData.GetClusterCount());
 
         // Create planets
-        MeshData planetData;
-        GeometryGenerator::LoadOBJFile(planetData, "assets/mesh/planet.obj");
-        planetVB = std::make_unique<VertexBuffer>(*gm, planetData.vertices.data(), planetData.vertices.size(), sizeof(mc::Vertex));
-        planetMesh = std::make_unique<Mesh>(*gm, planetVB.get(), IL.get(), nullptr, planetData.vertices.size(), false);
+        MeshCache planetData("assets/mesh/planet.obj");
+        planetVB = std::make_unique<VertexBuffer>(*gm, planetData.GetVertices(), planetData.GetVertexCount(), sizeof(mc::PackedVertex));
+        planetIB = std::make_unique<IndexBuffer>(*gm, planetData.GetIndices(), planetData.GetIndexCount());
+        planetMesh = std::make_unique<Mesh>(*gm, planetVB.get(), packedIL.get(), planetIB.get(), planetData.GetIndexCount(), true);
+        planetMesh->SetLods(planetData.GetLods(), planetData.GetLodCount());
+        planetMesh->SetBounds(planetData.GetBounds());
+        planetMesh->SetClusters(planetData.GetClusters(), planetData.GetClusterCount());
 
         // Create meta
-        MeshData metaData;
-        GeometryGenerator::LoadOBJFile(metaData, "assets/mesh/meta.obj");
-        metaVB = std::make_unique<VertexBuffer>(*gm, metaData.vertices.data(), metaData.vertices.size(), sizeof(mc::Vertex));
-        metaMesh = std::make_unique<Mesh>(*gm, metaVB.get(), IL.get(), nullptr, metaData.vertices.size(), false);
+        MeshCache metaData("assets/mesh/meta.obj");
+        metaVB = std::make_unique<VertexBuffer>(*gm, metaData.GetVertices(), metaData.GetVertexCount(), sizeof(mc::PackedVertex));
+        metaIB = std::make_unique<IndexBuffer>(*gm, metaData.GetIndices(), metaData.GetIndexCount());
+        metaMesh = std::make_unique<Mesh>(*gm, metaVB.get(), packedIL.get(), metaIB.get(), metaData.GetIndexCount(), true);
+        metaMesh->SetLods(metaData.GetLods(), metaData.GetLodCount());
+        metaMesh->SetBounds(metaData.GetBounds());
+        metaMesh->SetClusters(metaData.GetClusters(), metaData.GetClusterCount());
 
         // Create postes
-        MeshData postesData;
-        GeometryGenerator::LoadOBJFile(postesData, "assets/mesh/postes.obj");
-        postesVB = std::make_unique<VertexBuffer>(*gm, postesData.vertices.data(), postesData.vertices.size(), sizeof(mc::Vertex));
-        postesMesh = std::make_unique<Mesh>(*gm, postesVB.get(), IL.get(), nullptr, postesData.vertices.size(), false);
+        MeshCache postesData("assets/mesh/postes.obj");
+        postesVB = std::make_unique<VertexBuffer>(*gm, postesData.GetVertices(), postesData.GetVertexCount(), sizeof(mc::PackedVertex));
+        postesIB = std::make_unique<IndexBuffer>(*gm, postesData.GetIndices(), postesData.GetIndexCount());
+        postesMesh = std::make_unique<Mesh>(*gm, postesVB.get(), packedIL.get(), postesIB.get(), postesData.GetIndexCount(), true);
+        postesMesh->SetLods(postesData.GetLods(), postesData.GetLodCount());
+        postesMesh->SetBounds(postesData.GetBounds());
+        postesMesh->SetClusters(postesData.GetClusters(), postesData.GetClusterCount());
 
     }
 
@@ -276,6 +356,11 @@ namespace mc
     {
         GeometryGenerator::LoadCollisionDataFromOBJFile(collisionDataOuter, "assets/mesh/track_outer_col.obj");
         GeometryGenerator::LoadCollisionDataFromOBJFile(collisionDataInner, "assets/mesh/track_inner_col.obj");
+
+        // the finish line crosses the track at x = 0 on the +z side, the race goes towards +x there
+        trackSpline.Bake(collisionDataInner, collisionDataOuter,
+            XMVectorSet(0.0f, 0.0f, 1.6f, 0.0f), XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), 8);
+        std::cout << "Track centerline: " << trackSpline.GetLength() << " long, " << trackSpline.GetSegmentCount() << " segments\n";
     }
 
     void Game::LoadFrameBuffers()
@@ -289,12 +374,14 @@ namespace mc
     {
         // Initlializa the scene
         scene = std::make_unique<Scene>(&objectCPUBuffer, objectGPUBuffer.get());
+        // every node with a packed mesh is drawn instanced, nodes that share a mesh and material take one draw
+        scene->SetInstancedVertexShader((VertexShader*)sm->Get("vertPacked"), (VertexShader*)sm->Get("vertPackedInstanced"), packedInstancedIL.get());
 
         // Create Ship
         shipNode = &scene->AddNode();
         shipNode->SetMesh(shipMesh.get());
         shipNode->SetTexture(shipTexture.get());
-        shipNode->SetVertexShader((VertexShader*)sm->Get("vert"));
+        shipNode->SetVertexShader((VertexShader*)sm->Get("vertPacked"));
         shipNode->SetPixelShader((PixelShader*)sm->Get("ship"));
         shipNode->SetPosition(ship.GetPosition().x, ship.GetPosition().y, ship.GetPosition().z);
         shipNode->SetScale(0.0125f * 0.5f, 0.0125f * 0.5f, 0.0125f * 0.5f);
@@ -302,7 +389,7 @@ namespace mc
         // Create meta
         mc::SceneNode& meta = scene->AddNode();
         meta.SetMesh(metaMesh.get());
-        meta.SetVertexShader((VertexShader*)sm->Get("vert"));
+        meta.SetVertexShader((VertexShader*)sm->Get("vertPacked"));
         meta.SetPixelShader((PixelShader*)sm->Get("meta"));
         meta.SetPosition(0, 0, 0);
         meta.SetScale(1.0f, 1.0f, 1.0f);
@@ -310,7 +397,7 @@ namespace mc
         // Create postes
         mc::SceneNode& postes = scene->AddNode();
         postes.SetMesh(postesMesh.get());
-        postes.SetVertexShader((VertexShader*)sm->Get("vert"));
+        postes.SetVertexShader((VertexShader*)sm->Get("vertPacked"));
         postes.SetPixelShader((PixelShader*)sm->Get("postes"));
         postes.SetPosition(0, 0, 0);
         postes.SetScale(1.0f, 1.0f, 1.0f);
@@ -318,7 +405,7 @@ namespace mc
         // Create sun
         sun = &scene->AddNode();
         sun->SetMesh(planetMesh.get());
-        sun->SetVertexShader((VertexShader*)sm->Get("vert"));
+        sun->SetVertexShader((VertexShader*)sm->Get("vertPacked"));
         sun->SetPixelShader((PixelShader*)sm->Get("sun"));
         sun->SetPosition(0, 10, 40);
         sun->SetScale(10, 10, 10);
@@ -326,7 +413,7 @@ namespace mc
         // Create the earth
         mc::SceneNode& earth = scene->AddNode();
         earth.SetMesh(planetMesh.get());
-        earth.SetVertexShader((VertexShader*)sm->Get("vert"));
+        earth.SetVertexShader((VertexShader*)sm->Get("vertPacked"));
         earth.SetPixelShader((PixelShader*)sm->Get("earth"));
         earth.SetPosition(0, -20.5, 0);
         earth.SetScale(20, 20, 20);
@@ -334,7 +421,7 @@ namespace mc
         // Create the mars
         mc::SceneNode& mars = scene->AddNode();
         mars.SetMesh(planetMesh.get());
-        mars.SetVertexShader((VertexShader*)sm->Get("vert"));
+        mars.SetVertexShader((VertexShader*)sm->Get("vertPacked"));
         mars.SetPixelShader((PixelShader*)sm->Get("mars"));
         mars.SetPosition(40, 0, 30);
         mars.SetScale(10, 10, 10);
@@ -343,7 +430,7 @@ namespace mc
         mc::SceneNode& jupiter = scene->AddNode();
         jupiter.SetMesh(planetMesh.get());
         jupiter.SetTexture(jupiterTexture.get());
-        jupiter.SetVertexShader((VertexShader*)sm->Get("vert"));
+        jupiter.SetVertexShader((VertexShader*)sm->Get("vertPacked"));
         jupiter.SetPixelShader((PixelShader*)sm->Get("jupiter"));
         jupiter.SetPosition(-80, 0, 0);
         jupiter.SetScale(20, 20, 20);
@@ -352,7 +439,7 @@ namespace mc
         mc::SceneNode& saturn = jupiter.AddNode();
         saturn.SetMesh(planetMesh.get());
         saturn.SetTexture(saturnTexture.get());
-        saturn.SetVertexShader((VertexShader*)sm->Get("vert"));
+        saturn.SetVertexShader((VertexShader*)sm->Get("vertPacked"));
         saturn.SetPixelShader((PixelShader*)sm->Get("saturn"));
         saturn.SetPosition(-20, 15, -20);
         saturn.SetScale(10, 10, 10);
@@ -364,27 +451,30 @@ namespace mc
         // Create track base
         mc::SceneNode& trackBase = scene->AddNode();
         trackBase.SetMesh(trackBaseMesh.get());
-        trackBase.SetVertexShader((VertexShader*)sm->Get("vert"));
+        trackBase.SetVertexShader((VertexShader*)sm->Get("vertPacked"));
         trackBase.SetPixelShader((PixelShader*)sm->Get("trackBase"));
         trackBase.SetPosition(0, 0, 0);
         trackBase.SetScale(1, 1, 1);
+        trackBase.SetTranslucent(true);
 
         // Create track inner
         mc::SceneNode& trackInner = scene->AddNode();
         trackInner.SetMesh(trackInnerMesh.get());
-        trackInner.SetVertexShader((VertexShader*)sm->Get("vert"));
+        trackInner.SetVertexShader((VertexShader*)sm->Get("vertPacked"));
         trackInner.SetPixelShader((PixelShader*)sm->Get("trackRail"));
         trackInner.SetPosition(0, 0, 0);
         trackInner.SetScale(1, 1, 1);
+        trackInner.SetTranslucent(true);
         trackInner.SetCullBack(false);
 
         // Create track outer
         mc::SceneNode& trackOuter = scene->AddNode();
         trackOuter.SetMesh(trackOuterMesh.get());
-        trackOuter.SetVertexShader((VertexShader*)sm->Get("vert"));
+        trackOuter.SetVertexShader((VertexShader*)sm->Get("vertPacked"));
         trackOuter.SetPixelShader((PixelShader*)sm->Get("trackRail"));
         trackOuter.SetPosition(0, 0, 0);
         trackOuter.SetScale(1, 1, 1);
+        trackOuter.SetTranslucent(true);
         trackOuter.SetCullBack(false);
     }
 
@@ -431,72 +521,70 @@ namespace mc
         }
     }
 
-    void Game::UpdateShip(float dt)
+    ShipInput Game::ReadShipInput() const
     {
-        // Pass the collision information to the ship update
-        mc::CollisionData* collisionDataArray[] = {
-            &collisionDataOuter,
-            &collisionDataInner
-        };
-        ship.Update(*im, dt, collisionDataArray, 2);
-        // Update the ShipNode of the scene to render it in the new location and orientation
-        shipNode->SetRotation(ship.GetOrientation());
-        XMFLOAT3 shipPos = ship.GetPosition();
-        shipNode->SetPosition(shipPos.x, shipPos.y, shipPos.z);
+        ShipInput input;
+        input.left = im->KeyDown(mc::KEY_A);
+        input.right = im->KeyDown(mc::KEY_D);
+        input.thrust = im->KeyDown(mc::KEY_W);
+        return input;
     }
 
-    void Game::UpdateShipLapsAndTimes(float dt)
+    void Game::UpdatePhysics(float dt)
     {
-        static float checkpoints[8] = {
-            0.0f, 45.0f, 90.0f, 135.0f, 180.0f, 225.0f, 270.0f, 315.0f 
-        };
-
-        XMFLOAT3 shipPos = ship.GetPosition();
-        XMFLOAT3 trackCenter = XMFLOAT3(0.0f, shipPos.y, 0.0f);
-        XMFLOAT2 shipRel(shipPos.x - trackCenter.x, shipPos.z - trackCenter.z);
-        float len = std::sqrtf(shipRel.x * shipRel.x + shipRel.y * shipRel.y);
-        shipRel.x /= len;
-        shipRel.y /= len;
-        float angle = (std::atan2f(shipRel.x, shipRel.y) / XM_PI) * 180.0f;
-        if (angle < 0.0f)
-        {
-            angle += 360.0f;
-        }
-        for (int i = 0; i < 7; i++)
+        // the keyboard is read once per frame and used by all the steps of the frame
+        const ShipInput keyboardInput = ReadShipInput();
+        const double step = 1.0 / physicsRate;
+        physicsTime += dt;
+        unsigned int steps = 0;
+        while (physicsTime >= step && steps < maxPhysicsSteps)
         {
-            float a = checkpoints[i + 0];
-            float b = checkpoints[i + 1];
-            if (angle >= a && angle <= b)
+            ShipInput input = keyboardInput;
+            if (inputReplay && !inputReplay->Next(input))
             {
-                if ((currentCheckPoint == i) && (lastFrameAngle < angle))
-                {
-                    currentCheckPoint = i + 1;
-
-                    if (!lapsStart)
-                    {
-                        lapsStart = true;
-                    }
-                }
-
-                if ((i == 0) && (currentCheckPoint == 7))
-                {
-                    currentCheckPoint = 0;
-                    lastLapTime = currentLapTime;
-                    if ((currentLapTime < bestLapTime) || firstLap)
-                    {
-                        bestLapTime = currentLapTime;
-                        firstLap = false;
-                    }
-                    currentLapTime = 0.0f;
-                }
+                XMFLOAT3 shipPos = ship.GetPosition();
+                std::cout << "Input replay done: " << inputReplay->GetStepCount() << " steps, ship at "
+                    << shipPos.x << " " << shipPos.y << " " << shipPos.z << "\n";
+                inputReplay.reset();
+                input = keyboardInput;
+            }
+            if (!inputLogPath.empty())
+            {
+                inputLog.Record(input);
             }
-        }
-        lastFrameAngle = angle;
 
-        if (lapsStart)
+            previousShipPose = ship.GetPose();
+            UpdateShip(input, static_cast<float>(step));
+            UpdateShipLapsAndTimes(static_cast<float>(step));
+            physicsTime -= step;
+            steps++;
+        }
+        if (steps == maxPhysicsSteps)
         {
-            currentLapTime += dt;
+            physicsTime = std::min(physicsTime, step);
         }
+
+        // Update the ShipNode of the scene to render it between the last two steps
+        shipPose = ShipPose::Lerp(previousShipPose, ship.GetPose(), static_cast<float>(physicsTime / step));
+        shipNode->SetRotation(shipPose.orientation);
+        XMFLOAT3 shipPos;
+        XMStoreFloat3(&shipPos, shipPose.position);
+        shipNode->SetPosition(shipPos.x, shipPos.y, shipPos.z);
+    }
+
+    void Game::UpdateShip(const ShipInput& input, float dt)
+    {
+        // Pass the collision information to the ship update
+        mc::CollisionData* collisionDataArray[] = {
+            &collisionDataOuter,
+            &collisionDataInner
+        };
+        ship.Update(input, dt, collisionDataArray, 2);
+    }
+
+    void Game::UpdateShipLapsAndTimes(float dt)
+    {
+        lapTracker.Update(ship.GetPosition(), dt);
     }
 
     void Game::UpdateConstBuffers(float dt, float fov)
@@ -512,6 +600,8 @@ namespace mc
         cameraCPUBuffer.proj = XMMatrixPerspectiveFovLH(fov, camera->GetAspectRatio(), camera->GetNearPlane(), camera->GetFarPlane());
         cameraCPUBuffer.viewPos = camera->GetPosition();
         cameraGPUBuffer->Update(*gm, cameraCPUBuffer);
+        scene->SetLodView(camera->GetPosition(), fov, static_cast<float>(windowHeight));
+        scene->SetFrustum(cameraCPUBuffer.view * cameraCPUBuffer.proj);
 
         XMVECTOR sunWorld = XMVector4Transform(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), sun->GetModelMatrix());
         XMVECTOR sunView = XMVector4Transform(sunWorld, cameraCPUBuffer.view);
@@ -555,10 +645,12 @@ namespace mc
     {
         // Update the particle system
         XMFLOAT3 emitDir;
-        XMStoreFloat3(&emitDir, ship.GetForward() * -1.0);
+        XMStoreFloat3(&emitDir, shipPose.forward * -1.0);
         XMFLOAT3 startVel;
         XMStoreFloat3(&startVel, ship.GetVelocity());
-        particleSystem->Update(ship.GetPosition(), startVel, emitDir, camera->GetPosition(), gameTime, dt, ship.GetThrust() / ship.GetThrustMax());
+        XMFLOAT3 emitPos;
+        XMStoreFloat3(&emitPos, shipPose.position);
+        particleSystem->Update(emitPos, startVel, emitDir, camera->GetPosition(), gameTime, dt, ship.GetThrust() / ship.GetThrustMax());
     }
 
 
@@ -677,9 +769,18 @@ namespace mc
     {
         // Draw text
         text->Write(*gm, "FPS: " + std::to_string((int)(1.0f / dt)), -windowWidth * 0.5f, windowHeight * 0.5, 7 * 2, 9 * 2);
-        text->Write(*gm, "Current Lap Time: " + std::to_string(currentLapTime), -windowWidth * 0.5f, (windowHeight * 0.5) - 9 * 2, 7 * 2, 9 * 2);
-        text->Write(*gm, "Last Lap Time   : " + std::to_string(lastLapTime), -windowWidth * 0.5f, (windowHeight * 0.5) - (9*2) * 2, 7 * 2, 9 * 2);
-        text->Write(*gm, "Best Lap Time   : " + std::to_string(bestLapTime), -windowWidth * 0.5f, (windowHeight * 0.5) - (9*3) * 2, 7 * 2, 9 * 2);
+        text->Write(*gm, "Current Lap Time: " + std::to_string(lapTracker.GetCurrentLapTime()), -windowWidth * 0.5f, (windowHeight * 0.5) - 9 * 2, 7 * 2, 9 * 2);
+        text->Write(*gm, "Last Lap Time   : " + std::to_string(lapTracker.GetLastLapTime()), -windowWidth * 0.5f, (windowHeight * 0.5) - (9*2) * 2, 7 * 2, 9 * 2);
+        text->Write(*gm, "Best Lap Time   : " + std::to_string(lapTracker.GetBestLapTime()), -windowWidth * 0.5f, (windowHeight * 0.5) - (9*3) * 2, 7 * 2, 9 * 2);
+        text->Write(*gm, "Lap Progress    : " + std::to_string((int)(lapTracker.GetLapProgress() * 100.0f)) + "%", -windowWidth * 0.5f, (windowHeight * 0.5) - (9*4) * 2, 7 * 2, 9 * 2);
+        const SceneCullStats& nodeCullStats = scene->GetNodeCullStats();
+        text->Write(*gm, "Nodes Drawn     : " + std::to_string(nodeCullStats.testedNodes - nodeCullStats.culledNodes) + "/" + std::to_string(nodeCullStats.testedNodes) + " in " + std::to_string(scene->GetDrawCount()) + " draws", -windowWidth * 0.5f, (windowHeight * 0.5) - (9*5) * 2, 7 * 2, 9 * 2);
+        const RenderStateStats& stateStats = gm->GetStateStats();
+        text->Write(*gm, "State Calls     : " + std::to_string(stateStats.issuedCalls) + " issued " + std::to_string(stateStats.filteredCalls) + " filtered", -windowWidth * 0.5f, (windowHeight * 0.5) - (9*6) * 2, 7 * 2, 9 * 2);
+        if (lapTracker.IsWrongWay())
+        {
+            text->Write(*gm, "WRONG WAY", -7 * 9 * 2, 0.0f, 7 * 4, 9 * 4);
+        }
         text->Render(*gm);
         // reset the default vertex shader after text rendering
         sm->Get("vert")->Bind(*gm);
@@ -8,6 +8,8 @@
 #include "Engine.h"
 
 #include "Ship.h"
+#include "InputLog.h"
+#include "LapTracker.h"
 #include "Scene.h"
 
 namespace mc
@@ -16,6 +18,10 @@ namespace mc
     {
     public:
         Game();
+        // the inputs of the run are written to filepath when Run returns
+        void RecordInput(const std::string& filepath);
+        // the ship is driven by the steps of the log until it runs out, then by the keyboard
+        void ReplayInput(const std::string& filepath);
         void Run();
     private:
         void LoadShaders();
@@ -28,7 +34,9 @@ namespace mc
         void LoadScene();
 
         void ProcessGameMode(float dt);
-        void UpdateShip(float dt);
+        ShipInput ReadShipInput() const;
+        void UpdatePhysics(float dt);
+        void UpdateShip(const ShipInput& input, float dt);
         void UpdateShipLapsAndTimes(float dt);
         void UpdateConstBuffers(float dt, float fov);
         void UpdateParticleSystem(float dt);
@@ -74,29 +82,40 @@ namespace mc
 
         // Input layouts
         std::unique_ptr<InputLayout> IL;
+        std::unique_ptr<InputLayout> packedIL;
+        std::unique_ptr<InputLayout> packedInstancedIL;
         std::unique_ptr<InputLayout> particleIL;
 
         // Geometry
         std::unique_ptr<VertexBuffer> quadVB;
         std::unique_ptr<Mesh> quadMesh;
         std::unique_ptr<VertexBuffer> trackBaseVB;
+        std::unique_ptr<IndexBuffer> trackBaseIB;
         std::unique_ptr<Mesh> trackBaseMesh;
         std::unique_ptr<VertexBuffer> trackInnerVB;
+        std::unique_ptr<IndexBuffer> trackInnerIB;
         std::unique_ptr<Mesh> trackInnerMesh;
         std::unique_ptr<VertexBuffer> trackOuterVB;
+        std::unique_ptr<IndexBuffer> trackOuterIB;
         std::unique_ptr<Mesh> trackOuterMesh;
         std::unique_ptr<VertexBuffer> shipVB;
+        std::unique_ptr<IndexBuffer> shipIB;
         std::unique_ptr<Mesh> shipMesh;
         std::unique_ptr<VertexBuffer> planetVB;
+        std::unique_ptr<IndexBuffer> planetIB;
         std::unique_ptr<Mesh> planetMesh;
         std::unique_ptr<VertexBuffer> metaVB;
+        std::unique_ptr<IndexBuffer> metaIB;
         std::unique_ptr<Mesh> metaMesh;
         std::unique_ptr<VertexBuffer> postesVB;
+        std::unique_ptr<IndexBuffer> postesIB;
         std::unique_ptr<Mesh> postesMesh;
 
         // Collision Geometry
         CollisionData collisionDataOuter;
         CollisionData collisionDataInner;
+        // centerline of the track for the lap progress, baked from the rails
+        TrackSpline trackSpline;
 
         // Frame buffers
         std::unique_ptr<FrameBuffer> msaaBuffer;
@@ -111,6 +130,17 @@ namespace mc
         SceneNode* shipNode;
         SceneNode* sun;
 
+        // Fixed step physics, after a long frame the time above maxPhysicsSteps is dropped
+        const unsigned int physicsRate{ 120 };
+        const unsigned int maxPhysicsSteps{ 8 };
+        double physicsTime{ 0.0 };
+        ShipPose previousShipPose;
+        // ship pose interpolated between the last two steps, used for everything drawn
+        ShipPose shipPose;
+        InputLog inputLog{ physicsRate };
+        std::string inputLogPath;
+        std::unique_ptr<InputLog> inputReplay;
+
         // Clock
         LARGE_INTEGER lastCounter;
         LARGE_INTEGER frequency;
@@ -118,15 +148,7 @@ namespace mc
         float timeScale{ 1.0f };
 
         // Gameplay
-        unsigned int currentCheckPoint{ 0 };
-        float lastFrameAngle{-1.0f};
-
-        double currentLapTime{0};
-        double lastLapTime{0};
-        double bestLapTime{0};
-
-        bool lapsStart{ false };
-        bool firstLap{ true };
+        LapTracker lapTracker{ trackSpline };
 
         bool freeCamera{ false };
         bool targetShip{false};
@@ -9,7 +9,17 @@ namespace mc
     struct ObjectConstBuffer
     {
         XMMATRIX model;
-
+        // dequantization of PackedVertex positions: bounds.max - bounds.min and bounds.min of the mesh
+        XMFLOAT4 positionScale;
+        XMFLOAT4 positionOffset;
+    };
+    // per instance vertex data of vertPackedInstanced.hlsl, the same as ObjectConstBuffer for one instance
+    struct ObjectInstance
+    {
+        // the first three rows of the transposed model matrix, the last one is always 0 0 0 1
+        XMFLOAT4 model[3];
+        XMFLOAT4 positionScale;
+        XMFLOAT4 positionOffset;
     };
     struct CameraConstBuffer
     {
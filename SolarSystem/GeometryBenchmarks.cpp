@@ -0,0 +1,657 @@
+#include "GeometryBenchmarks.h"
+#include "ClusterCuller.h"
+#include "GeometryGenerator.h"
+#include "MeshClusterizer.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ObjParser.h"
+#include "TrackSpline.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
+namespace mc
+{
+    namespace
+    {
+        // the buffer of all the files repeated, big enough to be split in chunks by ObjParser
+        const size_t chunkedParseSize = 4 * 1024 * 1024;
+        // the old geosphere has half a million vertices at level 7, the new one is timed a bit further
+        const unsigned int legacySubdivisions = 7;
+        const unsigned int geosphereSubdivisions = 9;
+        // the defaults of BuildLodChain, the ones MeshCache uses
+        const float lodReduction = 0.5f;
+        const float lodMaxError = 0.05f;
+        // the deviation is measured again here, only the rounding of the two sums can differ
+        const float lodErrorTolerance = 1e-5f;
+        // the chase camera of the game at rest: fovMin, the window aspect and the planes of its Camera
+        const unsigned int cullFrames = 1000;
+        const float cullFov = (60.0f / 180.0f) * XM_PI;
+        const float cullAspect = 1920.0f / 1080.0f;
+        const float cullNearPlane = 0.01f;
+        const float cullFarPlane = 100.0f;
+
+        // a node of Game::LoadScene with a clustered mesh, the ship is left out as the camera always looks at it
+        struct CullNode
+        {
+            const char* name;
+            const char* file;
+            XMFLOAT3 position;
+            float scale;
+            bool cullBack;
+        };
+
+        const CullNode cullNodes[] = {
+            { "meta", "meta.obj", XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0f, true },
+            { "postes", "postes.obj", XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0f, true },
+            { "sun", "planet.obj", XMFLOAT3(0.0f, 10.0f, 40.0f), 10.0f, true },
+            { "earth", "planet.obj", XMFLOAT3(0.0f, -20.5f, 0.0f), 20.0f, true },
+            { "mars", "planet.obj", XMFLOAT3(40.0f, 0.0f, 30.0f), 10.0f, true },
+            { "jupiter", "planet.obj", XMFLOAT3(-80.0f, 0.0f, 0.0f), 20.0f, true },
+            { "saturn", "planet.obj", XMFLOAT3(-100.0f, 15.0f, -20.0f), 10.0f, true },
+            { "track base", "track_base_tri.obj", XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0f, true },
+            { "track inner", "track_inner_tri.obj", XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0f, false },
+            { "track outer", "track_outer_tri.obj", XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0f, false }
+        };
+
+        std::vector<std::string> FindFiles(const std::string& directory, const std::string& extension)
+        {
+            std::vector<std::string> files;
+            for (const auto& entry : std::filesystem::directory_iterator(directory))
+            {
+                if (entry.path().extension() == extension)
+                {
+                    files.push_back(entry.path().string());
+                }
+            }
+            std::sort(files.begin(), files.end());
+            return files;
+        }
+
+        bool SameFloat(float value, float expected)
+        {
+            // the parser adds the digits up itself, it can be an ulp or two away from strtof
+            return std::fabs(value - expected) <= 1e-6f * std::max(1.0f, std::fabs(expected));
+        }
+
+        // Parses the text line by line with strtof like the loader did before ObjParser and counts what
+        // differs in objData. Only the attributes and the face sizes are compared, not the indices.
+        size_t CountParseErrors(const ObjData& objData, const std::string& text)
+        {
+            size_t errors = 0;
+            size_t positions = 0;
+            size_t normals = 0;
+            size_t uvs = 0;
+            size_t faces = 0;
+            std::istringstream stream(text);
+            std::string line;
+            while (std::getline(stream, line))
+            {
+                const char* p = line.c_str();
+                float values[3] = {};
+                size_t count = 0;
+                if (line.compare(0, 2, "v ") == 0 || line.compare(0, 3, "vn ") == 0 || line.compare(0, 3, "vt ") == 0)
+                {
+                    p += line[1] == ' ' ? 2 : 3;
+                    for (char* next = nullptr; count < 3; count++, p = next)
+                    {
+                        values[count] = std::strtof(p, &next);
+                        if (next == p)
+                        {
+                            break;
+                        }
+                    }
+                }
+                if (line.compare(0, 2, "v ") == 0)
+                {
+                    const XMFLOAT3* position = positions < objData.positions.size() ? &objData.positions[positions] : nullptr;
+                    errors += !position || !SameFloat(position->x, values[0]) || !SameFloat(position->y, values[1]) ||
+                        !SameFloat(position->z, values[2]) ? 1 : 0;
+                    ++positions;
+                }
+                else if (line.compare(0, 3, "vn ") == 0)
+                {
+                    const XMFLOAT3* normal = normals < objData.normals.size() ? &objData.normals[normals] : nullptr;
+                    errors += !normal || !SameFloat(normal->x, values[0]) || !SameFloat(normal->y, values[1]) ||
+                        !SameFloat(normal->z, values[2]) ? 1 : 0;
+                    ++normals;
+                }
+                else if (line.compare(0, 3, "vt ") == 0)
+                {
+                    const XMFLOAT2* uv = uvs < objData.uvs.size() ? &objData.uvs[uvs] : nullptr;
+                    errors += !uv || !SameFloat(uv->x, values[0]) || !SameFloat(uv->y, values[1]) ? 1 : 0;
+                    ++uvs;
+                }
+                else if (line.compare(0, 2, "f ") == 0)
+                {
+                    std::istringstream corners(line.substr(2));
+                    std::string corner;
+                    size_t cornerCount = 0;
+                    while (corners >> corner)
+                    {
+                        ++cornerCount;
+                    }
+                    errors += faces >= objData.faceSizes.size() || objData.faceSizes[faces] != cornerCount ? 1 : 0;
+                    ++faces;
+                }
+            }
+            errors += positions != objData.positions.size() ? 1 : 0;
+            errors += normals != objData.normals.size() ? 1 : 0;
+            errors += uvs != objData.uvs.size() ? 1 : 0;
+            errors += faces != objData.faceSizes.size() ? 1 : 0;
+            return errors;
+        }
+
+        // The subdivision GenerateGeosphere used before the midpoints were shared: it copies the mesh and
+        // emits six vertices per triangle.
+        void LegacySubdivide(MeshData& meshData)
+        {
+            MeshData inputCopy = meshData;
+            meshData.vertices.resize(0);
+            meshData.indices.resize(0);
+
+            unsigned int numTris = static_cast<unsigned int>(inputCopy.indices.size() / 3);
+            for (unsigned int i = 0; i < numTris; ++i)
+            {
+                Vertex v0 = inputCopy.vertices[inputCopy.indices[i * 3 + 0]];
+                Vertex v1 = inputCopy.vertices[inputCopy.indices[i * 3 + 1]];
+                Vertex v2 = inputCopy.vertices[inputCopy.indices[i * 3 + 2]];
+
+                Vertex m0, m1, m2;
+                m0.position = XMFLOAT3(
+                    0.5f * (v0.position.x + v1.position.x),
+                    0.5f * (v0.position.y + v1.position.y),
+                    0.5f * (v0.position.z + v1.position.z));
+                m1.position = XMFLOAT3(
+                    0.5f * (v1.position.x + v2.position.x),
+                    0.5f * (v1.position.y + v2.position.y),
+                    0.5f * (v1.position.z + v2.position.z));
+                m2.position = XMFLOAT3(
+                    0.5f * (v0.position.x + v2.position.x),
+                    0.5f * (v0.position.y + v2.position.y),
+                    0.5f * (v0.position.z + v2.position.z));
+
+                meshData.vertices.push_back(v0);
+                meshData.vertices.push_back(v1);
+                meshData.vertices.push_back(v2);
+                meshData.vertices.push_back(m0);
+                meshData.vertices.push_back(m1);
+                meshData.vertices.push_back(m2);
+
+                const unsigned int corners[12] = { 0, 3, 5,  3, 4, 5,  5, 4, 2,  3, 1, 4 };
+                for (unsigned int corner : corners)
+                {
+                    meshData.indices.push_back(i * 6 + corner);
+                }
+            }
+        }
+
+        // GenerateGeosphere before the midpoints were shared, with its scalar projection and attributes
+        void LegacyGeosphere(float radius, unsigned int numSubdivisions, MeshData& meshData)
+        {
+            const float X = 0.525731f;
+            const float Z = 0.850651f;
+            const XMFLOAT3 pos[12] =
+            {
+                XMFLOAT3(-X, 0.0f, Z),  XMFLOAT3(X, 0.0f, Z),
+                XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),
+                XMFLOAT3(0.0f, Z, X),   XMFLOAT3(0.0f, Z, -X),
+                XMFLOAT3(0.0f, -Z, X),  XMFLOAT3(0.0f, -Z, -X),
+                XMFLOAT3(Z, X, 0.0f),   XMFLOAT3(-Z, X, 0.0f),
+                XMFLOAT3(Z, -X, 0.0f),  XMFLOAT3(-Z, -X, 0.0f)
+            };
+            const unsigned int k[60] =
+            {
+                1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,
+                1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,
+                3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
+                10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
+            };
+            meshData.vertices.assign(12, Vertex{});
+            for (unsigned int i = 0; i < 12; ++i)
+            {
+                meshData.vertices[i].position = pos[i];
+            }
+            meshData.indices.assign(k, k + 60);
+            for (unsigned int i = 0; i < numSubdivisions; ++i)
+            {
+                LegacySubdivide(meshData);
+            }
+
+            for (Vertex& vertex : meshData.vertices)
+            {
+                XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&vertex.position));
+                XMStoreFloat3(&vertex.position, XMVectorScale(n, radius));
+                XMStoreFloat3(&vertex.normal, n);
+
+                // the angle of AngleFromXY, in [0, 2*pi)
+                float theta = atan2f(vertex.position.z, vertex.position.x);
+                theta = theta < 0.0f ? theta + XM_2PI : theta;
+                float phi = acosf(vertex.position.y / radius);
+                vertex.uv.x = theta / XM_2PI;
+                vertex.uv.y = phi / XM_PI;
+
+                vertex.tangent.x = -radius * sinf(phi) * sinf(theta);
+                vertex.tangent.y = 0.0f;
+                vertex.tangent.z = +radius * sinf(phi) * cosf(theta);
+                XMStoreFloat3(&vertex.tangent, XMVector3Normalize(XMLoadFloat3(&vertex.tangent)));
+            }
+        }
+
+        // the corners the old geosphere duplicated are bitwise equal, the new one should have made each only once
+        size_t CountDistinctPositions(const MeshData& meshData)
+        {
+            std::vector<std::tuple<float, float, float>> positions;
+            positions.reserve(meshData.vertices.size());
+            for (const Vertex& vertex : meshData.vertices)
+            {
+                positions.emplace_back(vertex.position.x, vertex.position.y, vertex.position.z);
+            }
+            std::sort(positions.begin(), positions.end());
+            return std::unique(positions.begin(), positions.end()) - positions.begin();
+        }
+
+        // the largest distance from a vertex of the mesh to the triangles of the level, relative to the diagonal
+        float MaxDeviation(const MeshData& meshData, const MeshLod& lod, float diagonal)
+        {
+            float maxDistanceSq = 0.0f;
+            for (const Vertex& vertex : meshData.vertices)
+            {
+                XMVECTOR p = XMLoadFloat3(&vertex.position);
+                float distanceSq = FLT_MAX;
+                for (unsigned int i = lod.indexOffset; i < lod.indexOffset + lod.indexCount; i += 3)
+                {
+                    XMVECTOR closest = Utils::ClosestPointOnTriangle(p,
+                        XMLoadFloat3(&meshData.vertices[meshData.indices[i]].position),
+                        XMLoadFloat3(&meshData.vertices[meshData.indices[i + 1]].position),
+                        XMLoadFloat3(&meshData.vertices[meshData.indices[i + 2]].position));
+                    distanceSq = std::min(distanceSq, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p, closest))));
+                }
+                maxDistanceSq = std::max(maxDistanceSq, distanceSq);
+            }
+            return std::sqrt(maxDistanceSq) / diagonal;
+        }
+
+        struct PackingError
+        {
+            // the largest error of each attribute, the position relative to the step of its axis
+            float position;
+            float normal;
+            float tangent;
+            float uv;
+            size_t failures;
+        };
+
+        // 0 for a zero vector, OctEncode has no direction to keep
+        float DirectionError(const XMFLOAT3& original, const XMFLOAT3& decoded)
+        {
+            XMVECTOR v = XMLoadFloat3(&original);
+            if (XMVectorGetX(XMVector3LengthSq(v)) < 1e-12f)
+            {
+                return 0.0f;
+            }
+            return XMVectorGetX(XMVector3Length(XMVectorSubtract(XMVector3Normalize(v), XMLoadFloat3(&decoded))));
+        }
+
+        PackingError CheckPacking(const std::vector<Vertex>& vertices)
+        {
+            // 16 bit snorm octahedral directions are within 1e-4, the bound leaves room for the rounding of the decode
+            const float directionBound = 1e-3f;
+            // a half has 11 significant bits, rounding is off by half a step at most
+            const float halfPrecision = 1.0f / 2048.0f;
+
+            MeshBounds bounds = GeometryGenerator::ComputeBounds(vertices.data(), vertices.size());
+            std::vector<PackedVertex> packed;
+            GeometryGenerator::PackVertices(vertices.data(), vertices.size(), bounds, packed);
+
+            const float minima[3] = { bounds.min.x, bounds.min.y, bounds.min.z };
+            const float steps[3] = { (bounds.max.x - bounds.min.x) / 65535.0f, (bounds.max.y - bounds.min.y) / 65535.0f,
+                (bounds.max.z - bounds.min.z) / 65535.0f };
+            PackingError error{};
+            for (size_t i = 0; i < vertices.size(); i++)
+            {
+                const Vertex& original = vertices[i];
+                Vertex decoded = GeometryGenerator::UnpackVertex(packed[i], bounds);
+                bool failed = false;
+
+                const float originalPosition[3] = { original.position.x, original.position.y, original.position.z };
+                const float decodedPosition[3] = { decoded.position.x, decoded.position.y, decoded.position.z };
+                for (unsigned int axis = 0; axis < 3; axis++)
+                {
+                    // half a step, and the float rounding of the position itself
+                    float difference = std::fabs(decodedPosition[axis] - originalPosition[axis]);
+                    float tolerance = 1e-6f * std::max(std::fabs(minima[axis]), std::fabs(originalPosition[axis]));
+                    failed = failed || difference > steps[axis] * 0.5f + tolerance;
+                    error.position = std::max(error.position, steps[axis] > 0.0f ? difference / steps[axis] : 0.0f);
+                }
+
+                float normalError = DirectionError(original.normal, decoded.normal);
+                float tangentError = DirectionError(original.tangent, decoded.tangent);
+                error.normal = std::max(error.normal, normalError);
+                error.tangent = std::max(error.tangent, tangentError);
+                failed = failed || normalError > directionBound || tangentError > directionBound;
+
+                float uvError = std::max(std::fabs(decoded.uv.x - original.uv.x), std::fabs(decoded.uv.y - original.uv.y));
+                float uvBound = halfPrecision * std::max({ 1.0f, std::fabs(original.uv.x), std::fabs(original.uv.y) });
+                error.uv = std::max(error.uv, uvError);
+                failed = failed || uvError > uvBound;
+
+                error.failures += failed ? 1 : 0;
+            }
+            return error;
+        }
+
+        template <typename Function>
+        double TimeBest(Function function)
+        {
+            // the best of a few runs, the first one also pays for the page faults of the new buffers
+            double best = 0.0;
+            for (unsigned int run = 0; run < 3; run++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                function();
+                double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                best = run == 0 ? time : std::min(best, time);
+            }
+            return best;
+        }
+    }
+
+// PUBLICS:
+    bool GeometryBenchmarks::ObjLoading(const std::string& directory)
+    {
+        bool passed = true;
+        std::string allFiles;
+        size_t totalSize = 0;
+        double totalTime = 0.0;
+        for (const std::string& path : FindFiles(directory, ".obj"))
+        {
+            std::string text;
+            {
+                MappedFile file(path);
+                text.assign(file.data, file.size);
+            }
+
+            // repeat for a quarter of a second so the first load, with the file out of the cache, does not count
+            unsigned int loadCount = 0;
+            double time = 0.0;
+            auto start = std::chrono::steady_clock::now();
+            while (time < 0.25)
+            {
+                MeshData meshData;
+                GeometryGenerator::LoadOBJFile(meshData, path);
+                ++loadCount;
+                time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            time /= loadCount;
+
+            ObjData objData;
+            ObjParser::Parse(objData, path);
+            size_t errors = CountParseErrors(objData, text);
+            passed = passed && errors == 0;
+            totalSize += text.size();
+            totalTime += time;
+            allFiles += text;
+            if (!text.empty() && text.back() != '\n')
+            {
+                allFiles += '\n';
+            }
+
+            std::cout << std::filesystem::path(path).filename().string() << ": " << text.size() / 1024 << " KB in "
+                << time * 1e3 << " ms, " << text.size() / time / (1024 * 1024) << " MB/s, "
+                << (errors == 0 ? "same as strtof" : "DIFFERENT FROM STRTOF") << "\n";
+        }
+        if (totalTime > 0.0)
+        {
+            std::cout << "All files: " << totalSize / totalTime / (1024 * 1024) << " MB/s\n";
+        }
+
+        // the indices of the repeated files still point into the first copy, the buffer is only parsed
+        std::string big;
+        while (!allFiles.empty() && big.size() < chunkedParseSize)
+        {
+            big += allFiles;
+        }
+        ObjData objData;
+        auto start = std::chrono::steady_clock::now();
+        ObjParser::Parse(objData, big.data(), big.data() + big.size());
+        double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        size_t errors = CountParseErrors(objData, big);
+        passed = passed && errors == 0;
+        std::cout << "Chunked parse of " << big.size() / (1024 * 1024) << " MB: " << big.size() / time / (1024 * 1024) << " MB/s, "
+            << (errors == 0 ? "same as strtof" : "DIFFERENT FROM STRTOF") << "\n";
+        return passed;
+    }
+
+    bool GeometryBenchmarks::GeosphereSubdivision()
+    {
+        const float radius = 2.0f;
+        bool passed = true;
+        for (unsigned int level = 0; level <= geosphereSubdivisions; level++)
+        {
+            MeshData meshData;
+            double time = TimeBest([&]() { GeometryGenerator::GenerateGeosphere(radius, level, meshData); });
+
+            size_t expectedVertices = 10 * (size_t(1) << (2 * level)) + 2;
+            size_t expectedTriangles = 20 * (size_t(1) << (2 * level));
+            size_t errors = 0;
+            errors += meshData.vertices.size() != expectedVertices ? 1 : 0;
+            errors += meshData.indices.size() != expectedTriangles * 3 ? 1 : 0;
+            for (const Vertex& vertex : meshData.vertices)
+            {
+                const XMFLOAT3& p = vertex.position;
+                float distance = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+                errors += std::fabs(distance - radius) > 1e-4f * radius ? 1 : 0;
+            }
+            for (unsigned int index : meshData.indices)
+            {
+                errors += index >= meshData.vertices.size() ? 1 : 0;
+            }
+
+            std::cout << "Level " << level << ": " << meshData.vertices.size() << " vertices, "
+                << meshData.indices.size() / 3 << " triangles in " << time * 1e3 << " ms";
+            if (level <= legacySubdivisions)
+            {
+                MeshData legacyData;
+                double legacyTime = TimeBest([&]() { LegacyGeosphere(radius, level, legacyData); });
+                errors += legacyData.indices.size() != meshData.indices.size() ? 1 : 0;
+                errors += CountDistinctPositions(legacyData) != meshData.vertices.size() ? 1 : 0;
+                std::cout << ", old geosphere " << legacyData.vertices.size() << " vertices in " << legacyTime * 1e3 << " ms";
+            }
+            std::cout << (errors == 0 ? "" : ", WRONG MESH") << "\n";
+            passed = passed && errors == 0;
+        }
+        return passed;
+    }
+
+    bool GeometryBenchmarks::LodChain(const std::string& directory)
+    {
+        bool passed = true;
+        for (const std::string& path : FindFiles(directory, ".obj"))
+        {
+            MeshData meshData;
+            GeometryGenerator::LoadOBJFile(meshData, path);
+            MeshOptimizer::Optimize(meshData);
+            auto start = std::chrono::steady_clock::now();
+            MeshSimplifier::BuildLodChain(meshData, 4, lodReduction, lodMaxError);
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            MeshBounds bounds = GeometryGenerator::ComputeBounds(meshData.vertices.data(), meshData.vertices.size());
+            XMFLOAT3 extent(bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z);
+            float diagonal = std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+
+            std::string name = std::filesystem::path(path).filename().string();
+            size_t errors = meshData.lods.empty() || meshData.lods[0].indexOffset != 0 ? 1 : 0;
+            std::cout << name << ": " << meshData.lods.size() << " levels in " << time * 1e3 << " ms\n";
+            for (size_t i = 0; i < meshData.lods.size(); i++)
+            {
+                const MeshLod& lod = meshData.lods[i];
+                size_t levelErrors = 0;
+                levelErrors += lod.indexCount == 0 || lod.indexCount % 3 != 0 ? 1 : 0;
+                levelErrors += size_t(lod.indexOffset) + lod.indexCount > meshData.indices.size() ? 1 : 0;
+                if (levelErrors == 0)
+                {
+                    for (unsigned int j = lod.indexOffset; j < lod.indexOffset + lod.indexCount; j++)
+                    {
+                        levelErrors += meshData.indices[j] >= meshData.vertices.size() ? 1 : 0;
+                    }
+                }
+                if (i > 0)
+                {
+                    // every level must drop enough triangles to be kept and stay within the limit
+                    const MeshLod& previous = meshData.lods[i - 1];
+                    levelErrors += lod.indexCount > previous.indexCount * 0.85f ? 1 : 0;
+                    levelErrors += lod.error > lodMaxError ? 1 : 0;
+                }
+                // the error of the level must be how far the vertices really are from its surface
+                float deviation = levelErrors == 0 ? MaxDeviation(meshData, lod, diagonal) : 0.0f;
+                levelErrors += deviation > lod.error + lodErrorTolerance ? 1 : 0;
+
+                std::cout << "  LOD " << i << ": " << lod.indexCount / 3 << " triangles, error " << lod.error
+                    << ", vertex deviation " << deviation << (levelErrors == 0 ? "" : ", WRONG LEVEL") << "\n";
+                errors += levelErrors;
+            }
+            passed = passed && errors == 0;
+        }
+        return passed;
+    }
+
+    bool GeometryBenchmarks::ClusterCulling(const std::string& directory)
+    {
+        CollisionData innerRail;
+        CollisionData outerRail;
+        GeometryGenerator::LoadCollisionDataFromOBJFile(innerRail, directory + "/track_inner_col.obj");
+        GeometryGenerator::LoadCollisionDataFromOBJFile(outerRail, directory + "/track_outer_col.obj");
+        TrackSpline track;
+        track.Bake(innerRail, outerRail, XMVectorSet(0.0f, 0.0f, 1.6f, 0.0f), XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), 8);
+
+        // processed like MeshCache does
+        std::map<std::string, MeshData> meshes;
+        for (const CullNode& node : cullNodes)
+        {
+            if (meshes.find(node.file) == meshes.end())
+            {
+                MeshData& meshData = meshes[node.file];
+                GeometryGenerator::LoadOBJFile(meshData, directory + "/" + node.file);
+                MeshOptimizer::Optimize(meshData);
+                MeshSimplifier::BuildLodChain(meshData);
+                MeshClusterizer::BuildClusters(meshData);
+            }
+        }
+
+        const size_t nodeCount = sizeof(cullNodes) / sizeof(cullNodes[0]);
+        std::vector<ClusterCullStats> stats(nodeCount, ClusterCullStats{});
+        std::vector<size_t> lostTriangles(nodeCount, 0);
+        std::vector<IndexRange> ranges;
+        std::vector<bool> drawn;
+        double cullTime = 0.0;
+        XMMATRIX proj = XMMatrixPerspectiveFovLH(cullFov, cullAspect, cullNearPlane, cullFarPlane);
+        XMVECTOR worldUp = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+        for (unsigned int frame = 0; frame < cullFrames; frame++)
+        {
+            // the ship on the centerline going along it, the camera placed like Camera::FollowShip places it
+            // when no rail is in the way
+            float distance = track.GetLength() * frame / cullFrames;
+            XMVECTOR shipPosition = track.GetPoint(distance);
+            XMVECTOR forward = XMVector3Normalize(track.GetPoint(distance + track.GetLength() / cullFrames) - shipPosition);
+            XMVECTOR viewPos = shipPosition - forward * 0.25f + worldUp * 0.125f;
+            Frustum frustum(XMMatrixLookAtLH(viewPos, shipPosition, worldUp) * proj);
+
+            for (size_t n = 0; n < nodeCount; n++)
+            {
+                const CullNode& node = cullNodes[n];
+                const MeshData& meshData = meshes[node.file];
+                XMMATRIX model = XMMatrixScaling(node.scale, node.scale, node.scale) *
+                    XMMatrixTranslation(node.position.x, node.position.y, node.position.z);
+                ranges.clear();
+                auto start = std::chrono::steady_clock::now();
+                ClusterCuller::Cull(meshData.clusters.data(), static_cast<unsigned int>(meshData.clusters.size()), model,
+                    frustum, viewPos, node.cullBack, ranges, stats[n]);
+                cullTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                // a culled triangle with a corner in the frustum that faces the camera would have been seen
+                size_t triangleCount = meshData.lods[0].indexCount / 3;
+                drawn.assign(triangleCount, false);
+                for (const IndexRange& range : ranges)
+                {
+                    std::fill(drawn.begin() + range.indexOffset / 3, drawn.begin() + (range.indexOffset + range.indexCount) / 3, true);
+                }
+                for (size_t t = 0; t < triangleCount; t++)
+                {
+                    if (drawn[t])
+                    {
+                        continue;
+                    }
+                    const unsigned int* triangle = &meshData.indices[meshData.lods[0].indexOffset + t * 3];
+                    XMVECTOR p0 = XMVector3Transform(XMLoadFloat3(&meshData.vertices[triangle[0]].position), model);
+                    XMVECTOR p1 = XMVector3Transform(XMLoadFloat3(&meshData.vertices[triangle[1]].position), model);
+                    XMVECTOR p2 = XMVector3Transform(XMLoadFloat3(&meshData.vertices[triangle[2]].position), model);
+                    bool inside = frustum.IntersectsSphere(p0, 0.0f) || frustum.IntersectsSphere(p1, 0.0f) ||
+                        frustum.IntersectsSphere(p2, 0.0f);
+                    // clockwise triangles are the front faces
+                    bool facing = !node.cullBack || XMVectorGetX(XMVector3Dot(p0 - viewPos, XMVector3Cross(p1 - p0, p2 - p0))) < 0.0f;
+                    lostTriangles[n] += inside && facing ? 1 : 0;
+                }
+            }
+        }
+
+        bool passed = true;
+        ClusterCullStats total{};
+        for (size_t n = 0; n < nodeCount; n++)
+        {
+            const CullNode& node = cullNodes[n];
+            std::cout << node.name << " (" << node.file << ", " << meshes[node.file].clusters.size() << " clusters): "
+                << 100.0 * stats[n].culledTriangles / std::max(stats[n].testedTriangles, 1ull) << "% of the triangles culled";
+            if (lostTriangles[n] > 0)
+            {
+                std::cout << ", " << lostTriangles[n] << " VISIBLE TRIANGLES CULLED";
+            }
+            std::cout << "\n";
+            total.testedTriangles += stats[n].testedTriangles;
+            total.culledTriangles += stats[n].culledTriangles;
+            passed = passed && lostTriangles[n] == 0;
+        }
+        std::cout << "lap of " << cullFrames << " frames along the centerline: "
+            << 100.0 * total.culledTriangles / std::max(total.testedTriangles, 1ull) << "% of the clustered triangles culled, "
+            << cullTime * 1e6 / cullFrames << " us of culling per frame\n";
+        return passed;
+    }
+
+    bool GeometryBenchmarks::VertexPacking(const std::string& directory)
+    {
+        std::vector<std::pair<std::string, MeshData>> meshes;
+        for (const std::string& path : FindFiles(directory, ".obj"))
+        {
+            meshes.emplace_back(std::filesystem::path(path).filename().string(), MeshData());
+            GeometryGenerator::LoadOBJFile(meshes.back().second, path);
+        }
+        // a mesh away from the origin, all the attributes generated
+        meshes.emplace_back("geosphere", MeshData());
+        GeometryGenerator::GenerateGeosphere(250.0f, 4, meshes.back().second);
+
+        bool passed = true;
+        for (const auto& mesh : meshes)
+        {
+            PackingError error = CheckPacking(mesh.second.vertices);
+            std::cout << mesh.first << ": " << mesh.second.vertices.size() << " vertices, position " << error.position
+                << " steps, normal " << error.normal << ", tangent " << error.tangent << ", uv " << error.uv;
+            if (error.failures > 0)
+            {
+                std::cout << ", " << error.failures << " VERTICES OVER THE BOUNDS";
+            }
+            std::cout << "\n";
+            passed = passed && error.failures == 0;
+        }
+        return passed;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+namespace mc
+{
+    // Headless benchmarks and checks of the mesh loading and processing, run by SolarSystemBench on the meshes
+    // of the game. They return false when their check fails.
+    class GeometryBenchmarks
+    {
+    public:
+        // Loads every OBJ file of the directory with LoadOBJFile and prints the MB/s, then checks ObjParser against
+        // a line by line parse with strtof, also on a buffer big enough to be parsed in chunks
+        static bool ObjLoading(const std::string& directory);
+        // Times GenerateGeosphere level by level against the old one, whose subdivision made six vertices per triangle,
+        // and checks the vertex and triangle counts, the radius and the indices of every level
+        static bool GeosphereSubdivision();
+        // Builds the LOD chain of every OBJ file of the directory like MeshCache does and checks that every level
+        // has fewer triangles, valid indices and an error within the limit, and that no vertex of the mesh is
+        // further from the surface of the level than its error says
+        static bool LodChain(const std::string& directory);
+        // Packs the vertices of every OBJ file of the directory and of a geosphere in the compressed format and
+        // checks the error of the positions, normals, tangents and uvs decoded by UnpackVertex
+        static bool VertexPacking(const std::string& directory);
+        // Follows the centerline of the track for a lap with the chase camera of the game and culls the clusters
+        // of every clustered node of the scene with ClusterCuller, at full detail. Prints the share of the
+        // triangles culled and checks that no culled triangle faces the camera with a corner in the frustum.
+        static bool ClusterCulling(const std::string& directory);
+    };
+}
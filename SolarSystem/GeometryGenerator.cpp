@@ -1,9 +1,143 @@
 #include "GeometryGenerator.h"
+#include "ObjParser.h"
+#include "CollisionBVH.h"
+#include "CollisionKernel.h"
 #include <stdexcept>
-#include <fstream>
+#include <cstring>
+#include <unordered_map>
+#include <algorithm>
 
 namespace mc
 {
+    namespace
+    {
+        // structure of arrays scratch for the 4 wide vertex kernels, the streams are padded to a multiple of 4
+        struct VertexStreams
+        {
+            size_t count;
+            size_t paddedCount;
+            std::vector<float> px, py, pz;
+            std::vector<float> nx, ny, nz;
+            std::vector<float> tx, tz;
+            std::vector<float> u, v;
+
+            VertexStreams(size_t count)
+                : count(count), paddedCount((count + 3) & ~static_cast<size_t>(3)),
+                  px(paddedCount, 0.0f), py(paddedCount, 1.0f), pz(paddedCount, 0.0f),
+                  nx(paddedCount), ny(paddedCount), nz(paddedCount),
+                  tx(paddedCount), tz(paddedCount),
+                  u(paddedCount), v(paddedCount)
+            {
+            }
+
+            void Store(Vertex* vertices) const
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    Vertex& vertex = vertices[i];
+                    vertex.position = XMFLOAT3(px[i], py[i], pz[i]);
+                    vertex.normal = XMFLOAT3(nx[i], ny[i], nz[i]);
+                    vertex.tangent = XMFLOAT3(tx[i], 0.0f, tz[i]);
+                    vertex.uv = XMFLOAT2(u[i], v[i]);
+                }
+            }
+        };
+
+        XMVECTOR Load4(const float* p)
+        {
+            return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(p));
+        }
+
+        void Store4(float* p, FXMVECTOR v)
+        {
+            XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(p), v);
+        }
+
+        unsigned short QuantizeUnorm16(float v)
+        {
+            v = std::min(std::max(v, 0.0f), 1.0f);
+            return static_cast<unsigned short>(v * 65535.0f + 0.5f);
+        }
+
+        short QuantizeSnorm16(float v)
+        {
+            v = std::min(std::max(v, -1.0f), 1.0f);
+            return static_cast<short>(v >= 0.0f ? v * 32767.0f + 0.5f : v * 32767.0f - 0.5f);
+        }
+
+        float DequantizeSnorm16(short v)
+        {
+            return std::max(v / 32767.0f, -1.0f);
+        }
+
+        // Projects the direction on the octahedron |x| + |y| + |z| = 1 and unfolds the lower half over the corners
+        PackedVector::XMSHORTN2 OctEncode(const XMFLOAT3& d)
+        {
+            float l1 = fabsf(d.x) + fabsf(d.y) + fabsf(d.z);
+            if (l1 == 0.0f)
+            {
+                return PackedVector::XMSHORTN2{ 0, 0 };
+            }
+            float x = d.x / l1;
+            float y = d.y / l1;
+            if (d.z < 0.0f)
+            {
+                float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+                float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+                x = fx;
+                y = fy;
+            }
+            return PackedVector::XMSHORTN2{ QuantizeSnorm16(x), QuantizeSnorm16(y) };
+        }
+
+        XMFLOAT3 OctDecode(const PackedVector::XMSHORTN2& e)
+        {
+            float x = DequantizeSnorm16(e.x);
+            float y = DequantizeSnorm16(e.y);
+            float z = 1.0f - fabsf(x) - fabsf(y);
+            float t = std::max(-z, 0.0f);
+            x += x >= 0.0f ? -t : t;
+            y += y >= 0.0f ? -t : t;
+            XMFLOAT3 d;
+            XMStoreFloat3(&d, XMVector3Normalize(XMVectorSet(x, y, z, 0.0f)));
+            return d;
+        }
+
+        CollisionQuadBasis ComputeCollisionQuadBasis(const CollisionQuad& quad)
+        {
+            XMVECTOR a = XMLoadFloat3(&quad.vertices[0]);
+            XMVECTOR b = XMLoadFloat3(&quad.vertices[1]);
+            XMVECTOR d = XMLoadFloat3(&quad.vertices[3]);
+
+            CollisionQuadBasis basis;
+            basis.origin = XMVectorSetW(a, 1.0f);
+            basis.right = XMVector3Normalize(b - a);
+            basis.up = XMLoadFloat3(&quad.normal);
+            basis.front = XMVector3Normalize(d - a);
+            basis.width = XMVectorGetX(XMVector3Length(b - a));
+            basis.height = XMVectorGetX(XMVector3Length(d - a));
+
+            // the rows of the transposed inverse are the columns of the inverse
+            XMMATRIX axes(basis.right, basis.up, basis.front, XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f));
+            XMMATRIX inverse = XMMatrixTranspose(XMMatrixInverse(nullptr, axes));
+            basis.inverseRight = inverse.r[0];
+            basis.inverseUp = inverse.r[1];
+            basis.inverseFront = inverse.r[2];
+            return basis;
+        }
+
+        struct ObjIndexHash
+        {
+            size_t operator()(const ObjIndex& index) const
+            {
+                size_t hash = std::hash<int>()(index.position);
+                hash ^= std::hash<int>()(index.uv) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+                hash ^= std::hash<int>()(index.normal) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+                return hash;
+            }
+        };
+    }
+
 // PUBLICS:
     void GeometryGenerator::GenerateQuad(MeshData& meshData)
     {
@@ -20,8 +154,9 @@ namespace mc
     }
     void GeometryGenerator::GenerateSphere(float radius, unsigned int sliceCount, unsigned int stackCount, MeshData& meshData)
     {
-        meshData.vertices.clear();
-        meshData.indices.clear();
+        unsigned int ringVertexCount = sliceCount + 1;
+        meshData.vertices.resize(2 + (stackCount - 1) * ringVertexCount);
+        meshData.indices.resize(6 * sliceCount * (stackCount - 1));
 
         //
         // Compute the vertices stating at the top pole and moving down the stacks.
@@ -33,58 +168,66 @@ namespace mc
         Vertex topVertex{ XMFLOAT3(0.0f, +radius, 0.0f),XMFLOAT3(0.0f, +1.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(0.0f, 0.0f) };
         Vertex bottomVertex{ XMFLOAT3(0.0f, -radius, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(0.0f, 1.0f) };
 
-        meshData.vertices.push_back(topVertex);
+        meshData.vertices.front() = topVertex;
+        meshData.vertices.back() = bottomVertex;
 
         float phiStep = XM_PI / stackCount;
         float thetaStep = 2.0f * XM_PI / sliceCount;
 
+        // Every ring uses the same slice angles, so the sin/cos of theta and everything that
+        // only depends on them (tangent and u) is computed once and reused for all the rings.
+        VertexStreams ring(ringVertexCount);
+        std::vector<float> sinTheta(ring.paddedCount, 0.0f);
+        std::vector<float> cosTheta(ring.paddedCount, 0.0f);
+        for (unsigned int j = 0; j <= sliceCount; ++j)
+        {
+            float theta = j * thetaStep;
+            sinTheta[j] = sinf(theta);
+            cosTheta[j] = cosf(theta);
+
+            // Partial derivative of P with respect to theta, already normalized
+            ring.tx[j] = -sinTheta[j];
+            ring.tz[j] = cosTheta[j];
+            ring.u[j] = theta / XM_2PI;
+        }
+
         // Compute vertices for each stack ring (do not count the poles as rings).
+        XMVECTOR radius4 = XMVectorReplicate(radius);
         for (unsigned int i = 1; i <= stackCount - 1; ++i)
         {
             float phi = i * phiStep;
+            float sinPhi = sinf(phi);
+            float cosPhi = cosf(phi);
+            XMVECTOR sinPhi4 = XMVectorReplicate(sinPhi);
 
-            // Vertices of ring.
-            for (unsigned int j = 0; j <= sliceCount; ++j)
+            // spherical to cartesian, 4 slices at a time
+            for (size_t j = 0; j < ring.paddedCount; j += 4)
             {
-                float theta = j * thetaStep;
-
-                Vertex v;
-
-                // spherical to cartesian
-                v.position.x = radius * sinf(phi) * cosf(theta);
-                v.position.y = radius * cosf(phi);
-                v.position.z = radius * sinf(phi) * sinf(theta);
-
-                // Partial derivative of P with respect to theta
-                v.tangent.x = -radius * sinf(phi) * sinf(theta);
-                v.tangent.y = 0.0f;
-                v.tangent.z = +radius * sinf(phi) * cosf(theta);
-
-                XMVECTOR T = XMLoadFloat3(&v.tangent);
-                XMStoreFloat3(&v.tangent, XMVector3Normalize(T));
-
-                XMVECTOR p = XMLoadFloat3(&v.position);
-                XMStoreFloat3(&v.normal, XMVector3Normalize(p));
-
-                v.uv.x = theta / XM_2PI;
-                v.uv.y = phi / XM_PI;
-
-                meshData.vertices.push_back(v);
+                XMVECTOR nx = XMVectorMultiply(sinPhi4, Load4(&cosTheta[j]));
+                XMVECTOR nz = XMVectorMultiply(sinPhi4, Load4(&sinTheta[j]));
+                Store4(&ring.nx[j], nx);
+                Store4(&ring.nz[j], nz);
+                Store4(&ring.px[j], XMVectorMultiply(nx, radius4));
+                Store4(&ring.pz[j], XMVectorMultiply(nz, radius4));
             }
-        }
+            std::fill(ring.ny.begin(), ring.ny.end(), cosPhi);
+            std::fill(ring.py.begin(), ring.py.end(), radius * cosPhi);
+            std::fill(ring.v.begin(), ring.v.end(), phi / XM_PI);
 
-        meshData.vertices.push_back(bottomVertex);
+            ring.Store(&meshData.vertices[1 + (i - 1) * ringVertexCount]);
+        }
 
         //
         // Compute indices for top stack.  The top stack was written first to the vertex buffer
         // and connects the top pole to the first ring.
         //
 
+        unsigned int* index = meshData.indices.data();
         for (unsigned int i = 1; i <= sliceCount; ++i)
         {
-            meshData.indices.push_back(0);
-            meshData.indices.push_back(i + 1);
-            meshData.indices.push_back(i);
+            *index++ = 0;
+            *index++ = i + 1;
+            *index++ = i;
         }
 
         //
@@ -94,18 +237,17 @@ namespace mc
         // Offset the indices to the index of the first vertex in the first ring.
         // This is just skipping the top pole vertex.
         unsigned int baseIndex = 1;
-        unsigned int ringVertexCount = sliceCount + 1;
         for (unsigned int i = 0; i < stackCount - 2; ++i)
         {
             for (unsigned int j = 0; j < sliceCount; ++j)
             {
-                meshData.indices.push_back(baseIndex + i * ringVertexCount + j);
-                meshData.indices.push_back(baseIndex + i * ringVertexCount + j + 1);
-                meshData.indices.push_back(baseIndex + (i + 1) * ringVertexCount + j);
+                *index++ = baseIndex + i * ringVertexCount + j;
+                *index++ = baseIndex + i * ringVertexCount + j + 1;
+                *index++ = baseIndex + (i + 1) * ringVertexCount + j;
 
-                meshData.indices.push_back(baseIndex + (i + 1) * ringVertexCount + j);
-                meshData.indices.push_back(baseIndex + i * ringVertexCount + j + 1);
-                meshData.indices.push_back(baseIndex + (i + 1) * ringVertexCount + j + 1);
+                *index++ = baseIndex + (i + 1) * ringVertexCount + j;
+                *index++ = baseIndex + i * ringVertexCount + j + 1;
+                *index++ = baseIndex + (i + 1) * ringVertexCount + j + 1;
             }
         }
 
@@ -122,15 +264,19 @@ namespace mc
 
         for (unsigned int i = 0; i < sliceCount; ++i)
         {
-            meshData.indices.push_back(southPoleIndex);
-            meshData.indices.push_back(baseIndex + i);
-            meshData.indices.push_back(baseIndex + i + 1);
+            *index++ = southPoleIndex;
+            *index++ = baseIndex + i;
+            *index++ = baseIndex + i + 1;
         }
     }
     void GeometryGenerator::GenerateGeosphere(float radius, unsigned int numSubdivisions, MeshData& meshData)
     {
-        // Put a cap on the number of subdivisions.
-        numSubdivisions = std::min(numSubdivisions, 5u);
+        // The only limit on the number of subdivisions is the 32 bits index range,
+        // every level has 10 * 4^n + 2 vertices.
+        if (numSubdivisions > 14)
+        {
+            throw std::runtime_error("Error too many geosphere subdivisions");
+        }
 
         // Approximate a sphere by tessellating an icosahedron.
 
@@ -167,159 +313,200 @@ namespace mc
         for (unsigned int i = 0; i < numSubdivisions; ++i)
             Subdivide(meshData);
 
-        // Project vertices onto sphere and scale.
-        for (unsigned int i = 0; i < meshData.vertices.size(); ++i)
+        // Project vertices onto sphere and scale, 4 vertices at a time.
+        VertexStreams streams(meshData.vertices.size());
+        for (size_t i = 0; i < meshData.vertices.size(); ++i)
         {
-            // Project onto unit sphere.
-            XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&meshData.vertices[i].position));
-
-            // Project onto sphere.
-            XMVECTOR p = radius * n;
-
-            XMStoreFloat3(&meshData.vertices[i].position, p);
-            XMStoreFloat3(&meshData.vertices[i].normal, n);
-
-            // Derive texture coordinates from spherical coordinates.
-            float theta = AngleFromXY(
-                meshData.vertices[i].position.x,
-                meshData.vertices[i].position.z);
-
-            float phi = acosf(meshData.vertices[i].position.y / radius);
+            streams.px[i] = meshData.vertices[i].position.x;
+            streams.py[i] = meshData.vertices[i].position.y;
+            streams.pz[i] = meshData.vertices[i].position.z;
+        }
 
-            meshData.vertices[i].uv.x = theta / XM_2PI;
-            meshData.vertices[i].uv.y = phi / XM_PI;
+        XMVECTOR zero = XMVectorZero();
+        XMVECTOR radius4 = XMVectorReplicate(radius);
+        XMVECTOR twoPi = XMVectorReplicate(XM_2PI);
+        XMVECTOR invTwoPi = XMVectorReplicate(1.0f / XM_2PI);
+        XMVECTOR invPi = XMVectorReplicate(1.0f / XM_PI);
+        for (size_t i = 0; i < streams.paddedCount; i += 4)
+        {
+            XMVECTOR x = Load4(&streams.px[i]);
+            XMVECTOR y = Load4(&streams.py[i]);
+            XMVECTOR z = Load4(&streams.pz[i]);
 
-            // Partial derivative of P with respect to theta
-            meshData.vertices[i].tangent.x = -radius * sinf(phi) * sinf(theta);
-            meshData.vertices[i].tangent.y = 0.0f;
-            meshData.vertices[i].tangent.z = +radius * sinf(phi) * cosf(theta);
+            // Project onto unit sphere.
+            XMVECTOR lengthSq = XMVectorMultiplyAdd(x, x, XMVectorMultiplyAdd(y, y, XMVectorMultiply(z, z)));
+            XMVECTOR invLength = XMVectorReciprocalSqrt(lengthSq);
+            XMVECTOR nx = XMVectorMultiply(x, invLength);
+            XMVECTOR ny = XMVectorMultiply(y, invLength);
+            XMVECTOR nz = XMVectorMultiply(z, invLength);
+            Store4(&streams.nx[i], nx);
+            Store4(&streams.ny[i], ny);
+            Store4(&streams.nz[i], nz);
 
-            XMVECTOR T = XMLoadFloat3(&meshData.vertices[i].tangent);
-            XMStoreFloat3(&meshData.vertices[i].tangent, XMVector3Normalize(T));
+            // Project onto sphere.
+            Store4(&streams.px[i], XMVectorMultiply(nx, radius4));
+            Store4(&streams.py[i], XMVectorMultiply(ny, radius4));
+            Store4(&streams.pz[i], XMVectorMultiply(nz, radius4));
+
+            // Derive texture coordinates from spherical coordinates, theta in [0, 2*pi).
+            XMVECTOR theta = XMVectorATan2(nz, nx);
+            theta = XMVectorSelect(theta, XMVectorAdd(theta, twoPi), XMVectorLess(theta, zero));
+            XMVECTOR phi = XMVectorACos(XMVectorClamp(ny, XMVectorNegate(XMVectorSplatOne()), XMVectorSplatOne()));
+            Store4(&streams.u[i], XMVectorMultiply(theta, invTwoPi));
+            Store4(&streams.v[i], XMVectorMultiply(phi, invPi));
+
+            // Partial derivative of P with respect to theta normalized, sin(phi) cancels out
+            // so it is (-sin(theta), 0, cos(theta)) except at the poles where it is zero.
+            XMVECTOR sinPhi = XMVectorSqrt(XMVectorMultiplyAdd(nx, nx, XMVectorMultiply(nz, nz)));
+            XMVECTOR invSinPhi = XMVectorReciprocal(sinPhi);
+            XMVECTOR notPole = XMVectorGreater(sinPhi, zero);
+            Store4(&streams.tx[i], XMVectorSelect(zero, XMVectorNegate(XMVectorMultiply(nz, invSinPhi)), notPole));
+            Store4(&streams.tz[i], XMVectorSelect(zero, XMVectorMultiply(nx, invSinPhi), notPole));
         }
+
+        streams.Store(meshData.vertices.data());
     }
     void GeometryGenerator::LoadOBJFile(MeshData& meshData, const std::string& filepath)
     {
-        std::ifstream file;
-        file.open(filepath, std::ios::in);
-        if (file.is_open()) {
-
-            std::vector<XMFLOAT3> positions;
-            std::vector<XMFLOAT3> normals;
-            std::vector<XMFLOAT2> uvs;
-
-            std::string line;
-            while (getline(file, line)) {
-                if (line.find("v ", 0, 2) == 0) {
-                    XMFLOAT3 position;
-                    sscanf_s(line.c_str(), "v %f %f %f", &position.x, &position.y, &position.z);
-                    positions.push_back(position);
-                }
-                else if (line.find("vn", 0, 2) == 0) {
-                    XMFLOAT3 normal;
-                    sscanf_s(line.c_str(), "vn %f %f %f", &normal.x, &normal.y, &normal.z);
-                    normals.push_back(normal);
-                }
-                else if (line.find("vt", 0, 2) == 0) {
-                    XMFLOAT2 uv;
-                    float pad;
-                    sscanf_s(line.c_str(), "vt %f %f %f", &uv.x, &uv.y, &pad);
-                    uvs.push_back(uv);
-                }
-            }
+        ObjData objData;
+        ObjParser::Parse(objData, filepath);
+
+        size_t triangleCount = 0;
+        for (unsigned char faceSize : objData.faceSizes)
+        {
+            triangleCount += faceSize >= 3 ? faceSize - 2 : 0;
+        }
 
-            file.clear();
-            file.seekg(0);
-
-            while (getline(file, line)) {
-                if (line.find("f ", 0, 2) == 0) {
-                    int posIndex[3];
-                    int norIndex[3];
-                    int uvsIndex[3];
-                    sscanf_s(line.c_str(), "f %d/%d/%d %d/%d/%d %d/%d/%d",
-                        &posIndex[0], &uvsIndex[0], &norIndex[0],
-                        &posIndex[1], &uvsIndex[1], &norIndex[1],
-                        &posIndex[2], &uvsIndex[2], &norIndex[2]);
-
-                    Vertex vertex{};
-                    for (int i = 0; i < 3; i++) {
-                        vertex.position = positions[posIndex[i] - 1];
-                        vertex.normal = normals[norIndex[i] - 1];
-                        vertex.uv = uvs[uvsIndex[i] - 1];
+        // corners that share the same position/uv/normal triple share the same vertex
+        std::unordered_map<ObjIndex, unsigned int, ObjIndexHash> vertexMap;
+        vertexMap.reserve(objData.corners.size());
+        meshData.vertices.reserve(meshData.vertices.size() + objData.corners.size());
+        meshData.indices.reserve(meshData.indices.size() + triangleCount * 3);
+
+        size_t corner = 0;
+        for (unsigned char faceSize : objData.faceSizes)
+        {
+            // faces with more than 3 corners are triangulated as a fan
+            for (unsigned int i = 2; i < faceSize; i++)
+            {
+                const ObjIndex triangle[3] = {
+                    objData.corners[corner], objData.corners[corner + i - 1], objData.corners[corner + i]
+                };
+                for (const ObjIndex& index : triangle)
+                {
+                    auto result = vertexMap.try_emplace(index, static_cast<unsigned int>(meshData.vertices.size()));
+                    if (result.second)
+                    {
+                        Vertex vertex{};
+                        vertex.position = objData.positions.at(index.position);
+                        if (index.normal >= 0)
+                        {
+                            vertex.normal = objData.normals.at(index.normal);
+                        }
+                        if (index.uv >= 0)
+                        {
+                            vertex.uv = objData.uvs.at(index.uv);
+                        }
                         meshData.vertices.push_back(vertex);
                     }
+                    meshData.indices.push_back(result.first->second);
                 }
             }
-            file.close();
-        }
-        else 
-        {
-            throw std::runtime_error("Error opening the obj file");
+            corner += faceSize;
         }
     }
     void GeometryGenerator::LoadCollisionDataFromOBJFile(CollisionData& collisionData, const std::string& filepath)
     {
-        std::ifstream file;
-        file.open(filepath, std::ios::in);
-        if (file.is_open()) {
-
-            std::vector<XMFLOAT3> positions;
-            std::vector<XMFLOAT3> normals;
-
-            std::string line;
-            while (getline(file, line)) {
-                if (line.find("v ", 0, 2) == 0) {
-                    XMFLOAT3 position;
-                    sscanf_s(line.c_str(), "v %f %f %f", &position.x, &position.y, &position.z);
-                    positions.push_back(position);
+        ObjData objData;
+        ObjParser::Parse(objData, filepath);
+
+        collisionData.quads.reserve(collisionData.quads.size() + objData.faceSizes.size());
+        collisionData.bases.reserve(collisionData.bases.size() + objData.faceSizes.size());
+
+        size_t corner = 0;
+        for (unsigned char faceSize : objData.faceSizes)
+        {
+            if (faceSize == 4)
+            {
+                CollisionQuad quad{};
+                int normal = objData.corners[corner].normal;
+                if (normal >= 0)
+                {
+                    quad.normal = objData.normals.at(normal);
                 }
-                else if (line.find("vn", 0, 2) == 0) {
-                    XMFLOAT3 normal;
-                    sscanf_s(line.c_str(), "vn %f %f %f", &normal.x, &normal.y, &normal.z);
-                    normals.push_back(normal);
+                for (int i = 0; i < 4; i++)
+                {
+                    quad.vertices[i] = objData.positions.at(objData.corners[corner + i].position);
                 }
+                collisionData.quads.push_back(quad);
+                collisionData.bases.push_back(ComputeCollisionQuadBasis(quad));
             }
+            corner += faceSize;
+        }
+        CollisionKernel::BuildBlocks(collisionData);
+        CollisionBVH::Build(collisionData);
+    }
 
-            file.clear();
-            file.seekg(0);
-
-            while (getline(file, line)) {
-                if (line.find("f ", 0, 2) == 0) {
-                    int posIndex[4];
-                    int norIndex[4];
-                    int uvsIndex[4];
-                    sscanf_s(line.c_str(), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-                        &posIndex[0], &uvsIndex[0], &norIndex[0],
-                        &posIndex[1], &uvsIndex[1], &norIndex[1],
-                        &posIndex[2], &uvsIndex[2], &norIndex[2],
-                        &posIndex[3], &uvsIndex[3], &norIndex[3]);
-
-                    CollisionQuad quad{};
-                    quad.normal = normals[norIndex[0] - 1];
-                    for (int i = 0; i < 4; i++) {
-                        quad.vertices[i] = positions[posIndex[i] - 1];
-                    }
-                    collisionData.quads.push_back(quad);
-                }
-            }
-            file.close();
+    MeshBounds GeometryGenerator::ComputeBounds(const Vertex* vertices, size_t count)
+    {
+        if (count == 0)
+        {
+            return MeshBounds{ XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f) };
         }
-        else
+        XMVECTOR min = XMLoadFloat3(&vertices[0].position);
+        XMVECTOR max = min;
+        for (size_t i = 1; i < count; i++)
         {
-            throw std::runtime_error("Error opening the obj file");
+            XMVECTOR position = XMLoadFloat3(&vertices[i].position);
+            min = XMVectorMin(min, position);
+            max = XMVectorMax(max, position);
         }
+        MeshBounds bounds;
+        XMStoreFloat3(&bounds.min, min);
+        XMStoreFloat3(&bounds.max, max);
+        return bounds;
     }
 
-// PRIVATES:
-    void GeometryGenerator::Subdivide(MeshData& meshData)
+    void GeometryGenerator::PackVertices(const Vertex* vertices, size_t count, const MeshBounds& bounds, std::vector<PackedVertex>& packed)
     {
-        // Save a copy of the input geometry.
-        MeshData inputCopy = meshData;
-
+        XMFLOAT3 extent(bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z);
+        // flat axes are stored as zero, the decode only adds the minimum
+        XMFLOAT3 invExtent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+                           extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+                           extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+        packed.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Vertex& vertex = vertices[i];
+            PackedVertex& out = packed[i];
+            out.position.x = QuantizeUnorm16((vertex.position.x - bounds.min.x) * invExtent.x);
+            out.position.y = QuantizeUnorm16((vertex.position.y - bounds.min.y) * invExtent.y);
+            out.position.z = QuantizeUnorm16((vertex.position.z - bounds.min.z) * invExtent.z);
+            out.position.w = 0;
+            out.normal = OctEncode(vertex.normal);
+            out.tangent = OctEncode(vertex.tangent);
+            out.uv.x = PackedVector::XMConvertFloatToHalf(vertex.uv.x);
+            out.uv.y = PackedVector::XMConvertFloatToHalf(vertex.uv.y);
+        }
+    }
 
-        meshData.vertices.resize(0);
-        meshData.indices.resize(0);
+    Vertex GeometryGenerator::UnpackVertex(const PackedVertex& packed, const MeshBounds& bounds)
+    {
+        Vertex vertex;
+        vertex.position.x = bounds.min.x + (packed.position.x / 65535.0f) * (bounds.max.x - bounds.min.x);
+        vertex.position.y = bounds.min.y + (packed.position.y / 65535.0f) * (bounds.max.y - bounds.min.y);
+        vertex.position.z = bounds.min.z + (packed.position.z / 65535.0f) * (bounds.max.z - bounds.min.z);
+        vertex.normal = OctDecode(packed.normal);
+        vertex.tangent = OctDecode(packed.tangent);
+        vertex.uv.x = PackedVector::XMConvertHalfToFloat(packed.uv.x);
+        vertex.uv.y = PackedVector::XMConvertHalfToFloat(packed.uv.y);
+        return vertex;
+    }
 
+// PRIVATES:
+    void GeometryGenerator::Subdivide(MeshData& meshData)
+    {
         //       v1
         //       *
         //      / \
@@ -330,89 +517,71 @@ namespace mc
     	// *-----*-----*
         // v0    m2     v2
 
-        unsigned int numTris = inputCopy.indices.size() / 3;
-        for (unsigned int i = 0; i < numTris; ++i)
-        {
-            Vertex v0 = inputCopy.vertices[inputCopy.indices[i * 3 + 0]];
-            Vertex v1 = inputCopy.vertices[inputCopy.indices[i * 3 + 1]];
-            Vertex v2 = inputCopy.vertices[inputCopy.indices[i * 3 + 2]];
+        size_t numTris = meshData.indices.size() / 3;
+        size_t numVertices = meshData.vertices.size();
 
-            //
-            // Generate the midpoints.
-            //
+        // Every edge of a closed mesh is shared by two triangles, so the mesh gets exactly one midpoint per edge.
+        // The midpoints are listed with the lower vertex of their edge, no vertex of a geosphere has more than
+        // six edges.
+        const unsigned int maxEdges = 6;
+        const unsigned int noEdge = ~0u;
+        std::vector<unsigned int> edgeEnds(numVertices * maxEdges, noEdge);
+        std::vector<unsigned int> edgeMidpoints(numVertices * maxEdges);
+        meshData.vertices.resize(numVertices + numTris * 3 / 2);
+        unsigned int nextVertex = static_cast<unsigned int>(numVertices);
 
-            Vertex m0, m1, m2;
+        auto Midpoint = [&](unsigned int a, unsigned int b)
+        {
+            if (a > b)
+            {
+                std::swap(a, b);
+            }
+            unsigned int* ends = &edgeEnds[size_t(a) * maxEdges];
+            unsigned int edge = 0;
+            for (; edge < maxEdges && ends[edge] != noEdge; edge++)
+            {
+                if (ends[edge] == b)
+                {
+                    return edgeMidpoints[size_t(a) * maxEdges + edge];
+                }
+            }
+            if (edge == maxEdges || nextVertex == meshData.vertices.size())
+            {
+                throw std::runtime_error("Error subdivided mesh is not a closed geosphere");
+            }
 
             // For subdivision, we just care about the position component.  We derive the other
             // vertex components in CreateGeosphere.
+            const XMFLOAT3& p0 = meshData.vertices[a].position;
+            const XMFLOAT3& p1 = meshData.vertices[b].position;
+            meshData.vertices[nextVertex].position = XMFLOAT3(
+                0.5f * (p0.x + p1.x),
+                0.5f * (p0.y + p1.y),
+                0.5f * (p0.z + p1.z));
+
+            ends[edge] = b;
+            edgeMidpoints[size_t(a) * maxEdges + edge] = nextVertex;
+            return nextVertex++;
+        };
 
-            m0.position = XMFLOAT3(
-                0.5f * (v0.position.x + v1.position.x),
-                0.5f * (v0.position.y + v1.position.y),
-                0.5f * (v0.position.z + v1.position.z));
-
-            m1.position = XMFLOAT3(
-                0.5f * (v1.position.x + v2.position.x),
-                0.5f * (v1.position.y + v2.position.y),
-                0.5f * (v1.position.z + v2.position.z));
-
-            m2.position = XMFLOAT3(
-                0.5f * (v0.position.x + v2.position.x),
-                0.5f * (v0.position.y + v2.position.y),
-                0.5f * (v0.position.z + v2.position.z));
-
-            //
-            // Add new geometry.
-            //
-
-            meshData.vertices.push_back(v0); // 0
-            meshData.vertices.push_back(v1); // 1
-            meshData.vertices.push_back(v2); // 2
-            meshData.vertices.push_back(m0); // 3
-            meshData.vertices.push_back(m1); // 4
-            meshData.vertices.push_back(m2); // 5
-
-            meshData.indices.push_back(i * 6 + 0);
-            meshData.indices.push_back(i * 6 + 3);
-            meshData.indices.push_back(i * 6 + 5);
-
-            meshData.indices.push_back(i * 6 + 3);
-            meshData.indices.push_back(i * 6 + 4);
-            meshData.indices.push_back(i * 6 + 5);
-
-            meshData.indices.push_back(i * 6 + 5);
-            meshData.indices.push_back(i * 6 + 4);
-            meshData.indices.push_back(i * 6 + 2);
-
-            meshData.indices.push_back(i * 6 + 3);
-            meshData.indices.push_back(i * 6 + 1);
-            meshData.indices.push_back(i * 6 + 4);
-        }
-    }
-    float GeometryGenerator::AngleFromXY(float x, float y)
-    {
-        float theta = 0.0f;
-
-        // Quadrant I or IV
-        if (x >= 0.0f)
+        // every triangle becomes four, going backwards lets us write them in place
+        // without overwriting a triangle we still have to read
+        meshData.indices.resize(numTris * 12);
+        for (size_t i = numTris; i-- > 0;)
         {
-            // If x = 0, then atanf(y/x) = +pi/2 if y > 0
-            //                atanf(y/x) = -pi/2 if y < 0
-            theta = atanf(y / x); // in [-pi/2, +pi/2]
-
-            if (theta < 0.0f)
-                theta += 2.0f * XM_PI; // in [0, 2*pi).
+            unsigned int v0 = meshData.indices[i * 3 + 0];
+            unsigned int v1 = meshData.indices[i * 3 + 1];
+            unsigned int v2 = meshData.indices[i * 3 + 2];
+
+            unsigned int m0 = Midpoint(v0, v1);
+            unsigned int m1 = Midpoint(v1, v2);
+            unsigned int m2 = Midpoint(v0, v2);
+
+            unsigned int* out = &meshData.indices[i * 12];
+            out[0] = v0; out[1] = m0;  out[2] = m2;
+            out[3] = m0; out[4] = m1;  out[5] = m2;
+            out[6] = m2; out[7] = m1;  out[8] = v2;
+            out[9] = m0; out[10] = v1; out[11] = m1;
         }
-
-        // Quadrant II or III
-        else
-            theta = atanf(y / x) + XM_PI; // in [0, 2*pi).
-
-        return theta;
     }
-
-
-
-
-
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <DirectXPackedVector.h>
 #include <vector>
 #include <string>
 
@@ -16,10 +17,54 @@ namespace mc
         XMFLOAT2 uv;
     };
 
+    // Compressed version of Vertex (20 bytes instead of 44) decoded by assets/vertex/vertPacked.hlsl.
+    // The position is quantized to 16 bits against the bounds of the mesh, normal and tangent
+    // use the octahedral encoding and the uv are half floats.
+    struct PackedVertex
+    {
+        PackedVector::XMUSHORTN4 position;
+        PackedVector::XMSHORTN2 normal;
+        PackedVector::XMSHORTN2 tangent;
+        PackedVector::XMHALF2 uv;
+    };
+
+    struct MeshBounds
+    {
+        XMFLOAT3 min;
+        XMFLOAT3 max;
+    };
+
+    // Range of MeshData::indices used by one level of detail, error is the
+    // geometric error of the level relative to the size of the mesh.
+    struct MeshLod
+    {
+        unsigned int indexOffset;
+        unsigned int indexCount;
+        float error;
+    };
+
+    // Range of the full detail triangles of MeshData::indices with the bounds used to cull it.
+    // All the triangles face away from the camera when
+    // dot(center - camera, coneAxis) >= coneCutoff * |center - camera| + radius,
+    // a coneCutoff of 1 means the normals are too spread to cull the cluster that way.
+    struct MeshCluster
+    {
+        unsigned int indexOffset;
+        unsigned int indexCount;
+        XMFLOAT3 center;
+        float radius;
+        XMFLOAT3 coneAxis;
+        float coneCutoff;
+    };
+
     struct MeshData
     {
         std::vector<Vertex> vertices;
         std::vector<unsigned int> indices;
+        // empty if the mesh has no LOD chain, otherwise lods[0] is the full detail mesh
+        std::vector<MeshLod> lods;
+        // empty if the mesh was not split in clusters, they cover the full detail triangles
+        std::vector<MeshCluster> clusters;
     };
 
     struct CollisionQuad
@@ -28,9 +73,76 @@ namespace mc
         XMFLOAT3 normal;
     };
 
+    // Basis of a CollisionQuad baked when the track is loaded. The ship position relative to the quad is
+    // dot(p - origin, inverseRight) along the quad and dot(p - origin, inverseUp) above it. The inverse
+    // axes are the columns of the inverse of the (right, up, front) basis, equal to the axes when the
+    // quad is a rectangle.
+    struct CollisionQuadBasis
+    {
+        XMVECTOR origin;
+        XMVECTOR right;
+        XMVECTOR up;
+        XMVECTOR front;
+        XMVECTOR inverseRight;
+        XMVECTOR inverseUp;
+        XMVECTOR inverseFront;
+        float width;
+        float height;
+    };
+
+    // Eight consecutive CollisionQuadBasis in structure of arrays form for CollisionKernel, only what the
+    // contact test reads. The lanes after the last quad have a negative width so they never touch the ship.
+    struct alignas(32) CollisionQuadBlock
+    {
+        float originX[8];
+        float originY[8];
+        float originZ[8];
+        float inverseUpX[8];
+        float inverseUpY[8];
+        float inverseUpZ[8];
+        float inverseRightX[8];
+        float inverseRightY[8];
+        float inverseRightZ[8];
+        float width[8];
+    };
+
+    // Node of the flattened bounding volume hierarchy over the collision quads. The first child of an
+    // inner node is the next node in the array and offset is the second one. Leafs have a count above
+    // zero and their quads are bvhQuads[offset] to bvhQuads[offset + count - 1].
+    struct CollisionBVHNode
+    {
+        XMFLOAT3 min;
+        unsigned int offset;
+        XMFLOAT3 max;
+        unsigned int count;
+    };
+
+    // Sparse signed distance field of the quads baked by CollisionSDF::Bake. The bounds of the quads are split in
+    // bricks of 8x8x8 voxels, bricks has the offset in samples of every brick, or ~0 for the bricks further than
+    // maxDistance from all the quads. A brick stores all its 9x9x9 corners so a lookup never reads two bricks.
+    // Samples are the distance divided by maxDistance as snorm16, positive on the side the quad normals point to.
+    struct CollisionDistanceField
+    {
+        XMFLOAT3 origin;
+        float voxelSize;
+        float maxDistance;
+        unsigned int brickCounts[3];
+        std::vector<unsigned int> bricks;
+        std::vector<short> samples;
+    };
+
     struct CollisionData
     {
         std::vector<CollisionQuad> quads;
+        // one per quad, in the same order
+        std::vector<CollisionQuadBasis> bases;
+        // the bases in blocks of eight, built by CollisionKernel::BuildBlocks
+        std::vector<CollisionQuadBlock> quadBlocks;
+        // built by CollisionBVH::Build, bvhQuads are indices of quads
+        std::vector<CollisionBVHNode> bvhNodes;
+        std::vector<unsigned int> bvhQuads;
+        // empty until CollisionSDF::Bake is called
+        CollisionDistanceField distanceField{};
     };
 
     class GeometryGenerator
@@ -41,9 +153,13 @@ namespace mc
         static void GenerateGeosphere(float radius, unsigned int numSubdivisions, MeshData& meshData);
         static void LoadOBJFile(MeshData& meshData, const std::string& filepath);
         static void LoadCollisionDataFromOBJFile(CollisionData& collisionData, const std::string& filepath);
+        static MeshBounds ComputeBounds(const Vertex* vertices, size_t count);
+        // bounds must contain all the positions, usually the result of ComputeBounds
+        static void PackVertices(const Vertex* vertices, size_t count, const MeshBounds& bounds, std::vector<PackedVertex>& packed);
+        // CPU version of the decode done in the vertex shader
+        static Vertex UnpackVertex(const PackedVertex& packed, const MeshBounds& bounds);
     private:
         static void Subdivide(MeshData& meshData);
-        static float AngleFromXY(float x, float y);
     };
 }
 
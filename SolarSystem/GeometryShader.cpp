@@ -71,6 +71,6 @@ namespace mc
 
     void GeometryShader::Bind(const GraphicsManager& gm)
     {
-        GetDeviceContext(gm)->GSSetShader(shader_.Get(), 0, 0);
+        GetStateCache(gm).SetGeometryShader(shader_.Get());
     }
 }
\ No newline at end of file
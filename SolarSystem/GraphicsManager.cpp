@@ -6,10 +6,123 @@
 
 namespace mc
 {
+    // sends the calls the state cache lets through to the device context
+    class D3D11StateTarget : public RenderStateTarget
+    {
+    public:
+        explicit D3D11StateTarget(ID3D11DeviceContext* deviceContext)
+            : deviceContext_(deviceContext)
+        {
+        }
+
+        void SetBlendState(ID3D11BlendState* state) override
+        {
+            deviceContext_->OMSetBlendState(state, nullptr, 0xffffffff);
+        }
+
+        void SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef) override
+        {
+            deviceContext_->OMSetDepthStencilState(state, stencilRef);
+        }
+
+        void SetRasterizerState(ID3D11RasterizerState* state) override
+        {
+            deviceContext_->RSSetState(state);
+        }
+
+        void SetSampler(ShaderStage stage, unsigned int slot, ID3D11SamplerState* sampler) override
+        {
+            switch (stage)
+            {
+            case ShaderStage::Vertex:
+                deviceContext_->VSSetSamplers(slot, 1, &sampler);
+                break;
+            case ShaderStage::Pixel:
+                deviceContext_->PSSetSamplers(slot, 1, &sampler);
+                break;
+            case ShaderStage::Geometry:
+                deviceContext_->GSSetSamplers(slot, 1, &sampler);
+                break;
+            }
+        }
+
+        void SetVertexShader(ID3D11VertexShader* shader) override
+        {
+            deviceContext_->VSSetShader(shader, 0, 0);
+        }
+
+        void SetPixelShader(ID3D11PixelShader* shader) override
+        {
+            deviceContext_->PSSetShader(shader, 0, 0);
+        }
+
+        void SetGeometryShader(ID3D11GeometryShader* shader) override
+        {
+            deviceContext_->GSSetShader(shader, 0, 0);
+        }
+
+        void SetShaderResource(ShaderStage stage, unsigned int slot, ID3D11ShaderResourceView* view) override
+        {
+            switch (stage)
+            {
+            case ShaderStage::Vertex:
+                deviceContext_->VSSetShaderResources(slot, 1, &view);
+                break;
+            case ShaderStage::Pixel:
+                deviceContext_->PSSetShaderResources(slot, 1, &view);
+                break;
+            case ShaderStage::Geometry:
+                deviceContext_->GSSetShaderResources(slot, 1, &view);
+                break;
+            }
+        }
+
+        void SetConstantBuffer(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer) override
+        {
+            switch (stage)
+            {
+            case ShaderStage::Vertex:
+                deviceContext_->VSSetConstantBuffers(slot, 1, &buffer);
+                break;
+            case ShaderStage::Pixel:
+                deviceContext_->PSSetConstantBuffers(slot, 1, &buffer);
+                break;
+            case ShaderStage::Geometry:
+                deviceContext_->GSSetConstantBuffers(slot, 1, &buffer);
+                break;
+            }
+        }
+
+        void SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset) override
+        {
+            deviceContext_->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+        }
+
+        void SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset) override
+        {
+            deviceContext_->IASetIndexBuffer(buffer, static_cast<DXGI_FORMAT>(format), offset);
+        }
+
+        void SetInputLayout(ID3D11InputLayout* layout) override
+        {
+            deviceContext_->IASetInputLayout(layout);
+        }
+
+        void SetPrimitiveTopology(unsigned int topology) override
+        {
+            deviceContext_->IASetPrimitiveTopology(static_cast<D3D11_PRIMITIVE_TOPOLOGY>(topology));
+        }
+
+    private:
+        ID3D11DeviceContext* deviceContext_;
+    };
+
     GraphicsManager::GraphicsManager(const Window& window)
         : w_(window.Width()), h_(window.Height())
     {
         CreateDevice();
+        stateTarget_ = std::make_unique<D3D11StateTarget>(deviceContext_.Get());
+        stateCache_ = std::make_unique<RenderStateCache>(*stateTarget_);
         CreateSwapChain(window);
         CreateRenderTargetView();
         CreateDepthStencilView(window);
@@ -26,6 +139,8 @@ namespace mc
         SetSamplerLinearClamp();
     }
 
+    GraphicsManager::~GraphicsManager() = default;
+
 
     void GraphicsManager::Clear(float r, float g, float b) const
     {
@@ -37,6 +152,8 @@ namespace mc
     void GraphicsManager::Present() const
     {
         swapChain_->Present(1, 0);
+        frameStateStats_ = stateCache_->GetStats();
+        stateCache_->ResetStats();
     }
 
     void  GraphicsManager::SetViewport(float x, float y, float width, float height) const
@@ -55,6 +172,8 @@ namespace mc
     void GraphicsManager::BindBackBuffer()
     {
         deviceContext_->OMSetRenderTargets(1, renderTargetView_.GetAddressOf(), depthStencilView_.Get());
+        // d3d unbinds the inputs that read the new target
+        stateCache_->ForgetShaderResources();
         SetViewport(0.0f, 0.0f, static_cast<float>(w_), static_cast<float>(h_));
     }
 
@@ -174,14 +293,14 @@ namespace mc
 
     void GraphicsManager::SetSamplerLinearClamp() const
     {
-        deviceContext_->PSSetSamplers(0, 1, samplerStateLinearClamp_.GetAddressOf());
-        deviceContext_->GSSetSamplers(0, 1, samplerStateLinearClamp_.GetAddressOf());
+        stateCache_->SetSampler(ShaderStage::Pixel, 0, samplerStateLinearClamp_.Get());
+        stateCache_->SetSampler(ShaderStage::Geometry, 0, samplerStateLinearClamp_.Get());
     }
 
     void GraphicsManager::SetSamplerLinearWrap() const
     {
-        deviceContext_->PSSetSamplers(0, 1, samplerStateLinearWrap_.GetAddressOf());
-        deviceContext_->GSSetSamplers(0, 1, samplerStateLinearWrap_.GetAddressOf());
+        stateCache_->SetSampler(ShaderStage::Pixel, 0, samplerStateLinearWrap_.Get());
+        stateCache_->SetSampler(ShaderStage::Geometry, 0, samplerStateLinearWrap_.Get());
     }
 
     void GraphicsManager::CreateRasterizerStates()
@@ -221,22 +340,22 @@ namespace mc
 
     void GraphicsManager::SetRasterizerStateCullBack() const
     {
-        deviceContext_->RSSetState(fillRasterizerCullBack_.Get());
+        stateCache_->SetRasterizerState(fillRasterizerCullBack_.Get());
     }
 
     void GraphicsManager::SetRasterizerStateCullFront() const
     {
-        deviceContext_->RSSetState(fillRasterizerCullFront_.Get());
+        stateCache_->SetRasterizerState(fillRasterizerCullFront_.Get());
     }
 
     void GraphicsManager::SetRasterizerStateCullNone() const
     {
-        deviceContext_->RSSetState(fillRasterizerCullNone_.Get());
+        stateCache_->SetRasterizerState(fillRasterizerCullNone_.Get());
     }
 
     void GraphicsManager::SetRasterizerStateWireframe() const
     {
-        deviceContext_->RSSetState(wireFrameRasterizer_.Get());
+        stateCache_->SetRasterizerState(wireFrameRasterizer_.Get());
     }
 
 
@@ -277,17 +396,17 @@ namespace mc
 
     void GraphicsManager::SetDepthStencilOn() const
     {
-        deviceContext_->OMSetDepthStencilState(depthStencilOn_.Get(), 1);
+        stateCache_->SetDepthStencilState(depthStencilOn_.Get(), 1);
     }
 
     void GraphicsManager::SetDepthStencilOff() const
     {
-        deviceContext_->OMSetDepthStencilState(depthStencilOff_.Get(), 1);
+        stateCache_->SetDepthStencilState(depthStencilOff_.Get(), 1);
     }
 
     void GraphicsManager::SetDepthStencilOnWriteMaskZero() const
     {
-        deviceContext_->OMSetDepthStencilState(depthStencilOnWriteMaskZero_.Get(), 1);
+        stateCache_->SetDepthStencilState(depthStencilOnWriteMaskZero_.Get(), 1);
     }
 
     void GraphicsManager::CreateBendingStates()
@@ -320,18 +439,18 @@ namespace mc
 
     void GraphicsManager::SetAlphaBlending() const
     {
-        deviceContext_->OMSetBlendState(alphaBlendOn_.Get(), 0, 0xffffffff);
+        stateCache_->SetBlendState(alphaBlendOn_.Get());
     }
 
     void GraphicsManager::SetAdditiveBlending() const
     {
-        deviceContext_->OMSetBlendState(additiveBlending_.Get(), 0, 0xffffffff);
+        stateCache_->SetBlendState(additiveBlending_.Get());
 
     }
 
     void GraphicsManager::SetBlendingOff() const
     {
-        deviceContext_->OMSetBlendState(alphaBlendOff_.Get(), 0, 0xffffffff);
+        stateCache_->SetBlendState(alphaBlendOff_.Get());
     }
 
 }
\ No newline at end of file
@@ -1,21 +1,25 @@
 #pragma once
 
 #include "Window.h"
+#include "RenderStateCache.h"
 
 #include <d3d11.h>
 #include <wrl.h>
 
 #include <vector>
 #include <string>
+#include <memory>
 
 namespace mc
 {
+    class D3D11StateTarget;
+
     class GraphicsManager
     {
         friend class GraphicsResource;
     public:
         GraphicsManager(const Window& window);
-        ~GraphicsManager() = default;
+        ~GraphicsManager();
         GraphicsManager(const GraphicsManager&) = delete;
         GraphicsManager& operator=(const GraphicsManager&) = delete;
             
@@ -40,6 +44,9 @@ namespace mc
         void SetAdditiveBlending() const;
         void SetBlendingOff() const;   
 
+        // issued and filtered state calls of the last presented frame
+        const RenderStateStats& GetStateStats() const { return frameStateStats_; }
+
     private:
         void CreateDevice();
         void CreateSwapChain(const Window& window);
@@ -72,6 +79,11 @@ namespace mc
         Microsoft::WRL::ComPtr<ID3D11BlendState> alphaBlendOff_;
         Microsoft::WRL::ComPtr<ID3D11BlendState> additiveBlending_;
 
+        // every state call of the resources goes through the cache to the device context
+        std::unique_ptr<D3D11StateTarget> stateTarget_;
+        std::unique_ptr<RenderStateCache> stateCache_;
+        mutable RenderStateStats frameStateStats_{};
+
         unsigned int w_, h_;
     };
 
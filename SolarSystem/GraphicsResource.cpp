@@ -11,4 +11,9 @@ namespace mc
     {
         return gm.deviceContext_.Get();
     }
+
+    RenderStateCache& GraphicsResource::GetStateCache(const GraphicsManager& gm)
+    {
+        return *gm.stateCache_;
+    }
 }
\ No newline at end of file
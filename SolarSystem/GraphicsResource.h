@@ -9,6 +9,8 @@ namespace mc
     protected:
         static ID3D11Device* GetDevice(const GraphicsManager& gm);
         static ID3D11DeviceContext* GetDeviceContext(const GraphicsManager& gm);
+        // binds state without repeating what is already bound, prefer it to the device context for Set calls
+        static RenderStateCache& GetStateCache(const GraphicsManager& gm);
     };
 }
 
@@ -1,28 +1,41 @@
 #include "IndexBuffer.h"
 #include <stdexcept>
+#include <vector>
+#include <algorithm>
 
 namespace mc
 {
-    IndexBuffer::IndexBuffer(const GraphicsManager& gm, unsigned int* indices, unsigned int count)
+    IndexBuffer::IndexBuffer(const GraphicsManager& gm, const unsigned int* indices, unsigned int count)
         : indexCount(count), format(DXGI_FORMAT_R32_UINT)
     {
+        // use 16 bits indices when all the indices fit, it halves the index memory
+        std::vector<unsigned short> shortIndices;
+        unsigned int maxIndex = count > 0 ? *std::max_element(indices, indices + count) : 0;
+        if (maxIndex <= 0xFFFF)
+        {
+            shortIndices.assign(indices, indices + count);
+            format = DXGI_FORMAT_R16_UINT;
+        }
+
         D3D11_BUFFER_DESC indexDesc;
         ZeroMemory(&indexDesc, sizeof(indexDesc));
         indexDesc.Usage = D3D11_USAGE_IMMUTABLE;
         indexDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-        indexDesc.ByteWidth = sizeof(unsigned int) * count;
+        indexDesc.ByteWidth = format == DXGI_FORMAT_R16_UINT ?
+            sizeof(unsigned short) * count : sizeof(unsigned int) * count;
 
         D3D11_SUBRESOURCE_DATA subresourceData;
         ZeroMemory(&subresourceData, sizeof(subresourceData));
-        subresourceData.pSysMem = indices;
+        subresourceData.pSysMem = format == DXGI_FORMAT_R16_UINT ?
+            static_cast<const void*>(shortIndices.data()) : static_cast<const void*>(indices);
         if (FAILED(GetDevice(gm)->CreateBuffer(&indexDesc, &subresourceData, &buffer)))
         {
-            throw std::runtime_error("Error creating vertex buffer");
+            throw std::runtime_error("Error creating index buffer");
         }
     }
 
     void IndexBuffer::Bind(const GraphicsManager& gm)
     {
-        GetDeviceContext(gm)->IASetIndexBuffer(buffer.Get(), format, 0);
+        GetStateCache(gm).SetIndexBuffer(buffer.Get(), format, 0);
     }
 }
\ No newline at end of file
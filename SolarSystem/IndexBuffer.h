@@ -10,7 +10,7 @@ namespace mc
         IndexBuffer(const IndexBuffer&) = delete;
         IndexBuffer& operator=(const IndexBuffer&) = delete;
 
-        IndexBuffer(const GraphicsManager& gm, unsigned int *indices, unsigned int count);
+        IndexBuffer(const GraphicsManager& gm, const unsigned int *indices, unsigned int count);
         void Bind(const GraphicsManager& gm);
     private:
         Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
@@ -19,6 +19,6 @@ namespace mc
 
     void InputLayout::Bind(const GraphicsManager& gm)
     {
-        GetDeviceContext(gm)->IASetInputLayout(layout.Get());
+        GetStateCache(gm).SetInputLayout(layout.Get());
     }
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "InputLog.h"
+#include "Utils.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <stdexcept>
+
+namespace mc
+{
+    namespace
+    {
+        const char inputLogMagic[4] = { 'M', 'C', 'I', 'L' };
+        const unsigned int inputLogVersion = 1;
+
+        const unsigned char inputLeft = 1 << 0;
+        const unsigned char inputRight = 1 << 1;
+        const unsigned char inputThrust = 1 << 2;
+    }
+
+    InputLog::InputLog(unsigned int stepRate)
+        : stepRate_(stepRate)
+    {
+    }
+
+    InputLog::InputLog(const std::string& filepath)
+    {
+        MappedFile file(filepath);
+        if (file.size < sizeof(InputLogHeader))
+        {
+            throw std::runtime_error("Error reading input log: " + filepath);
+        }
+        InputLogHeader header;
+        std::memcpy(&header, file.data, sizeof(header));
+        if (std::memcmp(header.magic, inputLogMagic, sizeof(inputLogMagic)) != 0 ||
+            header.version != inputLogVersion ||
+            file.size != sizeof(InputLogHeader) + static_cast<size_t>(header.stepCount))
+        {
+            throw std::runtime_error("Error invalid input log: " + filepath);
+        }
+        stepRate_ = header.stepRate;
+        steps_.assign(file.data + sizeof(InputLogHeader), file.data + file.size);
+    }
+
+    InputLog InputLog::LoadScript(const std::string& filepath, unsigned int stepRate)
+    {
+        std::ifstream file(filepath);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Error reading input script: " + filepath);
+        }
+        InputLog log(stepRate);
+        std::string line;
+        unsigned int lineNumber = 0;
+        while (std::getline(file, line))
+        {
+            lineNumber++;
+            std::istringstream stream(line);
+            std::string keys;
+            float seconds;
+            if (!(stream >> keys) || keys[0] == '#')
+            {
+                continue;
+            }
+            stream.clear();
+            stream.str(line);
+            if (!(stream >> seconds >> keys) || seconds < 0.0f)
+            {
+                throw std::runtime_error("Error invalid input script line " + std::to_string(lineNumber) + ": " + filepath);
+            }
+            ShipInput input;
+            for (char key : keys)
+            {
+                switch (key)
+                {
+                case 'L': input.left = true; break;
+                case 'R': input.right = true; break;
+                case 'T': input.thrust = true; break;
+                case '-': break;
+                default:
+                    throw std::runtime_error("Error invalid input script key on line " + std::to_string(lineNumber) + ": " + filepath);
+                }
+            }
+            unsigned int steps = static_cast<unsigned int>(std::lround(seconds * stepRate));
+            for (unsigned int i = 0; i < steps; i++)
+            {
+                log.Record(input);
+            }
+        }
+        return log;
+    }
+
+    void InputLog::Record(const ShipInput& input)
+    {
+        unsigned char step = 0;
+        step |= input.left ? inputLeft : 0;
+        step |= input.right ? inputRight : 0;
+        step |= input.thrust ? inputThrust : 0;
+        steps_.push_back(step);
+    }
+
+    bool InputLog::Next(ShipInput& input)
+    {
+        if (next_ >= steps_.size())
+        {
+            return false;
+        }
+        unsigned char step = steps_[next_++];
+        input.left = (step & inputLeft) != 0;
+        input.right = (step & inputRight) != 0;
+        input.thrust = (step & inputThrust) != 0;
+        return true;
+    }
+
+    void InputLog::Save(const std::string& filepath) const
+    {
+        InputLogHeader header{};
+        std::memcpy(header.magic, inputLogMagic, sizeof(inputLogMagic));
+        header.version = inputLogVersion;
+        header.stepRate = stepRate_;
+        header.stepCount = static_cast<unsigned int>(steps_.size());
+
+        std::ofstream file(filepath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Error writing input log: " + filepath);
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(steps_.data()), steps_.size());
+        if (!file.good())
+        {
+            throw std::runtime_error("Error writing input log: " + filepath);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Ship.h"
+
+#include <string>
+#include <vector>
+
+namespace mc
+{
+    // Layout of the .input files, the header is followed by one byte per physics step
+    // with bit 0 left, bit 1 right and bit 2 thrust.
+    struct InputLogHeader
+    {
+        char magic[4];
+        unsigned int version;
+        unsigned int stepRate;
+        unsigned int stepCount;
+    };
+
+    // Ship inputs of every physics step of a run. Feeding them back with the same step rate
+    // repeats the run bit for bit, no matter how the steps were spread over the frames.
+    // SolarSystemSim --replay-test checks it.
+    class InputLog
+    {
+    public:
+        InputLog(unsigned int stepRate);
+        // Loads a log written by Save
+        InputLog(const std::string& filepath);
+        // Builds a log from a text script, one line per stretch of steps: the seconds it lasts and the keys held,
+        // any of L (left), R (right) and T (thrust) or - for none. Lines starting with # are skipped.
+        //   1.5 T
+        //   0.25 TR
+        static InputLog LoadScript(const std::string& filepath, unsigned int stepRate);
+
+        void Record(const ShipInput& input);
+        // Returns false once all the steps have been read
+        bool Next(ShipInput& input);
+        // Next starts again from the first step
+        void Rewind() { next_ = 0; }
+        void Save(const std::string& filepath) const;
+
+        unsigned int GetStepRate() const { return stepRate_; }
+        size_t GetStepCount() const { return steps_.size(); }
+
+    private:
+        unsigned int stepRate_;
+        std::vector<unsigned char> steps_;
+        size_t next_{ 0 };
+    };
+}
@@ -0,0 +1,30 @@
+#include "InstanceBatcher.h"
+
+namespace mc
+{
+// PUBLICS:
+    void InstanceBatcher::Build(const unsigned long long* batchKeys, size_t count, std::vector<InstanceBatch>& batches)
+    {
+        batches.clear();
+        size_t first = 0;
+        for (size_t i = 1; i <= count; i++)
+        {
+            if (i == count || batchKeys[i] != batchKeys[first])
+            {
+                batches.push_back(InstanceBatch{ static_cast<unsigned int>(first), static_cast<unsigned int>(i - first) });
+                first = i;
+            }
+        }
+    }
+
+    void InstanceBatcher::PackInstance(const XMFLOAT4X4& world, const MeshBounds& bounds, ObjectInstance& instance)
+    {
+        // the rows of the transpose are the columns of world, the shader dots them with the position
+        XMMATRIX transposed = XMMatrixTranspose(XMLoadFloat4x4(&world));
+        XMStoreFloat4(&instance.model[0], transposed.r[0]);
+        XMStoreFloat4(&instance.model[1], transposed.r[1]);
+        XMStoreFloat4(&instance.model[2], transposed.r[2]);
+        instance.positionScale = XMFLOAT4(bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z, 0.0f);
+        instance.positionOffset = XMFLOAT4(bounds.min.x, bounds.min.y, bounds.min.z, 0.0f);
+    }
+}
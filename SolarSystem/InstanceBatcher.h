@@ -0,0 +1,29 @@
+#pragma once
+
+#include "GameConstBuffers.h"
+#include "GeometryGenerator.h"
+
+#include <vector>
+
+namespace mc
+{
+    // A run of draws of the same mesh with the same state, drawn as one instanced draw
+    struct InstanceBatch
+    {
+        // index of the first draw of the run
+        unsigned int first;
+        unsigned int count;
+    };
+
+    // Groups sorted draws into instanced draws without the GPU. Every draw has a batch key that says what two
+    // draws must share to be instanced together, for Scene the mesh, LOD, shaders, texture and rasterizer state.
+    // Only consecutive draws are grouped so the order of the draws is kept, sorting by state first is what
+    // makes the runs long.
+    class InstanceBatcher
+    {
+    public:
+        static void Build(const unsigned long long* batchKeys, size_t count, std::vector<InstanceBatch>& batches);
+        // The instance data that draws a mesh with PackedVertex positions dequantized by bounds with the world matrix
+        static void PackInstance(const XMFLOAT4X4& world, const MeshBounds& bounds, ObjectInstance& instance);
+    };
+}
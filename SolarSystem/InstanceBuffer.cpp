@@ -0,0 +1,51 @@
+#include "InstanceBuffer.h"
+#include <stdexcept>
+
+namespace mc
+{
+    InstanceBuffer::InstanceBuffer(const GraphicsManager& gm, unsigned int stride, unsigned int capacity)
+        : stride_(stride)
+    {
+        Create(gm, capacity);
+    }
+
+    void InstanceBuffer::Update(const GraphicsManager& gm, const void* instances, unsigned int count)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        if (count > capacity_)
+        {
+            Create(gm, count + count / 2);
+        }
+        D3D11_MAPPED_SUBRESOURCE mappedSubResource;
+        if (FAILED(GetDeviceContext(gm)->Map(buffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedSubResource)))
+        {
+            throw std::runtime_error("Error updating instance buffer");
+        }
+        memcpy(mappedSubResource.pData, instances, static_cast<size_t>(stride_) * count);
+        GetDeviceContext(gm)->Unmap(buffer_.Get(), 0);
+    }
+
+    void InstanceBuffer::Bind(const GraphicsManager& gm, unsigned int slot)
+    {
+        GetStateCache(gm).SetVertexBuffer(slot, buffer_.Get(), stride_, 0);
+    }
+
+// PRIVATES:
+    void InstanceBuffer::Create(const GraphicsManager& gm, unsigned int capacity)
+    {
+        D3D11_BUFFER_DESC instanceDesc;
+        ZeroMemory(&instanceDesc, sizeof(instanceDesc));
+        instanceDesc.Usage = D3D11_USAGE_DYNAMIC;
+        instanceDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        instanceDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        instanceDesc.ByteWidth = stride_ * capacity;
+        if (FAILED(GetDevice(gm)->CreateBuffer(&instanceDesc, nullptr, &buffer_)))
+        {
+            throw std::runtime_error("Error creating instance buffer");
+        }
+        capacity_ = capacity;
+    }
+}
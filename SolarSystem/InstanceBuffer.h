@@ -0,0 +1,25 @@
+#pragma once
+
+#include "GraphicsResource.h"
+
+namespace mc
+{
+    // Dynamic vertex buffer with the per instance data of instanced draws, rewritten every frame
+    class InstanceBuffer : public GraphicsResource
+    {
+    public:
+        InstanceBuffer(const InstanceBuffer&) = delete;
+        InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+        InstanceBuffer(const GraphicsManager& gm, unsigned int stride, unsigned int capacity);
+        // Replaces the content with count instances, the buffer grows when they dont fit
+        void Update(const GraphicsManager& gm, const void* instances, unsigned int count);
+        void Bind(const GraphicsManager& gm, unsigned int slot);
+    private:
+        void Create(const GraphicsManager& gm, unsigned int capacity);
+
+        Microsoft::WRL::ComPtr<ID3D11Buffer> buffer_;
+        unsigned int stride_;
+        unsigned int capacity_{ 0 };
+    };
+}
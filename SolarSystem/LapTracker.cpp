@@ -0,0 +1,98 @@
+#include "LapTracker.h"
+
+#include <algorithm>
+
+namespace mc
+{
+    namespace
+    {
+        // backwards travel along the centerline before the ship is going the wrong way, about half the track width
+        const float wrongWayDistance = 0.25f;
+    }
+
+// PUBLICS:
+    LapTracker::LapTracker(const TrackSpline& track, unsigned int sectorCount)
+        : track_(track), sectorCount_(sectorCount), sectorTimes_(sectorCount, 0.0), lastSectorTimes_(sectorCount, 0.0)
+    {
+    }
+
+    LapTracker::Event LapTracker::Update(const XMFLOAT3& shipPosition, float dt)
+    {
+        Event event = Event::None;
+
+        TrackLocation location = track_.Project(XMLoadFloat3(&shipPosition), segmentHint_);
+        segmentHint_ = location.segment;
+        float length = track_.GetLength();
+        if (distance_ < 0.0f)
+        {
+            distance_ = location.distance;
+        }
+
+        // a step is much shorter than half a lap, a bigger jump of the distance is the finish line
+        float travel = location.distance - distance_;
+        bool crossedFinish = false;
+        if (travel < -0.5f * length)
+        {
+            travel += length;
+            crossedFinish = true;
+        }
+        else if (travel > 0.5f * length)
+        {
+            travel -= length;
+        }
+        distance_ = location.distance;
+
+        if (travel < 0.0f)
+        {
+            backwardDistance_ -= travel;
+        }
+        else
+        {
+            backwardDistance_ = std::max(backwardDistance_ - travel, 0.0f);
+        }
+        wrongWay_ = backwardDistance_ > wrongWayDistance;
+
+        unsigned int sector = std::min(static_cast<unsigned int>(location.distance / length * sectorCount_), sectorCount_ - 1);
+        if (crossedFinish)
+        {
+            if (!lapsStart_)
+            {
+                lapsStart_ = true;
+                nextSector_ = 1;
+                event = Event::LapStarted;
+            }
+            else if (nextSector_ == sectorCount_)
+            {
+                sectorTimes_[sectorCount_ - 1] = currentLapTime_;
+                lastSectorTimes_ = sectorTimes_;
+                lastLapTime_ = currentLapTime_;
+                if ((currentLapTime_ < bestLapTime_) || firstLap_)
+                {
+                    bestLapTime_ = currentLapTime_;
+                    firstLap_ = false;
+                }
+                currentLapTime_ = 0.0f;
+                lapCount_++;
+                nextSector_ = 1;
+                event = Event::LapCompleted;
+            }
+        }
+        else if (lapsStart_ && travel > 0.0f && sector == nextSector_)
+        {
+            sectorTimes_[nextSector_ - 1] = currentLapTime_;
+            nextSector_++;
+            event = Event::SectorCompleted;
+        }
+
+        if (lapsStart_)
+        {
+            currentLapTime_ += dt;
+        }
+        return event;
+    }
+
+    float LapTracker::GetLapProgress() const
+    {
+        return distance_ < 0.0f ? 0.0f : distance_ / track_.GetLength();
+    }
+}
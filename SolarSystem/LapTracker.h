@@ -0,0 +1,62 @@
+#pragma once
+
+#include "TrackSpline.h"
+
+#include <vector>
+
+namespace mc
+{
+    // Lap timing of one ship from its progress along the centerline of the track. The lap is split in
+    // sectors of the same length, a lap counts once the ship went through all of them in order.
+    class LapTracker
+    {
+    public:
+        enum class Event
+        {
+            None,
+            // the ship crossed the finish line for the first time, the lap clock is running from now on
+            LapStarted,
+            SectorCompleted,
+            LapCompleted
+        };
+
+        // track must outlive the tracker, it can be baked after the tracker is made
+        LapTracker(const TrackSpline& track, unsigned int sectorCount = 8);
+
+        // Call once per physics step after the ship moved
+        Event Update(const XMFLOAT3& shipPosition, float dt);
+
+        double GetCurrentLapTime() const { return currentLapTime_; }
+        double GetLastLapTime() const { return lastLapTime_; }
+        double GetBestLapTime() const { return bestLapTime_; }
+        unsigned int GetLapCount() const { return lapCount_; }
+        // fraction of the lap from the finish line, in [0, 1)
+        float GetLapProgress() const;
+        // lap time at the end of every sector of the current lap, only the sectors done so far are valid
+        const std::vector<double>& GetSectorTimes() const { return sectorTimes_; }
+        const std::vector<double>& GetLastSectorTimes() const { return lastSectorTimes_; }
+        // the ship has been going backwards along the track for a while
+        bool IsWrongWay() const { return wrongWay_; }
+
+    private:
+        const TrackSpline& track_;
+        unsigned int sectorCount_;
+
+        unsigned int segmentHint_{ TrackSpline::noSegment };
+        float distance_{ -1.0f };
+        // next sector to enter, the lap is done when the ship crosses the finish line after entering all of them
+        unsigned int nextSector_{ 0 };
+        float backwardDistance_{ 0.0f };
+        bool wrongWay_{ false };
+
+        double currentLapTime_{ 0 };
+        double lastLapTime_{ 0 };
+        double bestLapTime_{ 0 };
+        unsigned int lapCount_{ 0 };
+        std::vector<double> sectorTimes_;
+        std::vector<double> lastSectorTimes_;
+
+        bool lapsStart_{ false };
+        bool firstLap_{ true };
+    };
+}
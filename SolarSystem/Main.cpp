@@ -1,11 +1,40 @@
 #include "Game.h"
 
-int main()
+#include <filesystem>
+
+int main(int argc, char* argv[])
 {
     try
     {
+        // offline step: bake every OBJ of the game into the binary mesh cache and exit
+        if (argc > 1 && std::string(argv[1]) == "--bake")
+        {
+            for (const auto& entry : std::filesystem::directory_iterator("assets/mesh"))
+            {
+                if (entry.path().extension() == ".obj")
+                {
+                    std::cout << "Baking: " << entry.path().string() << "\n";
+                    mc::MeshCache::Bake(entry.path().string());
+                }
+            }
+            return 0;
+        }
+
         srand(time(0));
         mc::Game game;
+        // --record file writes the inputs of every physics step, --replay file plays them back
+        for (int i = 1; i + 1 < argc; i++)
+        {
+            std::string option(argv[i]);
+            if (option == "--record")
+            {
+                game.RecordInput(argv[++i]);
+            }
+            else if (option == "--replay")
+            {
+                game.ReplayInput(argv[++i]);
+            }
+        }
         game.Run();
     }
     catch (std::exception& e)
@@ -10,29 +10,87 @@ namespace mc
         size_t count, bool indexed)
         : vb_(vb), il_(il), ib_(ib), count_(count), indexed_(indexed) { }
 
-    void Mesh::Draw(const GraphicsManager& gm)
+    void Mesh::Draw(const GraphicsManager& gm, unsigned int lod, bool bind)
     {
-        if (vb_)
+        if (bind)
         {
-            vb_->Bind(gm);
+            Bind(gm, il_);
         }
-        if (il_)
+        if (indexed_ && lod < lods_.size())
         {
-            il_->Bind(gm);
+            GetDeviceContext(gm)->DrawIndexed(lods_[lod].indexCount, lods_[lod].indexOffset, 0);
         }
-        if (ib_)
+        else if (indexed_)
         {
-            ib_->Bind(gm);
+            GetDeviceContext(gm)->DrawIndexed(static_cast<UINT>(count_), 0, 0);
+        }
+        else
+        {
+            GetDeviceContext(gm)->Draw(static_cast<UINT>(count_), 0);
+        }
+    }
+
+    void Mesh::DrawRanges(const GraphicsManager& gm, const IndexRange* ranges, size_t count, bool bind)
+    {
+        if (bind)
+        {
+            Bind(gm, il_);
         }
+        for (size_t i = 0; i < count; i++)
+        {
+            GetDeviceContext(gm)->DrawIndexed(ranges[i].indexCount, ranges[i].indexOffset, 0);
+        }
+    }
 
-        GetDeviceContext(gm)->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        if (indexed_)
+    void Mesh::DrawInstanced(const GraphicsManager& gm, InputLayout* layout, unsigned int instanceCount,
+        unsigned int startInstance, unsigned int lod, bool bind)
+    {
+        if (bind)
         {
-            GetDeviceContext(gm)->DrawIndexed(static_cast<UINT>(count_), 0, 0);
+            Bind(gm, layout);
+        }
+        if (indexed_ && lod < lods_.size())
+        {
+            GetDeviceContext(gm)->DrawIndexedInstanced(lods_[lod].indexCount, instanceCount, lods_[lod].indexOffset, 0, startInstance);
+        }
+        else if (indexed_)
+        {
+            GetDeviceContext(gm)->DrawIndexedInstanced(static_cast<UINT>(count_), instanceCount, 0, 0, startInstance);
         }
         else
         {
-            GetDeviceContext(gm)->Draw(static_cast<UINT>(count_), 0);
+            GetDeviceContext(gm)->DrawInstanced(static_cast<UINT>(count_), instanceCount, 0, startInstance);
+        }
+    }
+
+    void Mesh::DrawRangesInstanced(const GraphicsManager& gm, InputLayout* layout, const IndexRange* ranges, size_t count,
+        unsigned int instanceCount, unsigned int startInstance, bool bind)
+    {
+        if (bind)
+        {
+            Bind(gm, layout);
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            GetDeviceContext(gm)->DrawIndexedInstanced(ranges[i].indexCount, instanceCount, ranges[i].indexOffset, 0, startInstance);
+        }
+    }
+
+// PRIVATES:
+    void Mesh::Bind(const GraphicsManager& gm, InputLayout* layout)
+    {
+        if (vb_)
+        {
+            vb_->Bind(gm);
+        }
+        if (layout)
+        {
+            layout->Bind(gm);
+        }
+        if (ib_)
+        {
+            ib_->Bind(gm);
         }
+        GetStateCache(gm).SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
     }
 }
\ No newline at end of file
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "GraphicsResource.h"
+#include "GeometryGenerator.h"
+#include "ClusterCuller.h"
+
+#include <vector>
 
 namespace mc
 {
@@ -17,13 +21,37 @@ namespace mc
             IndexBuffer* ib = nullptr,
             size_t count = 0, bool indexed = false);
 
-        void Draw(const mc::GraphicsManager& gm);
+        // The LOD ranges index into the same index buffer, without them the mesh has a single level
+        void SetLods(const MeshLod* lods, unsigned int count) { lods_.assign(lods, lods + count); }
+        void SetBounds(const MeshBounds& bounds) { bounds_ = bounds; }
+        unsigned int GetLodCount() const { return static_cast<unsigned int>(lods_.size()); }
+        float GetLodError(unsigned int lod) const { return lods_[lod].error; }
+        const MeshBounds& GetBounds() const { return bounds_; }
+        // Clusters of the full detail LOD, used to draw only the visible parts of big meshes
+        void SetClusters(const MeshCluster* clusters, unsigned int count) { clusters_.assign(clusters, clusters + count); }
+        const MeshCluster* GetClusters() const { return clusters_.data(); }
+        unsigned int GetClusterCount() const { return static_cast<unsigned int>(clusters_.size()); }
+
+        // bind false skips binding the buffers, for a mesh drawn again right after itself
+        void Draw(const mc::GraphicsManager& gm, unsigned int lod = 0, bool bind = true);
+        void DrawRanges(const mc::GraphicsManager& gm, const IndexRange* ranges, size_t count, bool bind = true);
+        // Draws instanceCount copies with the instances from startInstance of the instance buffer bound to slot 1,
+        // layout replaces the input layout of the mesh with one that also reads the instance data
+        void DrawInstanced(const mc::GraphicsManager& gm, InputLayout* layout, unsigned int instanceCount,
+            unsigned int startInstance, unsigned int lod = 0, bool bind = true);
+        void DrawRangesInstanced(const mc::GraphicsManager& gm, InputLayout* layout, const IndexRange* ranges, size_t count,
+            unsigned int instanceCount, unsigned int startInstance, bool bind = true);
     private:
+        void Bind(const mc::GraphicsManager& gm, InputLayout* layout);
+
         VertexBuffer* vb_{ nullptr };
         InputLayout* il_{ nullptr };
         IndexBuffer* ib_{ nullptr };
         size_t count_{0};
         bool indexed_{false};
+        std::vector<MeshLod> lods_;
+        std::vector<MeshCluster> clusters_;
+        MeshBounds bounds_{};
     };
 }
 
@@ -0,0 +1,179 @@
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshClusterizer.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+namespace mc
+{
+    namespace
+    {
+        const char meshCacheMagic[4] = { 'M', 'C', 'M', 'B' };
+        const unsigned int meshCacheVersion = 5;
+    }
+
+    MeshCache::MeshCache(const std::string& objPath)
+    {
+        std::string cachePath = GetCachePath(objPath);
+        unsigned long long sourceHash = HashFile(objPath);
+        if (Map(cachePath, sourceHash))
+        {
+            return;
+        }
+
+        LoadOptimized(meshData_, objPath);
+        bounds_ = GeometryGenerator::ComputeBounds(meshData_.vertices.data(), meshData_.vertices.size());
+        GeometryGenerator::PackVertices(meshData_.vertices.data(), meshData_.vertices.size(), bounds_, packedVertices_);
+        try
+        {
+            Write(cachePath, meshData_, bounds_, packedVertices_, sourceHash);
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "Error: " << e.what() << "\n";
+        }
+
+        vertices_ = packedVertices_.data();
+        vertexCount_ = static_cast<unsigned int>(packedVertices_.size());
+        indices_ = meshData_.indices.data();
+        indexCount_ = static_cast<unsigned int>(meshData_.indices.size());
+        lods_ = meshData_.lods.data();
+        lodCount_ = static_cast<unsigned int>(meshData_.lods.size());
+        clusters_ = meshData_.clusters.data();
+        clusterCount_ = static_cast<unsigned int>(meshData_.clusters.size());
+    }
+
+    void MeshCache::Bake(const std::string& objPath)
+    {
+        MeshData meshData;
+        LoadOptimized(meshData, objPath);
+        MeshBounds bounds = GeometryGenerator::ComputeBounds(meshData.vertices.data(), meshData.vertices.size());
+        std::vector<PackedVertex> packedVertices;
+        GeometryGenerator::PackVertices(meshData.vertices.data(), meshData.vertices.size(), bounds, packedVertices);
+        Write(GetCachePath(objPath), meshData, bounds, packedVertices, HashFile(objPath));
+    }
+
+    std::string MeshCache::GetCachePath(const std::string& objPath)
+    {
+        return std::filesystem::path(objPath).replace_extension(".mesh").string();
+    }
+
+// PRIVATES:
+    void MeshCache::LoadOptimized(MeshData& meshData, const std::string& objPath)
+    {
+        GeometryGenerator::LoadOBJFile(meshData, objPath);
+
+        VertexCacheStats before = MeshOptimizer::SimulateVertexCache(meshData.indices, meshData.vertices.size());
+        MeshOptimizer::Optimize(meshData);
+        VertexCacheStats after = MeshOptimizer::SimulateVertexCache(meshData.indices, meshData.vertices.size());
+        std::cout << "Mesh optimized: " << objPath
+            << " ACMR " << before.acmr << " -> " << after.acmr
+            << " ATVR " << before.atvr << " -> " << after.atvr << "\n";
+
+        MeshSimplifier::BuildLodChain(meshData);
+        for (size_t i = 1; i < meshData.lods.size(); i++)
+        {
+            std::cout << "Mesh LOD " << i << ": " << objPath
+                << " triangles " << meshData.lods[i].indexCount / 3
+                << " error " << meshData.lods[i].error << "\n";
+        }
+
+        MeshClusterizer::BuildClusters(meshData);
+        std::cout << "Mesh clusters: " << objPath << " " << meshData.clusters.size() << "\n";
+    }
+
+    bool MeshCache::Map(const std::string& cachePath, unsigned long long sourceHash)
+    {
+        if (!std::filesystem::exists(cachePath))
+        {
+            return false;
+        }
+
+        auto file = std::make_unique<MappedFile>(cachePath);
+        if (file->size < sizeof(MeshCacheHeader))
+        {
+            return false;
+        }
+
+        const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(file->data);
+        if (std::memcmp(header->magic, meshCacheMagic, sizeof(meshCacheMagic)) != 0 ||
+            header->version != meshCacheVersion ||
+            header->vertexStride != sizeof(PackedVertex) ||
+            header->sourceHash != sourceHash)
+        {
+            return false;
+        }
+
+        size_t expectedSize = sizeof(MeshCacheHeader) +
+            static_cast<size_t>(header->vertexCount) * sizeof(PackedVertex) +
+            static_cast<size_t>(header->indexCount) * sizeof(unsigned int) +
+            static_cast<size_t>(header->lodCount) * sizeof(MeshLod) +
+            static_cast<size_t>(header->clusterCount) * sizeof(MeshCluster);
+        if (file->size != expectedSize)
+        {
+            return false;
+        }
+
+        // the vertices and indices are used straight from the mapped memory
+        const char* data = file->data + sizeof(MeshCacheHeader);
+        vertices_ = reinterpret_cast<const PackedVertex*>(data);
+        vertexCount_ = header->vertexCount;
+        indices_ = reinterpret_cast<const unsigned int*>(data + static_cast<size_t>(vertexCount_) * sizeof(PackedVertex));
+        indexCount_ = header->indexCount;
+        lods_ = reinterpret_cast<const MeshLod*>(data + static_cast<size_t>(vertexCount_) * sizeof(PackedVertex) +
+            static_cast<size_t>(indexCount_) * sizeof(unsigned int));
+        lodCount_ = header->lodCount;
+        clusters_ = reinterpret_cast<const MeshCluster*>(lods_ + lodCount_);
+        clusterCount_ = header->clusterCount;
+        bounds_ = header->bounds;
+        file_ = std::move(file);
+        return true;
+    }
+
+    void MeshCache::Write(const std::string& cachePath, const MeshData& meshData, const MeshBounds& bounds,
+        const std::vector<PackedVertex>& packedVertices, unsigned long long sourceHash)
+    {
+        MeshCacheHeader header{};
+        std::memcpy(header.magic, meshCacheMagic, sizeof(meshCacheMagic));
+        header.version = meshCacheVersion;
+        header.vertexStride = sizeof(PackedVertex);
+        header.vertexCount = static_cast<unsigned int>(packedVertices.size());
+        header.indexCount = static_cast<unsigned int>(meshData.indices.size());
+        header.lodCount = static_cast<unsigned int>(meshData.lods.size());
+        header.clusterCount = static_cast<unsigned int>(meshData.clusters.size());
+        header.sourceHash = sourceHash;
+        header.bounds = bounds;
+
+        std::ofstream file(cachePath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Error writing mesh cache: " + cachePath);
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(packedVertices.data()), packedVertices.size() * sizeof(PackedVertex));
+        file.write(reinterpret_cast<const char*>(meshData.indices.data()), meshData.indices.size() * sizeof(unsigned int));
+        file.write(reinterpret_cast<const char*>(meshData.lods.data()), meshData.lods.size() * sizeof(MeshLod));
+        file.write(reinterpret_cast<const char*>(meshData.clusters.data()), meshData.clusters.size() * sizeof(MeshCluster));
+        if (!file.good())
+        {
+            throw std::runtime_error("Error writing mesh cache: " + cachePath);
+        }
+    }
+
+    unsigned long long MeshCache::HashFile(const std::string& filepath)
+    {
+        // FNV-1a 64 bits of the source file
+        MappedFile file(filepath);
+        unsigned long long hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < file.size; i++)
+        {
+            hash ^= static_cast<unsigned char>(file.data[i]);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+#include "Utils.h"
+
+#include <memory>
+
+namespace mc
+{
+    // Layout of the baked .mesh files, the header is followed by the vertices
+    // packed as mc::PackedVertex over the header bounds, then by the 32 bits indices of all the LODs,
+    // the MeshLod ranges and the MeshCluster ranges of the full detail LOD.
+    struct MeshCacheHeader
+    {
+        char magic[4];
+        unsigned int version;
+        unsigned int vertexStride;
+        unsigned int vertexCount;
+        unsigned int indexCount;
+        unsigned int lodCount;
+        unsigned int clusterCount;
+        unsigned int pad;
+        unsigned long long sourceHash;
+        MeshBounds bounds;
+    };
+
+    class MeshCache
+    {
+    public:
+        MeshCache(const MeshCache&) = delete;
+        MeshCache& operator=(const MeshCache&) = delete;
+
+        // Maps the baked version of the OBJ file, if the cache is missing or stale the OBJ is parsed,
+        // optimized for the vertex cache, its LOD chain and clusters are built and the cache is written for the next run.
+        MeshCache(const std::string& objPath);
+
+        static void Bake(const std::string& objPath);
+        static std::string GetCachePath(const std::string& objPath);
+
+        // packed over GetBounds(), ready for the vertex buffer
+        const PackedVertex* GetVertices() const { return vertices_; }
+        unsigned int GetVertexCount() const { return vertexCount_; }
+        const unsigned int* GetIndices() const { return indices_; }
+        unsigned int GetIndexCount() const { return indexCount_; }
+        const MeshLod* GetLods() const { return lods_; }
+        unsigned int GetLodCount() const { return lodCount_; }
+        const MeshCluster* GetClusters() const { return clusters_; }
+        unsigned int GetClusterCount() const { return clusterCount_; }
+        const MeshBounds& GetBounds() const { return bounds_; }
+
+    private:
+        static void LoadOptimized(MeshData& meshData, const std::string& objPath);
+        bool Map(const std::string& cachePath, unsigned long long sourceHash);
+        static void Write(const std::string& cachePath, const MeshData& meshData, const MeshBounds& bounds,
+            const std::vector<PackedVertex>& packedVertices, unsigned long long sourceHash);
+        static unsigned long long HashFile(const std::string& filepath);
+
+        std::unique_ptr<MappedFile> file_;
+        // only used when the cache could not be mapped
+        MeshData meshData_;
+        std::vector<PackedVertex> packedVertices_;
+
+        const PackedVertex* vertices_{ nullptr };
+        const unsigned int* indices_{ nullptr };
+        const MeshLod* lods_{ nullptr };
+        const MeshCluster* clusters_{ nullptr };
+        unsigned int vertexCount_{ 0 };
+        unsigned int indexCount_{ 0 };
+        unsigned int lodCount_{ 0 };
+        unsigned int clusterCount_{ 0 };
+        MeshBounds bounds_{};
+    };
+}
@@ -0,0 +1,401 @@
+#include "MeshClusterizer.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace mc
+{
+    namespace
+    {
+        struct PositionKey
+        {
+            unsigned int x, y, z;
+
+            bool operator==(const PositionKey& other) const
+            {
+                return x == other.x && y == other.y && z == other.z;
+            }
+        };
+
+        struct PositionKeyHash
+        {
+            size_t operator()(const PositionKey& key) const
+            {
+                size_t hash = key.x * 73856093u;
+                hash ^= key.y * 19349663u;
+                hash ^= key.z * 83492791u;
+                return hash;
+            }
+        };
+
+        // Uniform grid of the triangle centroids with the number of triangles left in every cell, finds the closest
+        // triangle not emitted yet by searching the cells in growing shells around the position
+        class CentroidGrid
+        {
+        public:
+            explicit CentroidGrid(const std::vector<XMFLOAT3>& centroids)
+                : centroids_(centroids)
+            {
+                XMVECTOR min = XMLoadFloat3(&centroids[0]);
+                XMVECTOR max = min;
+                for (const XMFLOAT3& centroid : centroids)
+                {
+                    min = XMVectorMin(min, XMLoadFloat3(&centroid));
+                    max = XMVectorMax(max, XMLoadFloat3(&centroid));
+                }
+                XMStoreFloat3(&min_, min);
+                XMFLOAT3 extent;
+                XMStoreFloat3(&extent, max - min);
+
+                // about one cell per triangle in the bounds, fewer on a surface
+                float maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+                float cellsPerAxis = std::ceil(std::cbrt(static_cast<float>(centroids.size())));
+                cellSize_ = maxExtent > 0.0f ? maxExtent / cellsPerAxis : 1.0f;
+                dims_[0] = static_cast<int>(extent.x / cellSize_) + 1;
+                dims_[1] = static_cast<int>(extent.y / cellSize_) + 1;
+                dims_[2] = static_cast<int>(extent.z / cellSize_) + 1;
+
+                size_t cellCount = static_cast<size_t>(dims_[0]) * dims_[1] * dims_[2];
+                remaining_.assign(cellCount, 0);
+                std::vector<unsigned int> cells(centroids.size());
+                for (size_t t = 0; t < centroids.size(); t++)
+                {
+                    cells[t] = CellOf(XMLoadFloat3(&centroids[t]));
+                    ++remaining_[cells[t]];
+                }
+                offsets_.assign(cellCount + 1, 0);
+                for (size_t c = 0; c < cellCount; c++)
+                {
+                    offsets_[c + 1] = offsets_[c] + remaining_[c];
+                }
+                triangles_.resize(centroids.size());
+                std::vector<unsigned int> fill(offsets_.begin(), offsets_.end() - 1);
+                for (size_t t = 0; t < centroids.size(); t++)
+                {
+                    triangles_[fill[cells[t]]++] = static_cast<unsigned int>(t);
+                }
+            }
+
+            void Remove(unsigned int triangle)
+            {
+                --remaining_[CellOf(XMLoadFloat3(&centroids_[triangle]))];
+            }
+
+            // same triangle as testing all of them in order: the closest, the first one on a tie
+            unsigned int FindClosest(FXMVECTOR position, const std::vector<bool>& emitted) const
+            {
+                int center[3];
+                CellCoordinates(position, center);
+                int maxShell = std::max(dims_[0], std::max(dims_[1], dims_[2]));
+                unsigned int closest = 0;
+                float closestDistance = FLT_MAX;
+                for (int shell = 0; shell < maxShell; shell++)
+                {
+                    int zEnd = std::min(center[2] + shell, dims_[2] - 1);
+                    int yEnd = std::min(center[1] + shell, dims_[1] - 1);
+                    for (int z = std::max(center[2] - shell, 0); z <= zEnd; z++)
+                    {
+                        for (int y = std::max(center[1] - shell, 0); y <= yEnd; y++)
+                        {
+                            // inside the shell only the two ends of the row are on it
+                            bool onShell = std::abs(z - center[2]) == shell || std::abs(y - center[1]) == shell;
+                            int xStep = onShell ? 1 : 2 * shell;
+                            for (int x = center[0] - shell; x <= center[0] + shell; x += xStep)
+                            {
+                                if (x < 0 || x >= dims_[0])
+                                {
+                                    continue;
+                                }
+                                size_t cell = (static_cast<size_t>(z) * dims_[1] + y) * dims_[0] + x;
+                                if (remaining_[cell] == 0)
+                                {
+                                    continue;
+                                }
+                                for (unsigned int i = offsets_[cell]; i < offsets_[cell + 1]; i++)
+                                {
+                                    unsigned int t = triangles_[i];
+                                    if (emitted[t])
+                                    {
+                                        continue;
+                                    }
+                                    float distance = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&centroids_[t]) - position));
+                                    if (distance < closestDistance || (distance == closestDistance && t < closest))
+                                    {
+                                        closestDistance = distance;
+                                        closest = t;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                    // the cells of the next shells are at least shell cells away
+                    float shellDistance = shell * cellSize_;
+                    if (closestDistance < shellDistance * shellDistance)
+                    {
+                        break;
+                    }
+                }
+                return closest;
+            }
+
+        private:
+            void CellCoordinates(FXMVECTOR position, int coordinates[3]) const
+            {
+                XMFLOAT3 local;
+                XMStoreFloat3(&local, (position - XMLoadFloat3(&min_)) / cellSize_);
+                coordinates[0] = std::clamp(static_cast<int>(local.x), 0, dims_[0] - 1);
+                coordinates[1] = std::clamp(static_cast<int>(local.y), 0, dims_[1] - 1);
+                coordinates[2] = std::clamp(static_cast<int>(local.z), 0, dims_[2] - 1);
+            }
+
+            unsigned int CellOf(FXMVECTOR position) const
+            {
+                int coordinates[3];
+                CellCoordinates(position, coordinates);
+                return static_cast<unsigned int>((coordinates[2] * dims_[1] + coordinates[1]) * dims_[0] + coordinates[0]);
+            }
+
+            const std::vector<XMFLOAT3>& centroids_;
+            XMFLOAT3 min_;
+            float cellSize_;
+            int dims_[3];
+            std::vector<unsigned int> remaining_;
+            // triangles of cell c are triangles_[offsets_[c]] to triangles_[offsets_[c + 1]]
+            std::vector<unsigned int> offsets_;
+            std::vector<unsigned int> triangles_;
+        };
+
+        MeshCluster ComputeClusterBounds(const std::vector<Vertex>& vertices, const unsigned int* indices, size_t indexCount,
+            const std::vector<XMFLOAT3>& normals, const std::vector<unsigned int>& triangles)
+        {
+            MeshCluster cluster{};
+
+            XMVECTOR min = XMLoadFloat3(&vertices[indices[0]].position);
+            XMVECTOR max = min;
+            for (size_t i = 1; i < indexCount; i++)
+            {
+                XMVECTOR position = XMLoadFloat3(&vertices[indices[i]].position);
+                min = XMVectorMin(min, position);
+                max = XMVectorMax(max, position);
+            }
+            XMVECTOR center = (min + max) * 0.5f;
+            float radius = 0.0f;
+            for (size_t i = 0; i < indexCount; i++)
+            {
+                XMVECTOR position = XMLoadFloat3(&vertices[indices[i]].position);
+                radius = std::max(radius, XMVectorGetX(XMVector3Length(position - center)));
+            }
+            XMStoreFloat3(&cluster.center, center);
+            cluster.radius = radius;
+
+            // the cone axis is the average of the face normals, the cutoff is the sine of the widest angle to it
+            XMVECTOR axis = XMVectorZero();
+            for (unsigned int triangle : triangles)
+            {
+                axis += XMLoadFloat3(&normals[triangle]);
+            }
+            cluster.coneCutoff = 1.0f;
+            cluster.coneAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+            if (XMVectorGetX(XMVector3LengthSq(axis)) <= 1e-12f)
+            {
+                return cluster;
+            }
+            axis = XMVector3Normalize(axis);
+            float minDot = 1.0f;
+            for (unsigned int triangle : triangles)
+            {
+                XMVECTOR normal = XMLoadFloat3(&normals[triangle]);
+                if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f)
+                {
+                    minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(axis, normal)));
+                }
+            }
+            XMStoreFloat3(&cluster.coneAxis, axis);
+            if (minDot > 0.0f)
+            {
+                cluster.coneCutoff = std::sqrt(std::max(1.0f - minDot * minDot, 0.0f));
+            }
+            return cluster;
+        }
+    }
+
+// PUBLICS:
+    void MeshClusterizer::BuildClusters(MeshData& meshData, unsigned int maxTriangles)
+    {
+        if (maxTriangles == 0)
+        {
+            throw std::runtime_error("Error clusters need at least one triangle");
+        }
+
+        meshData.clusters.clear();
+        size_t indexCount = meshData.lods.empty() ? meshData.indices.size() : meshData.lods[0].indexCount;
+        size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        const std::vector<Vertex>& vertices = meshData.vertices;
+        std::vector<unsigned int>& indices = meshData.indices;
+
+        // triangles are neighbours when they share a position, hard normal and uv seams dont split the surface
+        std::vector<unsigned int> positionIds(vertices.size());
+        size_t positionCount = 0;
+        {
+            std::unordered_map<PositionKey, unsigned int, PositionKeyHash> positionMap;
+            positionMap.reserve(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++)
+            {
+                PositionKey key;
+                std::memcpy(&key, &vertices[i].position, sizeof(key));
+                auto it = positionMap.emplace(key, static_cast<unsigned int>(positionMap.size())).first;
+                positionIds[i] = it->second;
+            }
+            positionCount = positionMap.size();
+        }
+        std::vector<unsigned int> adjacencyOffsets(positionCount + 1, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+        {
+            ++adjacencyOffsets[positionIds[indices[i]] + 1];
+        }
+        for (size_t i = 0; i < positionCount; i++)
+        {
+            adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+        }
+        std::vector<unsigned int> adjacency(triangleCount * 3);
+        std::vector<unsigned int> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+        {
+            adjacency[adjacencyFill[positionIds[indices[i]]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        std::vector<XMFLOAT3> centroids(triangleCount);
+        std::vector<XMFLOAT3> normals(triangleCount);
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3 + 0]].position);
+            XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].position);
+            XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].position);
+            XMStoreFloat3(&centroids[t], (p0 + p1 + p2) * (1.0f / 3.0f));
+            // clockwise triangles are the front faces, degenerate ones keep a zero normal
+            XMVECTOR normal = XMVector3Cross(p1 - p0, p2 - p0);
+            float length = XMVectorGetX(XMVector3Length(normal));
+            XMStoreFloat3(&normals[t], length > 0.0f ? normal / length : XMVectorZero());
+        }
+
+        CentroidGrid grid(centroids);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<unsigned int> frontierStamp(triangleCount, ~0u);
+        std::vector<unsigned int> frontier;
+        std::vector<unsigned int> clusterTriangles;
+        std::vector<unsigned int> clusterIndices;
+        std::vector<unsigned int> clusterVertices;
+        std::vector<unsigned int> localVertices(vertices.size(), ~0u);
+        std::vector<unsigned int> reordered;
+        reordered.reserve(triangleCount * 3);
+        size_t emittedCount = 0;
+        XMVECTOR lastPosition = XMLoadFloat3(&centroids[0]);
+
+        while (emittedCount < triangleCount)
+        {
+            unsigned int clusterId = static_cast<unsigned int>(meshData.clusters.size());
+
+            // start next to the last triangle of the previous cluster so the clusters follow the surface
+            unsigned int seed = grid.FindClosest(lastPosition, emitted);
+
+            clusterTriangles.clear();
+            frontier.clear();
+            XMVECTOR centroidSum = XMVectorZero();
+            XMVECTOR normalSum = XMVectorZero();
+            unsigned int next = seed;
+            for (;;)
+            {
+                emitted[next] = true;
+                grid.Remove(next);
+                ++emittedCount;
+                clusterTriangles.push_back(next);
+                centroidSum += XMLoadFloat3(&centroids[next]);
+                normalSum += XMLoadFloat3(&normals[next]);
+                lastPosition = XMLoadFloat3(&centroids[next]);
+                for (size_t c = 0; c < 3; c++)
+                {
+                    unsigned int position = positionIds[indices[next * 3 + c]];
+                    for (unsigned int a = adjacencyOffsets[position]; a < adjacencyOffsets[position + 1]; a++)
+                    {
+                        unsigned int neighbour = adjacency[a];
+                        if (!emitted[neighbour] && frontierStamp[neighbour] != clusterId)
+                        {
+                            frontierStamp[neighbour] = clusterId;
+                            frontier.push_back(neighbour);
+                        }
+                    }
+                }
+                if (clusterTriangles.size() >= maxTriangles || frontier.empty())
+                {
+                    break;
+                }
+
+                // grow towards the closest neighbour, triangles facing like the cluster keep the cone narrow
+                XMVECTOR center = centroidSum / static_cast<float>(clusterTriangles.size());
+                XMVECTOR averageNormal = XMVector3Normalize(normalSum);
+                size_t best = 0;
+                float bestScore = FLT_MAX;
+                for (size_t f = 0; f < frontier.size(); f++)
+                {
+                    unsigned int candidate = frontier[f];
+                    float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&centroids[candidate]) - center));
+                    float facing = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normals[candidate]), averageNormal));
+                    float score = distance * (2.0f - facing);
+                    if (score < bestScore)
+                    {
+                        bestScore = score;
+                        best = f;
+                    }
+                }
+                next = frontier[best];
+                frontier[best] = frontier.back();
+                frontier.pop_back();
+            }
+
+            // keep the vertex cache order inside the cluster, optimized on its own vertices numbered from 0 so
+            // the cost does not grow with the size of the mesh
+            clusterIndices.clear();
+            clusterVertices.clear();
+            for (unsigned int triangle : clusterTriangles)
+            {
+                for (size_t c = 0; c < 3; c++)
+                {
+                    unsigned int vertex = indices[triangle * 3 + c];
+                    if (localVertices[vertex] == ~0u)
+                    {
+                        localVertices[vertex] = static_cast<unsigned int>(clusterVertices.size());
+                        clusterVertices.push_back(vertex);
+                    }
+                    clusterIndices.push_back(localVertices[vertex]);
+                }
+            }
+            MeshOptimizer::OptimizeVertexCache(clusterIndices, clusterVertices.size());
+            for (unsigned int& index : clusterIndices)
+            {
+                index = clusterVertices[index];
+            }
+            for (unsigned int vertex : clusterVertices)
+            {
+                localVertices[vertex] = ~0u;
+            }
+
+            MeshCluster cluster = ComputeClusterBounds(vertices, clusterIndices.data(), clusterIndices.size(), normals, clusterTriangles);
+            cluster.indexOffset = static_cast<unsigned int>(reordered.size());
+            cluster.indexCount = static_cast<unsigned int>(clusterIndices.size());
+            meshData.clusters.push_back(cluster);
+            reordered.insert(reordered.end(), clusterIndices.begin(), clusterIndices.end());
+        }
+
+        std::copy(reordered.begin(), reordered.end(), indices.begin());
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+
+namespace mc
+{
+    class MeshClusterizer
+    {
+    public:
+        // Reorders the full detail triangles (lods[0], or all the indices without LODs) into spatially coherent
+        // clusters of at most maxTriangles and describes them in meshData.clusters. Every cluster starts next to
+        // where the previous one ended, so the visible clusters of a long mesh like the track are mostly
+        // consecutive and can be drawn with few index ranges.
+        static void BuildClusters(MeshData& meshData, unsigned int maxTriangles = 32);
+    };
+}
@@ -0,0 +1,413 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mc
+{
+    namespace
+    {
+        // tuning values from Tom Forsyth "Linear-Speed Vertex Cache Optimisation"
+        const unsigned int forsythCacheSize = 32;
+        const unsigned int forsythMaxValence = 32;
+        const float cacheDecayPower = 1.5f;
+        const float lastTriangleScore = 0.75f;
+        const float valenceBoostScale = 2.0f;
+        const float valenceBoostPower = 0.5f;
+
+        // cache used to find the cluster boundaries of the overdraw sort
+        const unsigned int overdrawCacheSize = 16;
+
+        const unsigned int invalidIndex = ~0u;
+
+        struct ForsythScoreTable
+        {
+            float cache[forsythCacheSize];
+            float valence[forsythMaxValence + 1];
+
+            ForsythScoreTable()
+            {
+                for (unsigned int i = 0; i < forsythCacheSize; i++)
+                {
+                    if (i < 3)
+                    {
+                        // the vertices of the last triangle get a fixed score so we dont favour one of them
+                        cache[i] = lastTriangleScore;
+                    }
+                    else
+                    {
+                        float scaler = 1.0f / (forsythCacheSize - 3);
+                        cache[i] = powf(1.0f - (i - 3) * scaler, cacheDecayPower);
+                    }
+                }
+                valence[0] = 0.0f;
+                for (unsigned int i = 1; i <= forsythMaxValence; i++)
+                {
+                    // boost the vertices with few triangles left so we dont leave lonely triangles behind
+                    valence[i] = valenceBoostScale * powf(static_cast<float>(i), -valenceBoostPower);
+                }
+            }
+
+            float VertexScore(int cachePosition, unsigned int liveTriangles) const
+            {
+                if (liveTriangles == 0)
+                {
+                    return -1.0f;
+                }
+                float score = cachePosition >= 0 ? cache[cachePosition] : 0.0f;
+                return score + valence[std::min(liveTriangles, forsythMaxValence)];
+            }
+        };
+
+        // FIFO cache emulated with timestamps, a vertex is in the cache if it was
+        // transformed less than cacheSize misses ago
+        struct FifoCache
+        {
+            std::vector<unsigned int> timestamps;
+            unsigned int time;
+            unsigned int cacheSize;
+
+            FifoCache(size_t vertexCount, unsigned int cacheSize)
+                : timestamps(vertexCount, 0), time(cacheSize + 1), cacheSize(cacheSize)
+            {
+            }
+
+            unsigned int Transform(unsigned int index)
+            {
+                if (time - timestamps[index] > cacheSize)
+                {
+                    timestamps[index] = time++;
+                    return 1;
+                }
+                return 0;
+            }
+
+            unsigned int Transform(const unsigned int* triangle)
+            {
+                return Transform(triangle[0]) + Transform(triangle[1]) + Transform(triangle[2]);
+            }
+
+            void Flush()
+            {
+                time += cacheSize + 1;
+            }
+        };
+    }
+
+    void MeshOptimizer::Optimize(MeshData& meshData, bool optimizeOverdraw)
+    {
+        OptimizeVertexCache(meshData.indices, meshData.vertices.size());
+        if (optimizeOverdraw)
+        {
+            OptimizeOverdraw(meshData.indices, meshData.vertices);
+        }
+        OptimizeVertexFetch(meshData);
+    }
+
+    void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+    {
+        static const ForsythScoreTable scoreTable;
+
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        // triangles that use every vertex, the first liveTriangles entries are the ones not emitted yet
+        std::vector<unsigned int> liveTriangles(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+        {
+            ++liveTriangles[indices[i]];
+        }
+        std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+        }
+        std::vector<unsigned int> adjacency(triangleCount * 3);
+        std::vector<unsigned int> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+        {
+            adjacency[adjacencyFill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        std::vector<float> vertexScores(vertexCount);
+        std::vector<int> cachePositions(vertexCount, -1);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            vertexScores[i] = scoreTable.VertexScore(-1, liveTriangles[i]);
+        }
+
+        std::vector<float> triangleScores(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        unsigned int bestTriangle = 0;
+        for (size_t i = 0; i < triangleCount; i++)
+        {
+            const unsigned int* triangle = &indices[i * 3];
+            triangleScores[i] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+            if (triangleScores[i] > triangleScores[bestTriangle])
+            {
+                bestTriangle = static_cast<unsigned int>(i);
+            }
+        }
+
+        std::vector<unsigned int> result;
+        result.reserve(triangleCount * 3);
+        std::vector<unsigned int> cache;
+        std::vector<unsigned int> newCache;
+        cache.reserve(forsythCacheSize + 3);
+        newCache.reserve(forsythCacheSize + 3);
+        size_t inputCursor = 0;
+
+        for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+        {
+            if (bestTriangle == invalidIndex)
+            {
+                // nothing in the cache has triangles left, continue with the next triangle of the input
+                while (emitted[inputCursor])
+                {
+                    ++inputCursor;
+                }
+                bestTriangle = static_cast<unsigned int>(inputCursor);
+            }
+
+            const unsigned int* triangle = &indices[bestTriangle * 3];
+            result.insert(result.end(), triangle, triangle + 3);
+            emitted[bestTriangle] = true;
+
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                unsigned int vertex = triangle[i];
+                unsigned int* begin = &adjacency[adjacencyOffsets[vertex]];
+                unsigned int* end = begin + liveTriangles[vertex];
+                unsigned int* it = std::find(begin, end, bestTriangle);
+                std::swap(*it, *(end - 1));
+                --liveTriangles[vertex];
+            }
+
+            // the vertices of the emitted triangle go to the front of the LRU cache
+            newCache.clear();
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                if (std::find(newCache.begin(), newCache.end(), triangle[i]) == newCache.end())
+                {
+                    newCache.push_back(triangle[i]);
+                }
+            }
+            for (unsigned int vertex : cache)
+            {
+                if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+                {
+                    newCache.push_back(vertex);
+                }
+            }
+
+            // update the scores of everything that moved in the cache, the vertices
+            // past the end of the cache are the ones that just got evicted
+            for (size_t i = 0; i < newCache.size(); i++)
+            {
+                unsigned int vertex = newCache[i];
+                int cachePosition = i < forsythCacheSize ? static_cast<int>(i) : -1;
+                cachePositions[vertex] = cachePosition;
+
+                float score = scoreTable.VertexScore(cachePosition, liveTriangles[vertex]);
+                float delta = score - vertexScores[vertex];
+                vertexScores[vertex] = score;
+
+                const unsigned int* begin = &adjacency[adjacencyOffsets[vertex]];
+                const unsigned int* end = begin + liveTriangles[vertex];
+                for (const unsigned int* it = begin; it != end; ++it)
+                {
+                    triangleScores[*it] += delta;
+                }
+            }
+            if (newCache.size() > forsythCacheSize)
+            {
+                newCache.resize(forsythCacheSize);
+            }
+            std::swap(cache, newCache);
+
+            // the next triangle is the best one that uses a vertex of the cache
+            bestTriangle = invalidIndex;
+            float bestScore = -1.0f;
+            for (unsigned int vertex : cache)
+            {
+                const unsigned int* begin = &adjacency[adjacencyOffsets[vertex]];
+                const unsigned int* end = begin + liveTriangles[vertex];
+                for (const unsigned int* it = begin; it != end; ++it)
+                {
+                    if (triangleScores[*it] > bestScore)
+                    {
+                        bestScore = triangleScores[*it];
+                        bestTriangle = *it;
+                    }
+                }
+            }
+        }
+
+        std::copy(result.begin(), result.end(), indices.begin());
+    }
+
+    void MeshOptimizer::OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold)
+    {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        // hard boundaries are the triangles where the cache is completely cold
+        FifoCache fifo(vertices.size(), overdrawCacheSize);
+        std::vector<unsigned int> misses(triangleCount);
+        std::vector<unsigned int> hardClusters;
+        for (size_t i = 0; i < triangleCount; i++)
+        {
+            misses[i] = fifo.Transform(&indices[i * 3]);
+            if (i == 0 || misses[i] == 3)
+            {
+                hardClusters.push_back(static_cast<unsigned int>(i));
+            }
+        }
+        hardClusters.push_back(static_cast<unsigned int>(triangleCount));
+
+        // soft boundaries split the hard clusters where the ACMR so far is close enough to the one of the whole cluster
+        std::vector<unsigned int> clusters;
+        for (size_t c = 0; c + 1 < hardClusters.size(); c++)
+        {
+            unsigned int clusterBegin = hardClusters[c];
+            unsigned int clusterEnd = hardClusters[c + 1];
+            unsigned int clusterMisses = 0;
+            for (unsigned int i = clusterBegin; i < clusterEnd; i++)
+            {
+                clusterMisses += misses[i];
+            }
+            float clusterAcmr = static_cast<float>(clusterMisses) / (clusterEnd - clusterBegin);
+
+            clusters.push_back(clusterBegin);
+            fifo.Flush();
+            unsigned int start = clusterBegin;
+            unsigned int startMisses = 0;
+            for (unsigned int i = clusterBegin; i < clusterEnd; i++)
+            {
+                startMisses += fifo.Transform(&indices[i * 3]);
+                float acmr = static_cast<float>(startMisses) / (i + 1 - start);
+                if (i + 1 < clusterEnd && acmr <= clusterAcmr * threshold)
+                {
+                    start = i + 1;
+                    startMisses = 0;
+                    clusters.push_back(start);
+                    fifo.Flush();
+                }
+            }
+        }
+        clusters.push_back(static_cast<unsigned int>(triangleCount));
+
+        // area weighted centroid and normal of every cluster and of the whole mesh
+        size_t clusterCount = clusters.size() - 1;
+        std::vector<XMFLOAT3> clusterCentroids(clusterCount);
+        std::vector<XMFLOAT3> clusterNormals(clusterCount);
+        XMVECTOR meshCentroid = XMVectorZero();
+        float meshArea = 0.0f;
+        for (size_t c = 0; c < clusterCount; c++)
+        {
+            XMVECTOR centroid = XMVectorZero();
+            XMVECTOR normal = XMVectorZero();
+            float clusterArea = 0.0f;
+            for (unsigned int i = clusters[c]; i < clusters[c + 1]; i++)
+            {
+                const Vertex& v0 = vertices[indices[i * 3 + 0]];
+                const Vertex& v1 = vertices[indices[i * 3 + 1]];
+                const Vertex& v2 = vertices[indices[i * 3 + 2]];
+                XMVECTOR p0 = XMLoadFloat3(&v0.position);
+                XMVECTOR p1 = XMLoadFloat3(&v1.position);
+                XMVECTOR p2 = XMLoadFloat3(&v2.position);
+                float area = 0.5f * XMVectorGetX(XMVector3Length(XMVector3Cross(p1 - p0, p2 - p0)));
+
+                centroid += (p0 + p1 + p2) * (area / 3.0f);
+                normal += (XMLoadFloat3(&v0.normal) + XMLoadFloat3(&v1.normal) + XMLoadFloat3(&v2.normal)) * area;
+                clusterArea += area;
+            }
+            meshCentroid += centroid;
+            meshArea += clusterArea;
+            XMStoreFloat3(&clusterCentroids[c], clusterArea > 0.0f ? centroid / clusterArea : centroid);
+            XMStoreFloat3(&clusterNormals[c], XMVector3Normalize(normal));
+        }
+        if (meshArea > 0.0f)
+        {
+            meshCentroid /= meshArea;
+        }
+
+        // clusters that face away from the center are the ones that occlude the rest, so they go first
+        std::vector<float> sortKeys(clusterCount);
+        std::vector<unsigned int> order(clusterCount);
+        for (size_t c = 0; c < clusterCount; c++)
+        {
+            XMVECTOR offset = XMLoadFloat3(&clusterCentroids[c]) - meshCentroid;
+            sortKeys[c] = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&clusterNormals[c])));
+            order[c] = static_cast<unsigned int>(c);
+        }
+        std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+        {
+            return sortKeys[a] > sortKeys[b];
+        });
+
+        std::vector<unsigned int> result;
+        result.reserve(indices.size());
+        for (unsigned int c : order)
+        {
+            result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+        }
+        std::copy(result.begin(), result.end(), indices.begin());
+    }
+
+    void MeshOptimizer::OptimizeVertexFetch(MeshData& meshData)
+    {
+        std::vector<unsigned int> remap(meshData.vertices.size(), invalidIndex);
+        unsigned int vertexCount = 0;
+        for (unsigned int& index : meshData.indices)
+        {
+            if (remap[index] == invalidIndex)
+            {
+                remap[index] = vertexCount++;
+            }
+            index = remap[index];
+        }
+
+        std::vector<Vertex> vertices(vertexCount);
+        for (size_t i = 0; i < meshData.vertices.size(); i++)
+        {
+            if (remap[i] != invalidIndex)
+            {
+                vertices[remap[i]] = meshData.vertices[i];
+            }
+        }
+        meshData.vertices = std::move(vertices);
+    }
+
+    VertexCacheStats MeshOptimizer::SimulateVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+    {
+        VertexCacheStats stats{};
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+        {
+            return stats;
+        }
+
+        FifoCache fifo(vertexCount, cacheSize);
+        std::vector<bool> used(vertexCount, false);
+        unsigned int usedCount = 0;
+        for (size_t i = 0; i < triangleCount * 3; i++)
+        {
+            stats.transformedVertices += fifo.Transform(indices[i]);
+            if (!used[indices[i]])
+            {
+                used[indices[i]] = true;
+                ++usedCount;
+            }
+        }
+        stats.acmr = static_cast<float>(stats.transformedVertices) / triangleCount;
+        stats.atvr = static_cast<float>(stats.transformedVertices) / usedCount;
+        return stats;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+
+namespace mc
+{
+    struct VertexCacheStats
+    {
+        // average cache miss ratio, transformed vertices per triangle (0.5 is the best possible, 3 the worst)
+        float acmr;
+        // average transform to vertex ratio, transformed vertices per used vertex (1 is the best possible)
+        float atvr;
+        unsigned int transformedVertices;
+    };
+
+    class MeshOptimizer
+    {
+    public:
+        // Runs the vertex cache reorder, the optional overdraw cluster sort and the vertex fetch reorder.
+        static void Optimize(MeshData& meshData, bool optimizeOverdraw = true);
+
+        // Forsyth linear speed vertex cache optimization, only the triangle order changes
+        static void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+        // Splits the (cache optimized) triangle list into clusters where the cache gets cold and sorts
+        // them so the clusters facing away from the center of the mesh are drawn first.
+        // threshold is how much worse than the original ACMR we accept for the smaller clusters.
+        static void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+        // Renumbers the vertices in the order they are first used by the indices, unused vertices are removed
+        static void OptimizeVertexFetch(MeshData& meshData);
+
+        // FIFO post transform cache simulator
+        static VertexCacheStats SimulateVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = 16);
+    };
+}
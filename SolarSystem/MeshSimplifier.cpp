@@ -0,0 +1,549 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace mc
+{
+    namespace
+    {
+        const unsigned int removedIndex = ~0u;
+
+        // symmetric 4x4 matrix of the plane equations around a vertex, the planes are not weighted by area
+        struct Quadric
+        {
+            double a00, a01, a02, a03;
+            double a11, a12, a13;
+            double a22, a23;
+            double a33;
+
+            void AddPlane(double x, double y, double z, double d, double weight)
+            {
+                a00 += weight * x * x; a01 += weight * x * y; a02 += weight * x * z; a03 += weight * x * d;
+                a11 += weight * y * y; a12 += weight * y * z; a13 += weight * y * d;
+                a22 += weight * z * z; a23 += weight * z * d;
+                a33 += weight * d * d;
+            }
+
+            void Add(const Quadric& other)
+            {
+                a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+                a11 += other.a11; a12 += other.a12; a13 += other.a13;
+                a22 += other.a22; a23 += other.a23;
+                a33 += other.a33;
+            }
+
+            // sum of the squared distances of p to the planes, never smaller than the squared distance to any of them
+            double Evaluate(const XMFLOAT3& p) const
+            {
+                double x = p.x, y = p.y, z = p.z;
+                return a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x +
+                    a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y +
+                    a22 * z * z + 2.0 * a23 * z +
+                    a33;
+            }
+        };
+
+        struct PositionKey
+        {
+            unsigned int x, y, z;
+
+            bool operator==(const PositionKey& other) const
+            {
+                return x == other.x && y == other.y && z == other.z;
+            }
+        };
+
+        struct PositionKeyHash
+        {
+            size_t operator()(const PositionKey& key) const
+            {
+                size_t hash = key.x * 73856093u;
+                hash ^= key.y * 19349663u;
+                hash ^= key.z * 83492791u;
+                return hash;
+            }
+        };
+
+        struct Collapse
+        {
+            unsigned int from;
+            unsigned int to;
+            double cost;
+        };
+
+        unsigned long long EdgeKey(unsigned int a, unsigned int b)
+        {
+            return (static_cast<unsigned long long>(a) << 32) | b;
+        }
+
+        // any vertex of the given position used by the current triangles with exactly that uv
+        unsigned int FindWedgeWithUv(const std::vector<unsigned int>& indices, const std::vector<unsigned int>& positionTriangles,
+            const std::vector<unsigned int>& triangleOffsets, const std::vector<unsigned int>& positionIds,
+            const std::vector<Vertex>& vertices, unsigned int position, const XMFLOAT2& uv)
+        {
+            for (unsigned int t = triangleOffsets[position]; t < triangleOffsets[position + 1]; t++)
+            {
+                const unsigned int* triangle = &indices[positionTriangles[t] * 3];
+                for (unsigned int c = 0; c < 3; c++)
+                {
+                    const Vertex& vertex = vertices[triangle[c]];
+                    if (positionIds[triangle[c]] == position && vertex.uv.x == uv.x && vertex.uv.y == uv.y)
+                    {
+                        return triangle[c];
+                    }
+                }
+            }
+            return removedIndex;
+        }
+
+        XMVECTOR TriangleNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+        {
+            XMVECTOR a = XMLoadFloat3(&p0);
+            XMVECTOR b = XMLoadFloat3(&p1);
+            XMVECTOR c = XMLoadFloat3(&p2);
+            return XMVector3Cross(b - a, c - a);
+        }
+
+        // the largest distance from the first vertexCount vertices to the triangles of indices
+        float MaxDistance(const std::vector<Vertex>& vertices, size_t vertexCount, const std::vector<unsigned int>& indices)
+        {
+            float maxDistanceSq = 0.0f;
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                XMVECTOR p = XMLoadFloat3(&vertices[v].position);
+                float distanceSq = FLT_MAX;
+                // a vertex closer than the largest distance so far cant change it
+                for (size_t i = 0; i < indices.size() && distanceSq > maxDistanceSq; i += 3)
+                {
+                    XMVECTOR closest = Utils::ClosestPointOnTriangle(p, XMLoadFloat3(&vertices[indices[i]].position),
+                        XMLoadFloat3(&vertices[indices[i + 1]].position), XMLoadFloat3(&vertices[indices[i + 2]].position));
+                    distanceSq = std::min(distanceSq, XMVectorGetX(XMVector3LengthSq(p - closest)));
+                }
+                maxDistanceSq = std::max(maxDistanceSq, distanceSq);
+            }
+            return std::sqrt(maxDistanceSq);
+        }
+    }
+
+    std::vector<unsigned int> MeshSimplifier::Simplify(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+        size_t targetIndexCount, float maxError, float* resultError)
+    {
+        std::vector<unsigned int> result = indices;
+        size_t vertexCount = vertices.size();
+        if (resultError)
+        {
+            *resultError = 0.0f;
+        }
+        if (result.size() <= targetIndexCount || vertexCount == 0)
+        {
+            return result;
+        }
+
+        // vertices with the same position are the same point of the surface even if their uv or normal is different
+        std::vector<unsigned int> positionIds(vertexCount);
+        size_t positionCount = 0;
+        {
+            std::unordered_map<PositionKey, unsigned int, PositionKeyHash> positionMap;
+            positionMap.reserve(vertexCount);
+            for (size_t i = 0; i < vertexCount; i++)
+            {
+                PositionKey key;
+                std::memcpy(&key, &vertices[i].position, sizeof(key));
+                auto it = positionMap.emplace(key, static_cast<unsigned int>(positionMap.size())).first;
+                positionIds[i] = it->second;
+            }
+            positionCount = positionMap.size();
+        }
+
+        // lock the open borders and the non manifold edges, moving them would tear the mesh
+        std::vector<bool> locked(positionCount, false);
+        {
+            std::unordered_map<unsigned long long, unsigned int> edges;
+            edges.reserve(result.size());
+            for (size_t i = 0; i < result.size(); i += 3)
+            {
+                for (unsigned int e = 0; e < 3; e++)
+                {
+                    unsigned int a = positionIds[result[i + e]];
+                    unsigned int b = positionIds[result[i + (e + 1) % 3]];
+                    ++edges[EdgeKey(a, b)];
+                }
+            }
+            for (const auto& edge : edges)
+            {
+                unsigned int a = static_cast<unsigned int>(edge.first >> 32);
+                unsigned int b = static_cast<unsigned int>(edge.first & 0xFFFFFFFFu);
+                auto opposite = edges.find(EdgeKey(b, a));
+                if (edge.second != 1 || opposite == edges.end() || opposite->second != 1)
+                {
+                    locked[a] = true;
+                    locked[b] = true;
+                }
+            }
+        }
+
+        // the error limit is relative to the diagonal of the mesh
+        MeshBounds bounds = GeometryGenerator::ComputeBounds(vertices.data(), vertices.size());
+        float extent = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.max) - XMLoadFloat3(&bounds.min)));
+        if (extent <= 0.0f)
+        {
+            return result;
+        }
+        double errorLimit = static_cast<double>(maxError) * extent;
+        errorLimit *= errorLimit;
+
+        std::vector<Quadric> quadrics(positionCount, Quadric{});
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            const XMFLOAT3& p0 = vertices[result[i + 0]].position;
+            const XMFLOAT3& p1 = vertices[result[i + 1]].position;
+            const XMFLOAT3& p2 = vertices[result[i + 2]].position;
+            XMVECTOR normal = TriangleNormal(p0, p1, p2);
+            float area = XMVectorGetX(XMVector3Length(normal));
+            if (area <= 0.0f)
+            {
+                continue;
+            }
+            XMFLOAT3 n;
+            XMStoreFloat3(&n, normal / area);
+            double d = -(n.x * p0.x + n.y * p0.y + n.z * p0.z);
+            for (unsigned int c = 0; c < 3; c++)
+            {
+                quadrics[positionIds[result[i + c]]].AddPlane(n.x, n.y, n.z, d, 1.0);
+            }
+        }
+
+        double maxCost = 0.0;
+        std::vector<unsigned int> triangleOffsets(positionCount + 1);
+        std::vector<unsigned int> triangleFill(positionCount);
+        std::vector<unsigned int> positionTriangles;
+        std::vector<bool> touched(positionCount);
+        std::vector<Collapse> collapses;
+        std::vector<unsigned int> neighbours;
+        std::vector<unsigned int> otherNeighbours;
+        std::vector<std::pair<unsigned int, unsigned int>> wedgeMap;
+        std::vector<std::pair<unsigned int, unsigned int>> pendingWedges;
+        std::unordered_map<unsigned long long, unsigned int> splitWedges;
+
+        while (result.size() > targetIndexCount)
+        {
+            // triangles around every position
+            std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+            for (unsigned int index : result)
+            {
+                ++triangleOffsets[positionIds[index] + 1];
+            }
+            for (size_t i = 0; i < positionCount; i++)
+            {
+                triangleOffsets[i + 1] += triangleOffsets[i];
+            }
+            positionTriangles.resize(result.size());
+            std::copy(triangleOffsets.begin(), triangleOffsets.end() - 1, triangleFill.begin());
+            for (size_t i = 0; i < result.size(); i++)
+            {
+                positionTriangles[triangleFill[positionIds[result[i]]]++] = static_cast<unsigned int>(i / 3);
+            }
+
+            // cheapest collapse of every position that is allowed to move
+            collapses.clear();
+            for (size_t i = 0; i < positionCount; i++)
+            {
+                if (triangleOffsets[i] == triangleOffsets[i + 1] || locked[i])
+                {
+                    continue;
+                }
+                Collapse best{ static_cast<unsigned int>(i), removedIndex, errorLimit };
+                for (unsigned int t = triangleOffsets[i]; t < triangleOffsets[i + 1]; t++)
+                {
+                    const unsigned int* triangle = &result[positionTriangles[t] * 3];
+                    for (unsigned int c = 0; c < 3; c++)
+                    {
+                        if (positionIds[triangle[c]] == i)
+                        {
+                            continue;
+                        }
+                        double cost = quadrics[i].Evaluate(vertices[triangle[c]].position);
+                        if (cost <= best.cost)
+                        {
+                            best.to = positionIds[triangle[c]];
+                            best.cost = cost;
+                        }
+                    }
+                }
+                if (best.to != removedIndex)
+                {
+                    collapses.push_back(best);
+                }
+            }
+            if (collapses.empty())
+            {
+                break;
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+            {
+                return a.cost < b.cost;
+            });
+
+            // apply the collapses in order, a position touched by a collapse has stale
+            // triangles so it waits for the next pass
+            std::fill(touched.begin(), touched.end(), false);
+            size_t removedTriangles = 0;
+            size_t appliedCount = 0;
+            for (const Collapse& collapse : collapses)
+            {
+                if (result.size() - removedTriangles * 3 <= targetIndexCount)
+                {
+                    break;
+                }
+                unsigned int from = collapse.from;
+                unsigned int to = collapse.to;
+                if (touched[from] || touched[to])
+                {
+                    continue;
+                }
+
+                // every vertex (wedge) of the moving position must have a vertex of the target
+                // position in the same uv/normal chart to move to, this is what keeps the seams intact
+                wedgeMap.clear();
+                pendingWedges.clear();
+                bool validWedges = true;
+                for (unsigned int t = triangleOffsets[from]; t < triangleOffsets[from + 1] && validWedges; t++)
+                {
+                    const unsigned int* triangle = &result[positionTriangles[t] * 3];
+                    unsigned int fromWedge = removedIndex;
+                    unsigned int toWedge = removedIndex;
+                    for (unsigned int c = 0; c < 3; c++)
+                    {
+                        if (positionIds[triangle[c]] == from)
+                        {
+                            fromWedge = triangle[c];
+                        }
+                        else if (positionIds[triangle[c]] == to)
+                        {
+                            toWedge = triangle[c];
+                        }
+                    }
+                    if (toWedge == removedIndex)
+                    {
+                        continue;
+                    }
+                    auto it = std::find_if(wedgeMap.begin(), wedgeMap.end(), [&](const std::pair<unsigned int, unsigned int>& entry)
+                    {
+                        return entry.first == fromWedge;
+                    });
+                    if (it == wedgeMap.end())
+                    {
+                        wedgeMap.emplace_back(fromWedge, toWedge);
+                    }
+                    else
+                    {
+                        validWedges = it->second == toWedge;
+                    }
+                }
+                // a wedge without a chart on the target happens on hard normal edges (flat shaded meshes), the wedge
+                // can still move if the target has a vertex with the same uv, it gets a copy of it with its own normal
+                for (unsigned int t = triangleOffsets[from]; t < triangleOffsets[from + 1] && validWedges; t++)
+                {
+                    const unsigned int* triangle = &result[positionTriangles[t] * 3];
+                    for (unsigned int c = 0; c < 3; c++)
+                    {
+                        unsigned int fromWedge = triangle[c];
+                        if (positionIds[fromWedge] != from ||
+                            std::any_of(wedgeMap.begin(), wedgeMap.end(), [&](const std::pair<unsigned int, unsigned int>& entry) { return entry.first == fromWedge; }) ||
+                            std::any_of(pendingWedges.begin(), pendingWedges.end(), [&](const std::pair<unsigned int, unsigned int>& entry) { return entry.first == fromWedge; }))
+                        {
+                            continue;
+                        }
+                        unsigned int toWedge = FindWedgeWithUv(result, positionTriangles, triangleOffsets, positionIds, vertices, to, vertices[fromWedge].uv);
+                        if (toWedge == removedIndex)
+                        {
+                            validWedges = false;
+                            break;
+                        }
+                        pendingWedges.emplace_back(fromWedge, toWedge);
+                    }
+                }
+                if (!validWedges)
+                {
+                    continue;
+                }
+
+                // link condition, the only neighbours both positions can share are the
+                // ones of the triangles on the collapsed edge or the mesh gets pinched
+                neighbours.clear();
+                otherNeighbours.clear();
+                unsigned int sharedTriangles = 0;
+                for (unsigned int t = triangleOffsets[from]; t < triangleOffsets[from + 1]; t++)
+                {
+                    const unsigned int* triangle = &result[positionTriangles[t] * 3];
+                    bool hasTo = false;
+                    for (unsigned int c = 0; c < 3; c++)
+                    {
+                        neighbours.push_back(positionIds[triangle[c]]);
+                        hasTo |= (positionIds[triangle[c]] == to);
+                    }
+                    sharedTriangles += hasTo;
+                }
+                for (unsigned int t = triangleOffsets[to]; t < triangleOffsets[to + 1]; t++)
+                {
+                    const unsigned int* triangle = &result[positionTriangles[t] * 3];
+                    for (unsigned int c = 0; c < 3; c++)
+                    {
+                        otherNeighbours.push_back(positionIds[triangle[c]]);
+                    }
+                }
+                std::sort(neighbours.begin(), neighbours.end());
+                neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+                std::sort(otherNeighbours.begin(), otherNeighbours.end());
+                otherNeighbours.erase(std::unique(otherNeighbours.begin(), otherNeighbours.end()), otherNeighbours.end());
+                size_t sharedNeighbours = 0;
+                for (unsigned int neighbour : neighbours)
+                {
+                    if (neighbour != from && neighbour != to &&
+                        std::binary_search(otherNeighbours.begin(), otherNeighbours.end(), neighbour))
+                    {
+                        ++sharedNeighbours;
+                    }
+                }
+                if (sharedNeighbours != sharedTriangles)
+                {
+                    continue;
+                }
+
+                // the triangles that survive the collapse must not flip
+                XMFLOAT3 target = vertices[wedgeMap.front().second].position;
+                bool flips = false;
+                for (unsigned int t = triangleOffsets[from]; t < triangleOffsets[from + 1] && !flips; t++)
+                {
+                    const unsigned int* triangle = &result[positionTriangles[t] * 3];
+                    XMFLOAT3 p[3];
+                    XMFLOAT3 moved[3];
+                    bool hasTo = false;
+                    for (unsigned int c = 0; c < 3; c++)
+                    {
+                        p[c] = vertices[triangle[c]].position;
+                        moved[c] = positionIds[triangle[c]] == from ? target : p[c];
+                        hasTo |= (positionIds[triangle[c]] == to);
+                    }
+                    if (hasTo)
+                    {
+                        continue;
+                    }
+                    XMVECTOR before = TriangleNormal(p[0], p[1], p[2]);
+                    XMVECTOR after = TriangleNormal(moved[0], moved[1], moved[2]);
+                    flips = XMVectorGetX(XMVector3Dot(before, after)) <= 0.0f;
+                }
+                if (flips)
+                {
+                    continue;
+                }
+
+                for (const auto& pending : pendingWedges)
+                {
+                    unsigned long long key = EdgeKey(pending.first, to);
+                    auto it = splitWedges.find(key);
+                    if (it == splitWedges.end())
+                    {
+                        Vertex vertex = vertices[pending.first];
+                        vertex.position = target;
+                        it = splitWedges.emplace(key, static_cast<unsigned int>(vertices.size())).first;
+                        vertices.push_back(vertex);
+                        positionIds.push_back(to);
+                    }
+                    wedgeMap.emplace_back(pending.first, it->second);
+                }
+
+                for (unsigned int t = triangleOffsets[from]; t < triangleOffsets[from + 1]; t++)
+                {
+                    unsigned int* triangle = &result[positionTriangles[t] * 3];
+                    for (unsigned int c = 0; c < 3; c++)
+                    {
+                        touched[positionIds[triangle[c]]] = true;
+                        if (positionIds[triangle[c]] == from)
+                        {
+                            for (const auto& entry : wedgeMap)
+                            {
+                                if (entry.first == triangle[c])
+                                {
+                                    triangle[c] = entry.second;
+                                    break;
+                                }
+                            }
+                        }
+                    }
+                    if (positionIds[triangle[0]] == positionIds[triangle[1]] ||
+                        positionIds[triangle[1]] == positionIds[triangle[2]] ||
+                        positionIds[triangle[0]] == positionIds[triangle[2]])
+                    {
+                        triangle[0] = triangle[1] = triangle[2] = removedIndex;
+                        ++removedTriangles;
+                    }
+                }
+                quadrics[to].Add(quadrics[from]);
+                maxCost = std::max(maxCost, collapse.cost);
+                ++appliedCount;
+            }
+
+            result.erase(std::remove(result.begin(), result.end(), removedIndex), result.end());
+            if (appliedCount == 0)
+            {
+                break;
+            }
+        }
+
+        if (resultError)
+        {
+            *resultError = static_cast<float>(std::sqrt(maxCost) / extent);
+        }
+        return result;
+    }
+
+    void MeshSimplifier::BuildLodChain(MeshData& meshData, unsigned int maxLodCount, float reduction, float maxError)
+    {
+        meshData.lods.clear();
+        meshData.lods.push_back({ 0, static_cast<unsigned int>(meshData.indices.size()), 0.0f });
+
+        // the error of a level is measured on the vertices of the full detail mesh, not on the copies Simplify adds
+        size_t vertexCount = meshData.vertices.size();
+        MeshBounds bounds = GeometryGenerator::ComputeBounds(meshData.vertices.data(), vertexCount);
+        float extent = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.max) - XMLoadFloat3(&bounds.min)));
+        if (extent <= 0.0f)
+        {
+            return;
+        }
+
+        std::vector<unsigned int> current = meshData.indices;
+        float error = 0.0f;
+        for (unsigned int i = 1; i < maxLodCount; i++)
+        {
+            // every level is built from the previous one, the next level only gets what is left of maxError
+            size_t targetIndexCount = static_cast<size_t>(current.size() / 3 * reduction) * 3;
+            std::vector<unsigned int> lod = Simplify(meshData.vertices, current, targetIndexCount, maxError - error);
+
+            // a level that barely removes triangles is not worth the memory
+            if (lod.empty() || lod.size() > current.size() * 0.85f)
+            {
+                break;
+            }
+
+            // The quadric error is a distance to the planes of the collapsed triangles, not to the surface left,
+            // thin parts can end up much further than it says. The error of the level is the one measured.
+            float lodError = MaxDistance(meshData.vertices, vertexCount, lod) / extent;
+            if (lodError > maxError)
+            {
+                break;
+            }
+            error = lodError;
+            MeshOptimizer::OptimizeVertexCache(lod, meshData.vertices.size());
+            meshData.lods.push_back({ static_cast<unsigned int>(meshData.indices.size()), static_cast<unsigned int>(lod.size()), error });
+            meshData.indices.insert(meshData.indices.end(), lod.begin(), lod.end());
+            current = std::move(lod);
+        }
+    }
+}
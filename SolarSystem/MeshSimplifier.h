@@ -0,0 +1,26 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+
+namespace mc
+{
+    class MeshSimplifier
+    {
+    public:
+        // Quadric error edge collapse. Vertices are only moved onto one of their neighbours, so the result is a
+        // new index list over the same vertices. The only new vertices are the copies needed to move a corner across
+        // a hard normal edge, they are appended to vertices. Border vertices never move and uv seams are kept.
+        // Stops when the index count reaches targetIndexCount or when the next collapse would move the surface
+        // more than maxError (relative to the size of the mesh). resultError gets the quadric error of the result,
+        // the distance to the planes of the collapsed triangles.
+        static std::vector<unsigned int> Simplify(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+            size_t targetIndexCount, float maxError, float* resultError = nullptr);
+
+        // Appends coarser versions of the mesh to meshData.indices and describes all of them in meshData.lods.
+        // Every level has around reduction times the triangles of the previous one, the chain stops early
+        // when the simplifier cant reduce the mesh any more without going over maxError. The error of a level
+        // is the largest distance from a vertex of the mesh to its triangles relative to the size of the mesh,
+        // a level measured over maxError ends the chain.
+        static void BuildLodChain(MeshData& meshData, unsigned int maxLodCount = 4, float reduction = 0.5f, float maxError = 0.05f);
+    };
+}
@@ -0,0 +1,406 @@
+#include "ObjParser.h"
+#include "Utils.h"
+#include "ThreadPool.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+namespace mc
+{
+    namespace
+    {
+        const char* LineEnd(const char* p, const char* end)
+        {
+            const char* newLine = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            return newLine ? newLine : end;
+        }
+
+        bool IsSpace(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        bool IsDigit(char c)
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        void SkipSpaces(const char*& p, const char* end)
+        {
+            while (p < end && IsSpace(*p))
+            {
+                ++p;
+            }
+        }
+
+        // from_chars style float parser, the OBJ files only use plain decimal notation
+        // but we also accept an exponent just in case
+        float ParseFloat(const char*& p, const char* end)
+        {
+            static const double powersOf10[] = {
+                1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+
+            SkipSpaces(p, end);
+
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                negative = (*p == '-');
+                ++p;
+            }
+
+            unsigned long long mantissa = 0;
+            int exponent = 0;
+            int digits = 0;
+            while (p < end && IsDigit(*p))
+            {
+                if (digits < 19)
+                {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    ++digits;
+                }
+                else
+                {
+                    ++exponent;
+                }
+                ++p;
+            }
+            if (p < end && *p == '.')
+            {
+                ++p;
+                while (p < end && IsDigit(*p))
+                {
+                    if (digits < 19)
+                    {
+                        mantissa = mantissa * 10 + (*p - '0');
+                        ++digits;
+                        --exponent;
+                    }
+                    ++p;
+                }
+            }
+            if (p < end && (*p == 'e' || *p == 'E'))
+            {
+                ++p;
+                bool negativeExp = false;
+                if (p < end && (*p == '-' || *p == '+'))
+                {
+                    negativeExp = (*p == '-');
+                    ++p;
+                }
+                int exp = 0;
+                while (p < end && IsDigit(*p))
+                {
+                    exp = exp * 10 + (*p - '0');
+                    ++p;
+                }
+                exponent += negativeExp ? -exp : exp;
+            }
+
+            // dividing by an exact power of ten keeps the result correctly rounded in double
+            double value = static_cast<double>(mantissa);
+            while (exponent < -22)
+            {
+                value /= powersOf10[22];
+                exponent += 22;
+            }
+            while (exponent > 22)
+            {
+                value *= powersOf10[22];
+                exponent -= 22;
+            }
+            value = exponent < 0 ? value / powersOf10[-exponent] : value * powersOf10[exponent];
+
+            return static_cast<float>(negative ? -value : value);
+        }
+
+        // corner that used negative (relative) indices, they are resolved against the counts of its own
+        // chunk while parsing and moved by the offset of the chunk once all the chunks are stitched together
+        struct RelativeCorner
+        {
+            size_t corner;
+            unsigned char attributes;
+        };
+        const unsigned char relativePosition = 1;
+        const unsigned char relativeUv = 2;
+        const unsigned char relativeNormal = 4;
+
+        struct ObjChunk
+        {
+            ObjData data;
+            std::vector<RelativeCorner> relativeCorners;
+        };
+
+        struct ObjChunkOffsets
+        {
+            size_t positions;
+            size_t normals;
+            size_t uvs;
+            size_t corners;
+            size_t faceSizes;
+        };
+
+        // files smaller than two chunks are not worth waking up the workers
+        const size_t minChunkSize = 256 * 1024;
+
+        // returns false if there is no index, the index is converted to 0 based,
+        // negative OBJ indices are relative to the current count
+        bool ParseIndex(const char*& p, const char* end, size_t count, int& index, unsigned char& relative, unsigned char relativeBit)
+        {
+            bool negative = false;
+            if (p < end && *p == '-')
+            {
+                negative = true;
+                ++p;
+            }
+            if (p >= end || !IsDigit(*p))
+            {
+                return false;
+            }
+            int value = 0;
+            while (p < end && IsDigit(*p))
+            {
+                value = value * 10 + (*p - '0');
+                ++p;
+            }
+            if (negative)
+            {
+                index = static_cast<int>(count) - value;
+                relative |= relativeBit;
+            }
+            else
+            {
+                index = value - 1;
+            }
+            return true;
+        }
+
+        void ParseFace(ObjData& objData, std::vector<RelativeCorner>& relativeCorners, const char* p, const char* end)
+        {
+            unsigned char cornerCount = 0;
+            while (cornerCount < 255)
+            {
+                SkipSpaces(p, end);
+                if (p >= end)
+                {
+                    break;
+                }
+
+                ObjIndex corner{ -1, -1, -1 };
+                unsigned char relative = 0;
+                if (!ParseIndex(p, end, objData.positions.size(), corner.position, relative, relativePosition))
+                {
+                    break;
+                }
+                if (p < end && *p == '/')
+                {
+                    ++p;
+                    ParseIndex(p, end, objData.uvs.size(), corner.uv, relative, relativeUv);
+                    if (p < end && *p == '/')
+                    {
+                        ++p;
+                        ParseIndex(p, end, objData.normals.size(), corner.normal, relative, relativeNormal);
+                    }
+                }
+
+                if (relative)
+                {
+                    relativeCorners.push_back({ objData.corners.size(), relative });
+                }
+                objData.corners.push_back(corner);
+                ++cornerCount;
+
+                // skip anything we dont understand until the next corner
+                while (p < end && !IsSpace(*p))
+                {
+                    ++p;
+                }
+            }
+            objData.faceSizes.push_back(cornerCount);
+        }
+
+        void Reserve(ObjData& objData, const char* begin, const char* end)
+        {
+            // cheap count of the line types so the parse never has to grow the vectors
+            size_t positionCount = 0;
+            size_t normalCount = 0;
+            size_t uvCount = 0;
+            size_t faceCount = 0;
+            const char* line = begin;
+            while (line < end)
+            {
+                const char* lineEnd = LineEnd(line, end);
+                if (lineEnd - line >= 2)
+                {
+                    if (line[0] == 'v')
+                    {
+                        positionCount += (line[1] == ' ');
+                        normalCount += (line[1] == 'n');
+                        uvCount += (line[1] == 't');
+                    }
+                    else if (line[0] == 'f' && line[1] == ' ')
+                    {
+                        ++faceCount;
+                    }
+                }
+                line = lineEnd + 1;
+            }
+
+            objData.positions.reserve(positionCount);
+            objData.normals.reserve(normalCount);
+            objData.uvs.reserve(uvCount);
+            objData.corners.reserve(faceCount * 3);
+            objData.faceSizes.reserve(faceCount);
+        }
+
+        void ParseLines(ObjData& objData, std::vector<RelativeCorner>& relativeCorners, const char* begin, const char* end)
+        {
+            Reserve(objData, begin, end);
+
+            const char* line = begin;
+            while (line < end)
+            {
+                const char* lineEnd = LineEnd(line, end);
+                const char* p = line;
+                if (lineEnd - p >= 2)
+                {
+                    if (p[0] == 'v' && p[1] == ' ')
+                    {
+                        p += 2;
+                        XMFLOAT3 position;
+                        position.x = ParseFloat(p, lineEnd);
+                        position.y = ParseFloat(p, lineEnd);
+                        position.z = ParseFloat(p, lineEnd);
+                        objData.positions.push_back(position);
+                    }
+                    else if (p[0] == 'v' && p[1] == 'n')
+                    {
+                        p += 2;
+                        XMFLOAT3 normal;
+                        normal.x = ParseFloat(p, lineEnd);
+                        normal.y = ParseFloat(p, lineEnd);
+                        normal.z = ParseFloat(p, lineEnd);
+                        objData.normals.push_back(normal);
+                    }
+                    else if (p[0] == 'v' && p[1] == 't')
+                    {
+                        p += 2;
+                        XMFLOAT2 uv;
+                        uv.x = ParseFloat(p, lineEnd);
+                        uv.y = ParseFloat(p, lineEnd);
+                        objData.uvs.push_back(uv);
+                    }
+                    else if (p[0] == 'f' && p[1] == ' ')
+                    {
+                        ParseFace(objData, relativeCorners, p + 2, lineEnd);
+                    }
+                }
+                line = lineEnd + 1;
+            }
+        }
+
+        void ResolveRelative(ObjData& objData, const std::vector<RelativeCorner>& relativeCorners, const ObjChunkOffsets& offsets)
+        {
+            for (const RelativeCorner& relativeCorner : relativeCorners)
+            {
+                ObjIndex& corner = objData.corners[offsets.corners + relativeCorner.corner];
+                if (relativeCorner.attributes & relativePosition)
+                {
+                    corner.position += static_cast<int>(offsets.positions);
+                }
+                if (relativeCorner.attributes & relativeUv)
+                {
+                    corner.uv += static_cast<int>(offsets.uvs);
+                }
+                if (relativeCorner.attributes & relativeNormal)
+                {
+                    corner.normal += static_cast<int>(offsets.normals);
+                }
+                if (corner.position < 0 ||
+                    ((relativeCorner.attributes & relativeUv) && corner.uv < 0) ||
+                    ((relativeCorner.attributes & relativeNormal) && corner.normal < 0))
+                {
+                    throw std::runtime_error("Error invalid OBJ face index");
+                }
+            }
+        }
+
+        template <typename T>
+        void CopyChunk(std::vector<T>& dst, const std::vector<T>& src, size_t offset)
+        {
+            if (!src.empty())
+            {
+                std::memcpy(dst.data() + offset, src.data(), src.size() * sizeof(T));
+            }
+        }
+    }
+
+    void ObjParser::Parse(ObjData& objData, const std::string& filepath)
+    {
+        MappedFile file(filepath);
+        Parse(objData, file.data, file.data + file.size);
+    }
+
+    void ObjParser::Parse(ObjData& objData, const char* begin, const char* end)
+    {
+        objData = ObjData();
+
+        ThreadPool& threadPool = ThreadPool::Get();
+        size_t size = static_cast<size_t>(end - begin);
+        size_t chunkCount = std::min(size / minChunkSize, static_cast<size_t>(threadPool.GetThreadCount()) * 4);
+        if (chunkCount <= 1)
+        {
+            std::vector<RelativeCorner> relativeCorners;
+            ParseLines(objData, relativeCorners, begin, end);
+            ResolveRelative(objData, relativeCorners, ObjChunkOffsets{});
+            return;
+        }
+
+        // split the file at line boundaries, each chunk is parsed on its own
+        std::vector<const char*> splits(chunkCount + 1);
+        splits[0] = begin;
+        splits[chunkCount] = end;
+        for (size_t i = 1; i < chunkCount; i++)
+        {
+            const char* p = std::max(begin + size * i / chunkCount, splits[i - 1]);
+            splits[i] = p < end ? std::min(LineEnd(p, end) + 1, end) : end;
+        }
+
+        std::vector<ObjChunk> chunks(chunkCount);
+        threadPool.ParallelFor(chunkCount, [&](size_t i)
+        {
+            ParseLines(chunks[i].data, chunks[i].relativeCorners, splits[i], splits[i + 1]);
+        });
+
+        // the prefix sum of the chunk sizes gives the place of every chunk in the final arrays
+        std::vector<ObjChunkOffsets> offsets(chunkCount + 1, ObjChunkOffsets{});
+        for (size_t i = 0; i < chunkCount; i++)
+        {
+            const ObjData& data = chunks[i].data;
+            offsets[i + 1].positions = offsets[i].positions + data.positions.size();
+            offsets[i + 1].normals = offsets[i].normals + data.normals.size();
+            offsets[i + 1].uvs = offsets[i].uvs + data.uvs.size();
+            offsets[i + 1].corners = offsets[i].corners + data.corners.size();
+            offsets[i + 1].faceSizes = offsets[i].faceSizes + data.faceSizes.size();
+        }
+        objData.positions.resize(offsets[chunkCount].positions);
+        objData.normals.resize(offsets[chunkCount].normals);
+        objData.uvs.resize(offsets[chunkCount].uvs);
+        objData.corners.resize(offsets[chunkCount].corners);
+        objData.faceSizes.resize(offsets[chunkCount].faceSizes);
+
+        threadPool.ParallelFor(chunkCount, [&](size_t i)
+        {
+            const ObjData& data = chunks[i].data;
+            CopyChunk(objData.positions, data.positions, offsets[i].positions);
+            CopyChunk(objData.normals, data.normals, offsets[i].normals);
+            CopyChunk(objData.uvs, data.uvs, offsets[i].uvs);
+            CopyChunk(objData.corners, data.corners, offsets[i].corners);
+            CopyChunk(objData.faceSizes, data.faceSizes, offsets[i].faceSizes);
+            ResolveRelative(objData, chunks[i].relativeCorners, offsets[i]);
+        });
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include <string>
+
+using namespace DirectX;
+
+namespace mc
+{
+    // One corner of a face. Indices are already converted to 0 based, -1 means the attribute is missing.
+    struct ObjIndex
+    {
+        int position;
+        int uv;
+        int normal;
+
+        bool operator==(const ObjIndex& other) const
+        {
+            return position == other.position && uv == other.uv && normal == other.normal;
+        }
+    };
+
+    struct ObjData
+    {
+        std::vector<XMFLOAT3> positions;
+        std::vector<XMFLOAT3> normals;
+        std::vector<XMFLOAT2> uvs;
+        // corners of every face one after the other, faceSizes says how many corners each face has
+        std::vector<ObjIndex> corners;
+        std::vector<unsigned char> faceSizes;
+    };
+
+    class ObjParser
+    {
+    public:
+        // Replaces the content of objData. Big files are split at line boundaries and the
+        // chunks are parsed on the thread pool, the result is the same as parsing them in one go.
+        static void Parse(ObjData& objData, const std::string& filepath);
+        static void Parse(ObjData& objData, const char* begin, const char* end);
+    };
+}
@@ -65,10 +65,10 @@ namespace mc
 
         gm.SetDepthStencilOff();
         gm.SetSamplerLinearWrap();
-        GetDeviceContext(gm)->GSSetShaderResources(0, 1, randomTextureSRV_.GetAddressOf());
-        GetDeviceContext(gm)->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
+        GetStateCache(gm).SetShaderResource(ShaderStage::Geometry, 0, randomTextureSRV_.Get());
+        GetStateCache(gm).SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
         soVShader_->Bind(gm);
-        GetDeviceContext(gm)->PSSetShader(nullptr, 0, 0);
+        GetStateCache(gm).SetPixelShader(nullptr);
         soGShader_->Bind(gm);
 
         unsigned int stride = sizeof(VertexParticle);
@@ -78,16 +78,18 @@ namespace mc
         // the VB that contains the current particle list.
         if (firstRun_) 
         {
-            GetDeviceContext(gm)->IASetVertexBuffers(0, 1, initVB_.GetAddressOf(), &stride, &offset);
+            GetStateCache(gm).SetVertexBuffer(0, initVB_.Get(), stride, offset);
         }
         else 
         {
-            GetDeviceContext(gm)->IASetVertexBuffers(0, 1, &drawVB_, &stride, &offset);
+            GetStateCache(gm).SetVertexBuffer(0, drawVB_, stride, offset);
         }
 
         // Draw the current particle list using stream-out only to update them.  
         // The updated vertices are streamed-out to the target VB. 
         GetDeviceContext(gm)->SOSetTargets(1, &streamOutVB_, &offset);
+        // d3d unbinds the vertex buffers that are stream out targets
+        GetStateCache(gm).ForgetVertexBuffers();
         if (firstRun_)
         {
             GetDeviceContext(gm)->Draw(1, 0);
@@ -109,7 +111,7 @@ namespace mc
         gm.SetDepthStencilOnWriteMaskZero();
         gm.SetAdditiveBlending();
 
-        GetDeviceContext(gm)->IASetVertexBuffers(0, 1, &drawVB_, &stride, &offset);
+        GetStateCache(gm).SetVertexBuffer(0, drawVB_, stride, offset);
         texture_.Bind(gm, 0);
         dwVShader_->Bind(gm);
         dwPShader_->Bind(gm);
@@ -123,9 +125,9 @@ namespace mc
         gm.SetSamplerLinearClamp();
         gm.SetAlphaBlending();
         gm.SetDepthStencilOn();
-        GetDeviceContext(gm)->VSSetShader(nullptr, 0, 0);
-        GetDeviceContext(gm)->PSSetShader(nullptr, 0, 0);
-        GetDeviceContext(gm)->GSSetShader(nullptr, 0, 0);
+        GetStateCache(gm).SetVertexShader(nullptr);
+        GetStateCache(gm).SetPixelShader(nullptr);
+        GetStateCache(gm).SetGeometryShader(nullptr);
     }
 
     void ParticleSystem::CreateVertexBuffer(const GraphicsManager& gm)
@@ -52,6 +52,6 @@ namespace mc
 
     void PixelShader::Bind(const GraphicsManager& gm)
     {
-        GetDeviceContext(gm)->PSSetShader(shader_.Get(), 0, 0);
+        GetStateCache(gm).SetPixelShader(shader_.Get());
     }
 }
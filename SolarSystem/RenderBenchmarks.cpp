@@ -0,0 +1,426 @@
+#include "RenderBenchmarks.h"
+#include "RenderQueue.h"
+#include "RenderStateCache.h"
+#include "InstanceBatcher.h"
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <tuple>
+
+namespace mc
+{
+    namespace
+    {
+        // world matrix the way SceneNode did it before the transforms were cached: walk the parents every frame
+        XMMATRIX WalkWorld(const TransformHierarchy& hierarchy, unsigned int node)
+        {
+            XMVECTOR parentPosition = XMVectorZero();
+            for (unsigned int parent = hierarchy.GetParent(node); parent != TransformHierarchy::noNode; parent = hierarchy.GetParent(parent))
+            {
+                parentPosition += XMLoadFloat3(&hierarchy.GetPosition(parent));
+            }
+            XMMATRIX trans = XMMatrixTranslationFromVector(parentPosition + XMLoadFloat3(&hierarchy.GetPosition(node)));
+            XMMATRIX rot = XMMatrixRotationQuaternion(XMLoadFloat4(&hierarchy.GetRotation(node)));
+            XMMATRIX scale = XMMatrixScalingFromVector(XMLoadFloat3(&hierarchy.GetScale(node)));
+            return scale * rot * trans;
+        }
+
+        struct BenchmarkDraw
+        {
+            unsigned int shader;
+            unsigned int texture;
+            unsigned int mesh;
+        };
+
+        // shader, texture and mesh binds needed to draw the packets in their order
+        unsigned int CountStateChanges(const std::vector<RenderPacket>& packets, const std::vector<BenchmarkDraw>& draws)
+        {
+            unsigned int changes = 0;
+            const BenchmarkDraw* last = nullptr;
+            for (const RenderPacket& packet : packets)
+            {
+                const BenchmarkDraw& draw = draws[packet.item];
+                changes += !last || draw.shader != last->shader ? 1 : 0;
+                changes += !last || draw.texture != last->texture ? 1 : 0;
+                changes += !last || draw.mesh != last->mesh ? 1 : 0;
+                last = &draw;
+            }
+            return changes;
+        }
+
+        // what a state call binds: the call, the stage and slot, and up to three values
+        typedef std::array<uintptr_t, 3> MockBinding;
+        typedef std::map<unsigned int, MockBinding> MockState;
+
+        unsigned int MockKey(unsigned int call, ShaderStage stage, unsigned int slot)
+        {
+            return (call * RenderStateCache::stageCount + static_cast<unsigned int>(stage)) * 256 + slot;
+        }
+
+        enum MockCall
+        {
+            MOCK_BLEND, MOCK_DEPTH, MOCK_RASTERIZER, MOCK_SAMPLER, MOCK_SHADER, MOCK_RESOURCE, MOCK_CONSTANTS,
+            MOCK_VERTICES, MOCK_INDICES, MOCK_LAYOUT, MOCK_TOPOLOGY
+        };
+
+        // device context that only records the state it was given
+        class MockStateTarget : public RenderStateTarget
+        {
+        public:
+            void SetBlendState(ID3D11BlendState* state) override { Bind(MOCK_BLEND, ShaderStage::Vertex, 0, state); }
+            void SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef) override { Bind(MOCK_DEPTH, ShaderStage::Vertex, 0, state, stencilRef); }
+            void SetRasterizerState(ID3D11RasterizerState* state) override { Bind(MOCK_RASTERIZER, ShaderStage::Vertex, 0, state); }
+            void SetSampler(ShaderStage stage, unsigned int slot, ID3D11SamplerState* sampler) override { Bind(MOCK_SAMPLER, stage, slot, sampler); }
+            void SetVertexShader(ID3D11VertexShader* shader) override { Bind(MOCK_SHADER, ShaderStage::Vertex, 0, shader); }
+            void SetPixelShader(ID3D11PixelShader* shader) override { Bind(MOCK_SHADER, ShaderStage::Pixel, 0, shader); }
+            void SetGeometryShader(ID3D11GeometryShader* shader) override { Bind(MOCK_SHADER, ShaderStage::Geometry, 0, shader); }
+            void SetShaderResource(ShaderStage stage, unsigned int slot, ID3D11ShaderResourceView* view) override { Bind(MOCK_RESOURCE, stage, slot, view); }
+            void SetConstantBuffer(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer) override { Bind(MOCK_CONSTANTS, stage, slot, buffer); }
+            void SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset) override { Bind(MOCK_VERTICES, ShaderStage::Vertex, slot, buffer, stride, offset); }
+            void SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset) override { Bind(MOCK_INDICES, ShaderStage::Vertex, 0, buffer, format, offset); }
+            void SetInputLayout(ID3D11InputLayout* layout) override { Bind(MOCK_LAYOUT, ShaderStage::Vertex, 0, layout); }
+            void SetPrimitiveTopology(unsigned int topology) override { Bind(MOCK_TOPOLOGY, ShaderStage::Vertex, 0, nullptr, topology); }
+
+            const MockState& GetState() const { return state_; }
+            unsigned int GetCallCount() const { return callCount_; }
+
+        private:
+            void Bind(MockCall call, ShaderStage stage, unsigned int slot, const void* object, uintptr_t a = 0, uintptr_t b = 0)
+            {
+                state_[MockKey(call, stage, slot)] = MockBinding{ reinterpret_cast<uintptr_t>(object), a, b };
+                ++callCount_;
+            }
+
+            MockState state_;
+            unsigned int callCount_{ 0 };
+        };
+
+        template<typename Type>
+        Type* MockObject(unsigned int kind, unsigned int id)
+        {
+            return reinterpret_cast<Type*>(static_cast<uintptr_t>((kind * 1024 + id + 1) * 16));
+        }
+    }
+
+// PUBLICS:
+    bool RenderBenchmarks::SceneHierarchy()
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        const unsigned int maxDepth = 8;
+        const unsigned int frameCount = 20;
+        // the cached matrices are products of the same matrices in another order
+        const float maxPositionError = 1e-4f;
+        bool passed = true;
+
+        for (unsigned int nodeCount : { 10000u, 100000u, 1000000u })
+        {
+            // random tree built depth first like a scene is loaded: every node goes under one of the nodes of the
+            // branch added last
+            TransformHierarchy hierarchy;
+            std::vector<unsigned int> branch;
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned int i = 0; i < nodeCount; i++)
+            {
+                size_t depth = std::min<size_t>(random() % (branch.size() + 1), maxDepth - 1);
+                branch.resize(depth);
+                unsigned int node = hierarchy.Add(depth == 0 ? TransformHierarchy::noNode : branch.back());
+                hierarchy.SetPosition(node, XMFLOAT3(unit(random), unit(random), unit(random)));
+                hierarchy.SetScale(node, XMFLOAT3(1.0f, 1.0f, 1.0f));
+                branch.push_back(node);
+            }
+            double buildTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            start = std::chrono::steady_clock::now();
+            hierarchy.Update();
+            double fullTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            start = std::chrono::steady_clock::now();
+            for (unsigned int frame = 0; frame < frameCount; frame++)
+            {
+                hierarchy.Update();
+            }
+            double staticTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / frameCount;
+
+            // one node in a hundred moves every frame, with its subtree
+            double movingTime = 0.0;
+            for (unsigned int frame = 0; frame < frameCount; frame++)
+            {
+                for (unsigned int i = 0; i < nodeCount / 100; i++)
+                {
+                    unsigned int node = random() % nodeCount;
+                    hierarchy.SetPosition(node, XMFLOAT3(unit(random), unit(random), unit(random)));
+                }
+                start = std::chrono::steady_clock::now();
+                hierarchy.Update();
+                movingTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            movingTime /= frameCount;
+
+            start = std::chrono::steady_clock::now();
+            float maxError = 0.0f;
+            for (unsigned int node = 0; node < nodeCount; node++)
+            {
+                XMMATRIX walked = WalkWorld(hierarchy, node);
+                XMVECTOR cached = XMLoadFloat3(&hierarchy.GetWorldPosition(node));
+                maxError = std::max(maxError, XMVectorGetX(XMVector3Length(walked.r[3] - cached)));
+            }
+            double walkTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << nodeCount << " nodes: build " << buildTime * 1e3 << " ms, update all " << fullTime * 1e3
+                << " ms, 1% moving " << movingTime * 1e3 << " ms, static " << staticTime * 1e6
+                << " us, parent walk of every node " << walkTime * 1e3 << " ms, max difference " << maxError
+                << (maxError <= maxPositionError ? ", same positions" : ", DIFFERENT POSITIONS") << "\n";
+            passed = passed && maxError <= maxPositionError;
+        }
+        return passed;
+    }
+
+    bool RenderBenchmarks::RenderQueueSort()
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> depth(0.0f, 100.0f);
+        bool passed = true;
+        for (unsigned int packetCount : { 1000u, 10000u, 100000u, 1000000u })
+        {
+            // a frame with a few shaders, more textures and many meshes, one packet in ten translucent
+            std::vector<BenchmarkDraw> draws(packetCount);
+            RenderQueue queue;
+            for (unsigned int i = 0; i < packetCount; i++)
+            {
+                BenchmarkDraw& draw = draws[i];
+                draw.shader = random() % 16;
+                draw.texture = random() % 64;
+                draw.mesh = random() % 256;
+                queue.Add(RenderQueue::MakeKey(0, random() % 10 == 0, draw.shader, draw.texture, draw.mesh, depth(random)), i);
+            }
+            std::vector<RenderPacket> unsorted = queue.GetPackets();
+
+            // the packets are added again every frame, the sort is timed alone
+            const unsigned int frameCount = std::max(1u, 2000000u / packetCount);
+            double radixTime = 0.0;
+            for (unsigned int frame = 0; frame < frameCount; frame++)
+            {
+                queue.Clear();
+                for (const RenderPacket& packet : unsorted)
+                {
+                    queue.Add(packet.key, packet.item);
+                }
+                auto start = std::chrono::steady_clock::now();
+                queue.Sort();
+                radixTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            double stdTime = 0.0;
+            std::vector<RenderPacket> reference;
+            for (unsigned int frame = 0; frame < frameCount; frame++)
+            {
+                reference = unsorted;
+                auto start = std::chrono::steady_clock::now();
+                std::stable_sort(reference.begin(), reference.end(), [](const RenderPacket& a, const RenderPacket& b)
+                {
+                    return a.key < b.key;
+                });
+                stdTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            bool same = std::equal(reference.begin(), reference.end(), queue.GetPackets().begin(),
+                [](const RenderPacket& a, const RenderPacket& b)
+                {
+                    return a.key == b.key && a.item == b.item;
+                });
+
+            std::cout << packetCount << " packets: RenderQueue::Sort " << radixTime / frameCount * 1e6 << " us, std::stable_sort "
+                << stdTime / frameCount * 1e6 << " us, " << (same ? "same order" : "DIFFERENT ORDER") << ", state changes "
+                << CountStateChanges(unsorted, draws) << " unsorted " << CountStateChanges(queue.GetPackets(), draws) << " sorted\n";
+            passed = passed && same;
+        }
+        return passed;
+    }
+
+    bool RenderBenchmarks::StateCache()
+    {
+        std::mt19937 random(1);
+        bool passed = true;
+        for (bool sorted : { false, true })
+        {
+            // the binds of the draws of the scene: shared pipeline state, per material shaders and textures,
+            // per mesh buffers and per draw constants
+            const unsigned int drawCount = 5000;
+            const unsigned int frameCount = 100;
+            std::vector<BenchmarkDraw> draws(drawCount);
+            for (BenchmarkDraw& draw : draws)
+            {
+                draw.shader = random() % 16;
+                draw.texture = random() % 64;
+                draw.mesh = random() % 256;
+            }
+            if (sorted)
+            {
+                std::sort(draws.begin(), draws.end(), [](const BenchmarkDraw& a, const BenchmarkDraw& b)
+                    {
+                        return std::tie(a.shader, a.texture, a.mesh) < std::tie(b.shader, b.texture, b.mesh);
+                    });
+            }
+
+            MockStateTarget target;
+            RenderStateCache cache(target);
+            unsigned int mismatches = 0;
+            unsigned long long callCount = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned int frame = 0; frame < frameCount; frame++)
+            {
+                cache.SetBlendState(MockObject<ID3D11BlendState>(0, frame % 2));
+                cache.SetDepthStencilState(MockObject<ID3D11DepthStencilState>(1, 0), 1);
+                cache.SetSampler(ShaderStage::Pixel, 0, MockObject<ID3D11SamplerState>(2, 0));
+                cache.SetConstantBuffer(ShaderStage::Pixel, 1, MockObject<ID3D11Buffer>(3, 0));
+                callCount += 4;
+                for (const BenchmarkDraw& draw : draws)
+                {
+                    cache.SetRasterizerState(MockObject<ID3D11RasterizerState>(4, draw.shader % 2));
+                    cache.SetInputLayout(MockObject<ID3D11InputLayout>(5, 0));
+                    cache.SetVertexShader(MockObject<ID3D11VertexShader>(6, draw.shader % 4));
+                    cache.SetPixelShader(MockObject<ID3D11PixelShader>(7, draw.shader));
+                    cache.SetShaderResource(ShaderStage::Pixel, 0, MockObject<ID3D11ShaderResourceView>(8, draw.texture));
+                    cache.SetVertexBuffer(0, MockObject<ID3D11Buffer>(9, draw.mesh), 32, 0);
+                    cache.SetIndexBuffer(MockObject<ID3D11Buffer>(10, draw.mesh), 42, 0);
+                    cache.SetPrimitiveTopology(4);
+                    cache.SetConstantBuffer(ShaderStage::Vertex, 0, MockObject<ID3D11Buffer>(3, 1));
+                    callCount += 9;
+                }
+                cache.SetShaderResource(ShaderStage::Pixel, 0, nullptr);
+                ++callCount;
+                // a render target change drops the resources the cache knows about
+                cache.ForgetShaderResources();
+            }
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            // the state the mock must hold after the last frame, as if every call reached it
+            MockStateTarget reference;
+            reference.SetBlendState(MockObject<ID3D11BlendState>(0, (frameCount - 1) % 2));
+            reference.SetDepthStencilState(MockObject<ID3D11DepthStencilState>(1, 0), 1);
+            reference.SetSampler(ShaderStage::Pixel, 0, MockObject<ID3D11SamplerState>(2, 0));
+            reference.SetConstantBuffer(ShaderStage::Pixel, 1, MockObject<ID3D11Buffer>(3, 0));
+            const BenchmarkDraw& last = draws.back();
+            reference.SetRasterizerState(MockObject<ID3D11RasterizerState>(4, last.shader % 2));
+            reference.SetInputLayout(MockObject<ID3D11InputLayout>(5, 0));
+            reference.SetVertexShader(MockObject<ID3D11VertexShader>(6, last.shader % 4));
+            reference.SetPixelShader(MockObject<ID3D11PixelShader>(7, last.shader));
+            reference.SetVertexBuffer(0, MockObject<ID3D11Buffer>(9, last.mesh), 32, 0);
+            reference.SetIndexBuffer(MockObject<ID3D11Buffer>(10, last.mesh), 42, 0);
+            reference.SetPrimitiveTopology(4);
+            reference.SetConstantBuffer(ShaderStage::Vertex, 0, MockObject<ID3D11Buffer>(3, 1));
+            reference.SetShaderResource(ShaderStage::Pixel, 0, nullptr);
+            const MockState& expected = reference.GetState();
+            for (const auto& binding : expected)
+            {
+                auto found = target.GetState().find(binding.first);
+                mismatches += found == target.GetState().end() || found->second != binding.second ? 1 : 0;
+            }
+            mismatches += target.GetState().size() != expected.size() ? 1 : 0;
+
+            const RenderStateStats& stats = cache.GetStats();
+            bool counted = stats.issuedCalls == target.GetCallCount() && stats.issuedCalls + stats.filteredCalls == callCount;
+            std::cout << (sorted ? "sorted" : "unsorted") << " draws: " << stats.issuedCalls / frameCount << " issued "
+                << stats.filteredCalls / frameCount << " filtered calls per frame of " << callCount / frameCount << ", "
+                << time / callCount * 1e9 << " ns per call, " << (mismatches == 0 ? "same state" : "DIFFERENT STATE") << ", "
+                << (counted ? "counts match" : "COUNTS DIFFER") << "\n";
+            passed = passed && mismatches == 0 && counted;
+        }
+        return passed;
+    }
+
+    bool RenderBenchmarks::Instancing()
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        const MeshBounds bounds{ XMFLOAT3(-1.0f, -0.5f, -2.0f), XMFLOAT3(1.0f, 1.5f, 2.0f) };
+        // the packed rows are the world matrix times the dequantization, rounded once more
+        const float maxPositionError = 1e-3f;
+        bool passed = true;
+        for (unsigned int nodeCount : { 1000u, 10000u, 100000u, 1000000u })
+        {
+            // a belt of 8 rock meshes with 2 materials and 3 LODs picked by distance, the batch key is built
+            // like the one of Scene: batch id, LOD and the culling and translucent bits
+            std::vector<XMFLOAT4X4> worlds(nodeCount);
+            RenderQueue queue;
+            std::vector<unsigned long long> nodeKeys(nodeCount);
+            for (unsigned int i = 0; i < nodeCount; i++)
+            {
+                float angle = unit(random) * XM_2PI;
+                float radius = 50.0f + unit(random) * 20.0f;
+                XMVECTOR rotation = XMQuaternionRotationRollPitchYaw(unit(random) * XM_2PI, unit(random) * XM_2PI, 0.0f);
+                float scale = 0.1f + unit(random) * 0.4f;
+                XMMATRIX world = XMMatrixScaling(scale, scale, scale) * XMMatrixRotationQuaternion(rotation) *
+                    XMMatrixTranslation(std::cos(angle) * radius, (unit(random) - 0.5f) * 4.0f, std::sin(angle) * radius);
+                XMStoreFloat4x4(&worlds[i], world);
+                unsigned int mesh = random() % 8;
+                unsigned int material = random() % 2;
+                float depth = radius + unit(random) * 40.0f;
+                unsigned int lod = depth < 60.0f ? 0 : (depth < 80.0f ? 1 : 2);
+                nodeKeys[i] = (static_cast<unsigned long long>(material * 8 + mesh) << 32) | (lod << 2);
+                queue.Add(RenderQueue::MakeKey(0, false, material, 0, mesh, depth), i);
+            }
+            queue.Sort();
+            const std::vector<RenderPacket>& packets = queue.GetPackets();
+
+            std::vector<unsigned long long> batchKeys(nodeCount);
+            std::vector<ObjectInstance> instances(nodeCount);
+            std::vector<InstanceBatch> batches;
+            const unsigned int frameCount = std::max(1u, 2000000u / nodeCount);
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned int frame = 0; frame < frameCount; frame++)
+            {
+                for (size_t i = 0; i < packets.size(); i++)
+                {
+                    batchKeys[i] = nodeKeys[packets[i].item];
+                    InstanceBatcher::PackInstance(worlds[packets[i].item], bounds, instances[i]);
+                }
+                InstanceBatcher::Build(batchKeys.data(), batchKeys.size(), batches);
+            }
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / frameCount;
+
+            // every node in one batch, a batch never mixes keys and two batches next to each other never share one
+            unsigned int errors = 0;
+            size_t next = 0;
+            for (size_t b = 0; b < batches.size(); b++)
+            {
+                const InstanceBatch& batch = batches[b];
+                errors += batch.first != next || batch.count == 0 ? 1 : 0;
+                for (unsigned int i = batch.first; i < batch.first + batch.count; i++)
+                {
+                    errors += batchKeys[i] != batchKeys[batch.first] ? 1 : 0;
+                }
+                errors += b > 0 && batchKeys[batch.first] == batchKeys[batches[b - 1].first] ? 1 : 0;
+                next = batch.first + batch.count;
+            }
+            errors += next != nodeCount ? 1 : 0;
+
+            // the corner of the bounds through the packed rows against the world matrix
+            float maxError = 0.0f;
+            for (size_t i = 0; i < packets.size(); i++)
+            {
+                const ObjectInstance& instance = instances[i];
+                XMVECTOR quantized = XMVectorSet(1.0f, 0.25f, 0.5f, 0.0f);
+                XMVECTOR local = XMVectorSetW(quantized * XMLoadFloat4(&instance.positionScale) + XMLoadFloat4(&instance.positionOffset), 1.0f);
+                XMVECTOR packed = XMVectorSet(XMVectorGetX(XMVector4Dot(XMLoadFloat4(&instance.model[0]), local)),
+                    XMVectorGetX(XMVector4Dot(XMLoadFloat4(&instance.model[1]), local)),
+                    XMVectorGetX(XMVector4Dot(XMLoadFloat4(&instance.model[2]), local)), 1.0f);
+                XMVECTOR expected = XMVector3Transform(local, XMLoadFloat4x4(&worlds[packets[i].item]));
+                maxError = std::max(maxError, XMVectorGetX(XMVector3Length(packed - expected)));
+            }
+
+            std::cout << nodeCount << " nodes: " << batches.size() << " draws, " << time * 1e6 << " us to pack and batch, "
+                << (errors == 0 ? "batches ok" : "BAD BATCHES") << ", max instance position error " << maxError
+                << (maxError <= maxPositionError ? "" : " TOO BIG") << "\n";
+            passed = passed && errors == 0 && maxError <= maxPositionError;
+        }
+        return passed;
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+namespace mc
+{
+    // Headless benchmarks of the CPU side of the renderer, run by SolarSystemBench. They build synthetic frames
+    // and never touch a device.
+    class RenderBenchmarks
+    {
+    public:
+        // The benchmarks return false when their check fails.
+
+        // Updates the world transforms of scene hierarchies of 10k to 1M nodes with TransformHierarchy and checks
+        // the cached world positions against walking the parents
+        static bool SceneHierarchy();
+        // Sorts frames of 1k to 1M draw packets with RenderQueue and counts the state changes left after the sort
+        static bool RenderQueueSort();
+        // Draws frames through RenderStateCache into a mock device context, checks that the mock ends up with
+        // the state every call asked for and counts the issued and filtered calls
+        static bool StateCache();
+        // Groups sorted frames of 1k to 1M asteroid like nodes into instanced draws with InstanceBatcher and
+        // checks the batches and the packed instance matrices
+        static bool Instancing();
+    };
+}
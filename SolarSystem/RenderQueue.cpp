@@ -0,0 +1,98 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mc
+{
+    namespace
+    {
+        const unsigned int radixBits = 8;
+        const unsigned int radixSize = 1 << radixBits;
+        const unsigned int keyBytes = 8;
+        // under this many packets a comparison sort is faster than the eight passes of the radix sort
+        const size_t radixSortMinCount = 2048;
+
+        unsigned long long Field(unsigned int value, unsigned int bits)
+        {
+            return static_cast<unsigned long long>(value) & ((1ull << bits) - 1);
+        }
+    }
+
+// PUBLICS:
+    unsigned long long RenderQueue::MakeKey(unsigned int pass, bool translucent, unsigned int shader, unsigned int texture,
+        unsigned int mesh, float depth)
+    {
+        // the bits of a positive float sort like its value, the top 23 bits after the sign keep the exponent
+        // and the 15 high bits of the mantissa
+        unsigned int depthBitsValue;
+        std::memcpy(&depthBitsValue, &depth, sizeof(float));
+        unsigned long long quantizedDepth = (depthBitsValue >> (31 - depthBits)) & ((1u << depthBits) - 1);
+
+        unsigned long long state = Field(shader, shaderBits);
+        state = (state << textureBits) | Field(texture, textureBits);
+        state = (state << meshBits) | Field(mesh, meshBits);
+
+        unsigned long long key = Field(pass, passBits);
+        key = (key << 1) | (translucent ? 1 : 0);
+        if (translucent)
+        {
+            unsigned long long backToFront = ((1ull << depthBits) - 1) - quantizedDepth;
+            key = (key << depthBits) | backToFront;
+            key = (key << (shaderBits + textureBits + meshBits)) | state;
+        }
+        else
+        {
+            key = (key << (shaderBits + textureBits + meshBits)) | state;
+            key = (key << depthBits) | quantizedDepth;
+        }
+        return key;
+    }
+
+    void RenderQueue::Sort()
+    {
+        size_t count = packets_.size();
+        if (count < radixSortMinCount)
+        {
+            std::stable_sort(packets_.begin(), packets_.end(), [](const RenderPacket& a, const RenderPacket& b)
+                {
+                    return a.key < b.key;
+                });
+            return;
+        }
+
+        // the histograms of all the bytes in a single pass over the keys
+        unsigned int histograms[keyBytes][radixSize] = {};
+        for (const RenderPacket& packet : packets_)
+        {
+            for (unsigned int byte = 0; byte < keyBytes; byte++)
+            {
+                ++histograms[byte][(packet.key >> (byte * radixBits)) & (radixSize - 1)];
+            }
+        }
+
+        scratch_.resize(count);
+        for (unsigned int byte = 0; byte < keyBytes; byte++)
+        {
+            unsigned int* histogram = histograms[byte];
+            unsigned int firstBucket = static_cast<unsigned int>((packets_[0].key >> (byte * radixBits)) & (radixSize - 1));
+            if (histogram[firstBucket] == count)
+            {
+                continue;
+            }
+
+            unsigned int offset = 0;
+            for (unsigned int bucket = 0; bucket < radixSize; bucket++)
+            {
+                unsigned int bucketCount = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += bucketCount;
+            }
+            for (const RenderPacket& packet : packets_)
+            {
+                scratch_[histogram[(packet.key >> (byte * radixBits)) & (radixSize - 1)]++] = packet;
+            }
+            packets_.swap(scratch_);
+        }
+    }
+}
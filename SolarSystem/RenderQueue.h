@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+namespace mc
+{
+    struct RenderPacket
+    {
+        unsigned long long key;
+        // what to draw, the index of a scene node for Scene
+        unsigned int item;
+    };
+
+    // Draw packets of one frame sorted by a 64 bit key so the packets that share state are submitted together.
+    // From the most significant bits the key is the pass, the translucent flag and then:
+    //   opaque:      shader, texture, mesh, depth       front to back inside the same state
+    //   translucent: depth, shader, texture, mesh       back to front first, state only breaks ties
+    class RenderQueue
+    {
+    public:
+        static const unsigned int passBits = 4;
+        static const unsigned int shaderBits = 12;
+        static const unsigned int textureBits = 12;
+        static const unsigned int meshBits = 12;
+        static const unsigned int depthBits = 23;
+
+        // The ids are masked to the bits of their field, two ids that end up the same only make the
+        // sort put less state changes together. depth must not be negative.
+        static unsigned long long MakeKey(unsigned int pass, bool translucent, unsigned int shader, unsigned int texture,
+            unsigned int mesh, float depth);
+
+        void Clear() { packets_.clear(); }
+        void Add(unsigned long long key, unsigned int item) { packets_.push_back(RenderPacket{ key, item }); }
+        // Stable LSD radix sort by key, one pass per byte, the bytes that are the same in every key are skipped.
+        // Small queues like the scene of the game use a comparison sort instead.
+        void Sort();
+        const std::vector<RenderPacket>& GetPackets() const { return packets_; }
+
+    private:
+        std::vector<RenderPacket> packets_;
+        std::vector<RenderPacket> scratch_;
+    };
+}
@@ -0,0 +1,253 @@
+#include "RenderStateCache.h"
+
+#include <cstdint>
+
+namespace mc
+{
+    namespace
+    {
+        const void* const unknownState = reinterpret_cast<const void*>(~static_cast<uintptr_t>(0));
+
+        unsigned int StageIndex(ShaderStage stage)
+        {
+            return static_cast<unsigned int>(stage);
+        }
+    }
+
+// PUBLICS:
+    RenderStateCache::RenderStateCache(RenderStateTarget& target)
+        : target_(target)
+    {
+        Invalidate();
+    }
+
+    void RenderStateCache::SetBlendState(ID3D11BlendState* state)
+    {
+        if (Filter(blendState_ == state))
+        {
+            return;
+        }
+        blendState_ = state;
+        target_.SetBlendState(state);
+    }
+
+    void RenderStateCache::SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef)
+    {
+        if (Filter(depthStencilState_ == state && stencilRef_ == stencilRef))
+        {
+            return;
+        }
+        depthStencilState_ = state;
+        stencilRef_ = stencilRef;
+        target_.SetDepthStencilState(state, stencilRef);
+    }
+
+    void RenderStateCache::SetRasterizerState(ID3D11RasterizerState* state)
+    {
+        if (Filter(rasterizerState_ == state))
+        {
+            return;
+        }
+        rasterizerState_ = state;
+        target_.SetRasterizerState(state);
+    }
+
+    void RenderStateCache::SetSampler(ShaderStage stage, unsigned int slot, ID3D11SamplerState* sampler)
+    {
+        if (slot < cachedSlots)
+        {
+            const void*& bound = samplers_[StageIndex(stage)][slot];
+            if (Filter(bound == sampler))
+            {
+                return;
+            }
+            bound = sampler;
+        }
+        else
+        {
+            Filter(false);
+        }
+        target_.SetSampler(stage, slot, sampler);
+    }
+
+    void RenderStateCache::SetVertexShader(ID3D11VertexShader* shader)
+    {
+        const void*& bound = shaders_[StageIndex(ShaderStage::Vertex)];
+        if (Filter(bound == shader))
+        {
+            return;
+        }
+        bound = shader;
+        target_.SetVertexShader(shader);
+    }
+
+    void RenderStateCache::SetPixelShader(ID3D11PixelShader* shader)
+    {
+        const void*& bound = shaders_[StageIndex(ShaderStage::Pixel)];
+        if (Filter(bound == shader))
+        {
+            return;
+        }
+        bound = shader;
+        target_.SetPixelShader(shader);
+    }
+
+    void RenderStateCache::SetGeometryShader(ID3D11GeometryShader* shader)
+    {
+        const void*& bound = shaders_[StageIndex(ShaderStage::Geometry)];
+        if (Filter(bound == shader))
+        {
+            return;
+        }
+        bound = shader;
+        target_.SetGeometryShader(shader);
+    }
+
+    void RenderStateCache::SetShaderResource(ShaderStage stage, unsigned int slot, ID3D11ShaderResourceView* view)
+    {
+        if (slot < cachedSlots)
+        {
+            const void*& bound = shaderResources_[StageIndex(stage)][slot];
+            if (Filter(bound == view))
+            {
+                return;
+            }
+            bound = view;
+        }
+        else
+        {
+            Filter(false);
+        }
+        target_.SetShaderResource(stage, slot, view);
+    }
+
+    void RenderStateCache::SetConstantBuffer(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer)
+    {
+        if (slot < cachedSlots)
+        {
+            const void*& bound = constantBuffers_[StageIndex(stage)][slot];
+            if (Filter(bound == buffer))
+            {
+                return;
+            }
+            bound = buffer;
+        }
+        else
+        {
+            Filter(false);
+        }
+        target_.SetConstantBuffer(stage, slot, buffer);
+    }
+
+    void RenderStateCache::SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset)
+    {
+        if (slot < cachedSlots)
+        {
+            if (Filter(vertexBuffers_[slot] == buffer && vertexStrides_[slot] == stride && vertexOffsets_[slot] == offset))
+            {
+                return;
+            }
+            vertexBuffers_[slot] = buffer;
+            vertexStrides_[slot] = stride;
+            vertexOffsets_[slot] = offset;
+        }
+        else
+        {
+            Filter(false);
+        }
+        target_.SetVertexBuffer(slot, buffer, stride, offset);
+    }
+
+    void RenderStateCache::SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset)
+    {
+        if (Filter(indexBuffer_ == buffer && indexFormat_ == format && indexOffset_ == offset))
+        {
+            return;
+        }
+        indexBuffer_ = buffer;
+        indexFormat_ = format;
+        indexOffset_ = offset;
+        target_.SetIndexBuffer(buffer, format, offset);
+    }
+
+    void RenderStateCache::SetInputLayout(ID3D11InputLayout* layout)
+    {
+        if (Filter(inputLayout_ == layout))
+        {
+            return;
+        }
+        inputLayout_ = layout;
+        target_.SetInputLayout(layout);
+    }
+
+    void RenderStateCache::SetPrimitiveTopology(unsigned int topology)
+    {
+        if (Filter(topologyKnown_ && topology_ == topology))
+        {
+            return;
+        }
+        topology_ = topology;
+        topologyKnown_ = true;
+        target_.SetPrimitiveTopology(topology);
+    }
+
+    void RenderStateCache::Invalidate()
+    {
+        blendState_ = unknownState;
+        depthStencilState_ = unknownState;
+        stencilRef_ = 0;
+        rasterizerState_ = unknownState;
+        for (unsigned int stage = 0; stage < stageCount; stage++)
+        {
+            shaders_[stage] = unknownState;
+            for (unsigned int slot = 0; slot < cachedSlots; slot++)
+            {
+                samplers_[stage][slot] = unknownState;
+                constantBuffers_[stage][slot] = unknownState;
+            }
+        }
+        ForgetShaderResources();
+        ForgetVertexBuffers();
+        indexBuffer_ = unknownState;
+        indexFormat_ = 0;
+        indexOffset_ = 0;
+        inputLayout_ = unknownState;
+        topology_ = 0;
+        topologyKnown_ = false;
+    }
+
+    void RenderStateCache::ForgetShaderResources()
+    {
+        for (unsigned int stage = 0; stage < stageCount; stage++)
+        {
+            for (unsigned int slot = 0; slot < cachedSlots; slot++)
+            {
+                shaderResources_[stage][slot] = unknownState;
+            }
+        }
+    }
+
+    void RenderStateCache::ForgetVertexBuffers()
+    {
+        for (unsigned int slot = 0; slot < cachedSlots; slot++)
+        {
+            vertexBuffers_[slot] = unknownState;
+            vertexStrides_[slot] = 0;
+            vertexOffsets_[slot] = 0;
+        }
+    }
+
+// PRIVATES:
+    bool RenderStateCache::Filter(bool bound)
+    {
+        if (bound)
+        {
+            ++stats_.filteredCalls;
+        }
+        else
+        {
+            ++stats_.issuedCalls;
+        }
+        return bound;
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+// the cache only compares and passes on the state objects, it does not need d3d11.h
+struct ID3D11BlendState;
+struct ID3D11DepthStencilState;
+struct ID3D11RasterizerState;
+struct ID3D11SamplerState;
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11GeometryShader;
+struct ID3D11ShaderResourceView;
+struct ID3D11Buffer;
+struct ID3D11InputLayout;
+
+namespace mc
+{
+    enum class ShaderStage
+    {
+        Vertex,
+        Pixel,
+        Geometry
+    };
+
+    // Where RenderStateCache sends the calls that change the bound state: the device context of GraphicsManager,
+    // or a mock that records them.
+    class RenderStateTarget
+    {
+    public:
+        virtual ~RenderStateTarget() = default;
+
+        virtual void SetBlendState(ID3D11BlendState* state) = 0;
+        virtual void SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef) = 0;
+        virtual void SetRasterizerState(ID3D11RasterizerState* state) = 0;
+        virtual void SetSampler(ShaderStage stage, unsigned int slot, ID3D11SamplerState* sampler) = 0;
+        virtual void SetVertexShader(ID3D11VertexShader* shader) = 0;
+        virtual void SetPixelShader(ID3D11PixelShader* shader) = 0;
+        virtual void SetGeometryShader(ID3D11GeometryShader* shader) = 0;
+        virtual void SetShaderResource(ShaderStage stage, unsigned int slot, ID3D11ShaderResourceView* view) = 0;
+        virtual void SetConstantBuffer(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer) = 0;
+        virtual void SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset) = 0;
+        // format is a DXGI_FORMAT and topology a D3D11_PRIMITIVE_TOPOLOGY
+        virtual void SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset) = 0;
+        virtual void SetInputLayout(ID3D11InputLayout* layout) = 0;
+        virtual void SetPrimitiveTopology(unsigned int topology) = 0;
+    };
+
+    struct RenderStateStats
+    {
+        // calls passed on to the target
+        unsigned int issuedCalls;
+        // calls dropped because they set what was already bound
+        unsigned int filteredCalls;
+    };
+
+    // Shadow copy of the state bound to a RenderStateTarget, a call that sets the state already bound is dropped.
+    // Every state starts unknown, so the first call for each is always issued. The cache only knows about the calls
+    // made through it: binding a render target or a stream out buffer makes d3d unbind the same resource from the
+    // inputs, so the code doing that must forget the state it may have changed.
+    class RenderStateCache
+    {
+    public:
+        static const unsigned int stageCount = 3;
+        // the calls for slots from this one up are issued without caching
+        static const unsigned int cachedSlots = 16;
+
+        explicit RenderStateCache(RenderStateTarget& target);
+        RenderStateCache(const RenderStateCache&) = delete;
+        RenderStateCache& operator=(const RenderStateCache&) = delete;
+
+        void SetBlendState(ID3D11BlendState* state);
+        void SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef);
+        void SetRasterizerState(ID3D11RasterizerState* state);
+        void SetSampler(ShaderStage stage, unsigned int slot, ID3D11SamplerState* sampler);
+        void SetVertexShader(ID3D11VertexShader* shader);
+        void SetPixelShader(ID3D11PixelShader* shader);
+        void SetGeometryShader(ID3D11GeometryShader* shader);
+        void SetShaderResource(ShaderStage stage, unsigned int slot, ID3D11ShaderResourceView* view);
+        void SetConstantBuffer(ShaderStage stage, unsigned int slot, ID3D11Buffer* buffer);
+        void SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride, unsigned int offset);
+        void SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset);
+        void SetInputLayout(ID3D11InputLayout* layout);
+        void SetPrimitiveTopology(unsigned int topology);
+
+        // all the state is unknown again
+        void Invalidate();
+        void ForgetShaderResources();
+        void ForgetVertexBuffers();
+
+        const RenderStateStats& GetStats() const { return stats_; }
+        void ResetStats() { stats_ = RenderStateStats{}; }
+
+    private:
+        // counts the call, true when it sets what is already bound
+        bool Filter(bool bound);
+
+        RenderStateTarget& target_;
+        RenderStateStats stats_{};
+
+        // the bound objects are only compared, an unknown state holds a pointer no object has
+        const void* blendState_;
+        const void* depthStencilState_;
+        unsigned int stencilRef_;
+        const void* rasterizerState_;
+        const void* samplers_[stageCount][cachedSlots];
+        const void* shaders_[stageCount];
+        const void* shaderResources_[stageCount][cachedSlots];
+        const void* constantBuffers_[stageCount][cachedSlots];
+        const void* vertexBuffers_[cachedSlots];
+        unsigned int vertexStrides_[cachedSlots];
+        unsigned int vertexOffsets_[cachedSlots];
+        const void* indexBuffer_;
+        unsigned int indexFormat_;
+        unsigned int indexOffset_;
+        const void* inputLayout_;
+        unsigned int topology_;
+        bool topologyKnown_;
+    };
+}
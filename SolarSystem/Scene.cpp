@@ -6,87 +6,424 @@
 #include "Mesh.h"
 #include "Texture.h"
 
+#include <cmath>
+
 namespace mc
 {
+    namespace
+    {
+        // a LOD is used while its error projected on the screen is under this many pixels
+        const float lodPixelError = 1.0f;
+        // going to a coarser LOD needs the error to be this much under the limit, so nodes dont pop at the boundary
+        const float lodHysteresis = 0.2f;
+        // render queue pass of the scene nodes
+        const unsigned int scenePass = 0;
+        // vertex buffer slot of the instance data, the mesh uses slot 0
+        const unsigned int instanceSlot = 1;
+
+        template <typename Key>
+        unsigned int StateId(std::map<Key, unsigned int>& ids, const Key& key)
+        {
+            auto it = ids.find(key);
+            if (it != ids.end())
+            {
+                return it->second;
+            }
+            unsigned int id = static_cast<unsigned int>(ids.size());
+            ids.emplace(key, id);
+            return id;
+        }
+    }
+
+    XMVECTOR SceneNode::GetPosition()
+    {
+        return XMVectorSetW(XMLoadFloat3(&scene_.transforms_.GetPosition(handle_)), 1.0f);
+    }
+
+    void SceneNode::SetPosition(float x, float y, float z)
+    {
+        scene_.transforms_.SetPosition(handle_, XMFLOAT3(x, y, z));
+    }
+
+    void SceneNode::SetRotation(XMVECTOR rotation)
+    {
+        XMFLOAT4 value;
+        XMStoreFloat4(&value, rotation);
+        scene_.transforms_.SetRotation(handle_, value);
+    }
+
+    void SceneNode::SetScale(float x, float y, float z)
+    {
+        scene_.transforms_.SetScale(handle_, XMFLOAT3(x, y, z));
+    }
+
+    void SceneNode::SetMesh(mc::Mesh* mesh)
+    {
+        scene_.drawData_[handle_].mesh = mesh;
+        scene_.drawData_[handle_].meshId = StateId<const void*>(scene_.meshIds_, mesh);
+        scene_.UpdateBatchId(scene_.drawData_[handle_]);
+        if (!mesh)
+        {
+            scene_.transforms_.SetBounds(handle_, XMFLOAT3(0.0f, 0.0f, 0.0f), -1.0f);
+            return;
+        }
+        const MeshBounds& bounds = mesh->GetBounds();
+        XMVECTOR min = XMLoadFloat3(&bounds.min);
+        XMVECTOR max = XMLoadFloat3(&bounds.max);
+        XMFLOAT3 center;
+        XMStoreFloat3(&center, (min + max) * 0.5f);
+        scene_.transforms_.SetBounds(handle_, center, XMVectorGetX(XMVector3Length(max - min)) * 0.5f);
+    }
+
+    void SceneNode::SetTexture(mc::Texture* texture)
+    {
+        scene_.drawData_[handle_].texture = texture;
+        scene_.drawData_[handle_].textureId = StateId<const void*>(scene_.textureIds_, texture);
+        scene_.UpdateBatchId(scene_.drawData_[handle_]);
+    }
+
+    void SceneNode::SetVertexShader(mc::VertexShader* vs)
+    {
+        Scene::NodeDrawData& node = scene_.drawData_[handle_];
+        node.vs = vs;
+        node.shaderId = StateId(scene_.shaderIds_, std::pair<const void*, const void*>(node.vs, node.ps));
+        scene_.UpdateBatchId(node);
+    }
+
+    void SceneNode::SetPixelShader(mc::PixelShader* ps)
+    {
+        Scene::NodeDrawData& node = scene_.drawData_[handle_];
+        node.ps = ps;
+        node.shaderId = StateId(scene_.shaderIds_, std::pair<const void*, const void*>(node.vs, node.ps));
+        scene_.UpdateBatchId(node);
+    }
+
     XMVECTOR SceneNode::GetParentPosition()
     {
-        SceneNode* parent = parent_;
-        XMVECTOR position = XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
-        while (parent)
+        unsigned int parent = scene_.transforms_.GetParent(handle_);
+        if (parent == TransformHierarchy::noNode)
         {
-            position += parent->position_;
-            parent = parent->parent_;
+            return XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
         }
-        return position;
+        scene_.transforms_.Update();
+        return XMLoadFloat3(&scene_.transforms_.GetWorldPosition(parent));
     }
 
     void SceneNode::SetCullBack(bool value)
     {
-        cullBack_ = value;
+        scene_.drawData_[handle_].cullBack = value;
+    }
+
+    void SceneNode::SetTranslucent(bool value)
+    {
+        scene_.drawData_[handle_].translucent = value;
     }
 
     XMMATRIX SceneNode::GetModelMatrix()
     {
-        XMMATRIX trans = XMMatrixTranslationFromVector(GetParentPosition() + position_);
-        XMMATRIX rot = XMMatrixRotationQuaternion(rotation_);
-        XMMATRIX scale = XMMatrixScalingFromVector(scale_);
-        return scale * rot * trans;
+        scene_.transforms_.Update();
+        return XMLoadFloat4x4(&scene_.transforms_.GetWorld(handle_));
     }
 
     SceneNode& SceneNode::AddNode()
     {
-        SceneNode& node = childrens_.emplace_back();
-        node.parent_ = this;
-        return node;
+        return scene_.AddNode(handle_);
+    }
+
+    Scene::Scene(ObjectConstBuffer* objectCPUBuffer, ConstBuffer<ObjectConstBuffer>* objectGPUBuffer)
+        : objectCPUBuffer_(objectCPUBuffer), objectGPUBuffer_(objectGPUBuffer)
+    {
+    }
+
+    SceneNode& Scene::AddNode()
+    {
+        return AddNode(TransformHierarchy::noNode);
+    }
+
+    void Scene::SetInstancedVertexShader(mc::VertexShader* vs, mc::VertexShader* instancedVs, mc::InputLayout* instancedLayout)
+    {
+        instancedShaders_[vs] = InstancedShader{ instancedVs, instancedLayout };
+    }
+
+    void Scene::SetLodView(const XMFLOAT3& viewPos, float fov, float viewportHeight)
+    {
+        lodViewPos_ = viewPos;
+        lodProjectionScale_ = viewportHeight * 0.5f / std::tanf(fov * 0.5f);
     }
 
-    void SceneNode::Draw(const mc::GraphicsManager& gm, const Scene& scene)
+    void Scene::SetFrustum(const XMMATRIX& viewProj)
     {
-        if (!cullBack_)
+        frustum_ = Frustum(viewProj);
+        hasFrustum_ = true;
+    }
+
+    void Scene::Draw(const mc::GraphicsManager& gm)
+    {
+        transforms_.Update();
+
+        // cull all the nodes before anything is sent to the GPU, the nodes without a mesh have a negative
+        // radius and are never visible
+        size_t count = transforms_.GetCount();
+        inFrustum_.resize(count);
+        if (hasFrustum_)
         {
-            gm.SetRasterizerStateCullNone();
+            frustum_.IntersectsSpheres(transforms_.GetSphereX(), transforms_.GetSphereY(), transforms_.GetSphereZ(),
+                transforms_.GetSphereRadius(), count, inFrustum_.data());
+        }
+        else
+        {
+            for (size_t index = 0; index < count; index++)
+            {
+                inFrustum_[index] = transforms_.GetSphereRadius()[index] >= 0.0f ? 1 : 0;
+            }
         }
 
-        XMMATRIX trans = XMMatrixTranslationFromVector(GetParentPosition() + position_);
-        XMMATRIX rot = XMMatrixRotationQuaternion(rotation_);
-        XMMATRIX scale = XMMatrixScalingFromVector(scale_);
+        // a node without back face culling turns it off for its children too
+        cullNone_.resize(count);
+        visibleNodes_.clear();
+        nodeCullStats_ = SceneCullStats{};
+        clusterCullStats_ = ClusterCullStats{};
+        for (size_t index = 0; index < count; index++)
+        {
+            unsigned int parent = transforms_.GetParentAt(index);
+            const NodeDrawData& node = drawData_[transforms_.GetNodeAt(index)];
+            cullNone_[index] = !node.cullBack || (parent != TransformHierarchy::noNode && cullNone_[parent]);
+            if (!node.mesh)
+            {
+                continue;
+            }
+            ++nodeCullStats_.testedNodes;
+            if (inFrustum_[index])
+            {
+                visibleNodes_.push_back(static_cast<unsigned int>(index));
+            }
+            else
+            {
+                ++nodeCullStats_.culledNodes;
+            }
+        }
 
-        scene.objectCPUBuffer_->model = scale * rot * trans;
-        scene.objectGPUBuffer_->Update(gm, *scene.objectCPUBuffer_);
-        if (vs_) { vs_->Bind(gm); }
-        if (ps_) { ps_->Bind(gm); }
-        if (texture_) { texture_->Bind(gm, 0); }
-        if (mesh_) { mesh_->Draw(gm); }
-        if (texture_) { texture_->Unbind(gm, 0); }
+        // the LOD is picked before the sort so the depth of the key is known, then the packets that share
+        // shaders, textures and meshes are drawn together and only the state that changes is bound
+        renderQueue_.Clear();
+        XMVECTOR viewPos = XMLoadFloat3(&lodViewPos_);
+        for (unsigned int index : visibleNodes_)
+        {
+            unsigned int handle = transforms_.GetNodeAt(index);
+            NodeDrawData& node = drawData_[handle];
+            SelectLod(node, XMLoadFloat4x4(&transforms_.GetWorldAt(index)), transforms_.GetScale(handle));
+            XMVECTOR center = XMVectorSet(transforms_.GetSphereX()[index], transforms_.GetSphereY()[index],
+                transforms_.GetSphereZ()[index], 1.0f);
+            float depth = XMVectorGetX(XMVector3Length(center - viewPos));
+            renderQueue_.Add(RenderQueue::MakeKey(scenePass, node.translucent, node.shaderId, node.textureId, node.meshId, depth), index);
+        }
+        renderQueue_.Sort();
 
-        for (auto& child : childrens_)
+        // the packets next to each other that draw the same mesh the same way become one instanced draw, the
+        // instances of the whole frame go to the instance buffer with a single map
+        const std::vector<RenderPacket>& packets = renderQueue_.GetPackets();
+        batchKeys_.resize(packets.size());
+        instances_.resize(packets.size());
+        for (size_t i = 0; i < packets.size(); i++)
         {
-            child.Draw(gm, scene);
+            unsigned int index = packets[i].item;
+            const NodeDrawData& node = drawData_[transforms_.GetNodeAt(index)];
+            batchKeys_[i] = (static_cast<unsigned long long>(node.batchId) << 32) | (static_cast<unsigned long long>(node.lod) << 2) |
+                (cullNone_[index] ? 2 : 0) | (node.translucent ? 1 : 0);
+            InstanceBatcher::PackInstance(transforms_.GetWorldAt(index), node.mesh->GetBounds(), instances_[i]);
+        }
+        InstanceBatcher::Build(batchKeys_.data(), batchKeys_.size(), batches_);
+        if (!instances_.empty() && !instancedShaders_.empty())
+        {
+            if (!instanceBuffer_)
+            {
+                instanceBuffer_ = std::make_unique<InstanceBuffer>(gm, static_cast<unsigned int>(sizeof(ObjectInstance)),
+                    static_cast<unsigned int>(instances_.size()));
+            }
+            instanceBuffer_->Update(gm, instances_.data(), static_cast<unsigned int>(instances_.size()));
+            instanceBuffer_->Bind(gm, instanceSlot);
         }
 
-        if (!cullBack_)
+        gm.SetRasterizerStateCullBack();
+        bool cullNone = false;
+        const VertexShader* boundVs = nullptr;
+        const PixelShader* boundPs = nullptr;
+        Texture* boundTexture = nullptr;
+        const Mesh* boundMesh = nullptr;
+        // the layout the mesh was bound with, null for its own
+        const InputLayout* boundLayout = nullptr;
+        drawCount_ = 0;
+        for (const InstanceBatch& batch : batches_)
+        {
+            unsigned int index = packets[batch.first].item;
+            const NodeDrawData& node = drawData_[transforms_.GetNodeAt(index)];
+            auto instanced = node.vs ? instancedShaders_.find(node.vs) : instancedShaders_.end();
+            VertexShader* vs = instanced != instancedShaders_.end() ? instanced->second.vs : node.vs;
+            InputLayout* layout = instanced != instancedShaders_.end() ? instanced->second.layout : nullptr;
+            if ((cullNone_[index] != 0) != cullNone)
+            {
+                cullNone = cullNone_[index] != 0;
+                if (cullNone)
+                {
+                    gm.SetRasterizerStateCullNone();
+                }
+                else
+                {
+                    gm.SetRasterizerStateCullBack();
+                }
+            }
+            if (vs && vs != boundVs)
+            {
+                vs->Bind(gm);
+                boundVs = vs;
+            }
+            if (node.ps && node.ps != boundPs)
+            {
+                node.ps->Bind(gm);
+                boundPs = node.ps;
+            }
+            if (node.texture != boundTexture)
+            {
+                if (node.texture)
+                {
+                    node.texture->Bind(gm, 0);
+                }
+                else
+                {
+                    boundTexture->Unbind(gm, 0);
+                }
+                boundTexture = node.texture;
+            }
+            if (layout)
+            {
+                bool bindMesh = node.mesh != boundMesh || layout != boundLayout;
+                if (DrawInstances(gm, node, layout, batch, XMLoadFloat4x4(&transforms_.GetWorldAt(index)), bindMesh))
+                {
+                    boundMesh = node.mesh;
+                    boundLayout = layout;
+                }
+                ++drawCount_;
+                continue;
+            }
+            // without an instanced shader the nodes of the batch are drawn one by one
+            for (unsigned int i = batch.first; i < batch.first + batch.count; i++)
+            {
+                unsigned int nodeIndex = packets[i].item;
+                bool bindMesh = node.mesh != boundMesh || boundLayout != nullptr;
+                if (DrawNode(gm, drawData_[transforms_.GetNodeAt(nodeIndex)], XMLoadFloat4x4(&transforms_.GetWorldAt(nodeIndex)), bindMesh))
+                {
+                    boundMesh = node.mesh;
+                    boundLayout = nullptr;
+                }
+                ++drawCount_;
+            }
+        }
+        if (boundTexture)
+        {
+            boundTexture->Unbind(gm, 0);
+        }
+        if (cullNone)
         {
             gm.SetRasterizerStateCullBack();
         }
     }
 
+// PRIVATES:
+    SceneNode& Scene::AddNode(unsigned int parent)
+    {
+        unsigned int handle = transforms_.Add(parent);
+        drawData_.emplace_back();
+        return nodes_.emplace_back(*this, handle);
+    }
 
+    bool Scene::DrawNode(const mc::GraphicsManager& gm, const NodeDrawData& node, const XMMATRIX& model, bool bindMesh)
+    {
+        objectCPUBuffer_->model = model;
+        const MeshBounds& bounds = node.mesh->GetBounds();
+        objectCPUBuffer_->positionScale = XMFLOAT4(bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z, 0.0f);
+        objectCPUBuffer_->positionOffset = XMFLOAT4(bounds.min.x, bounds.min.y, bounds.min.z, 0.0f);
+        objectGPUBuffer_->Update(gm, *objectCPUBuffer_);
+        if (node.lod == 0 && node.mesh->GetClusterCount() > 0 && hasFrustum_)
+        {
+            return DrawVisibleClusters(gm, *node.mesh, model, node.cullBack, bindMesh) || !bindMesh;
+        }
+        node.mesh->Draw(gm, node.lod, bindMesh);
+        return true;
+    }
 
-    Scene::Scene(ObjectConstBuffer* objectCPUBuffer, ConstBuffer<ObjectConstBuffer>* objectGPUBuffer)
-        : objectCPUBuffer_(objectCPUBuffer), objectGPUBuffer_(objectGPUBuffer)
+    bool Scene::DrawInstances(const mc::GraphicsManager& gm, const NodeDrawData& node, mc::InputLayout* layout,
+        const InstanceBatch& batch, const XMMATRIX& firstModel, bool bindMesh)
     {
+        // a single instance still draws only its visible clusters
+        if (batch.count == 1 && node.lod == 0 && node.mesh->GetClusterCount() > 0 && hasFrustum_)
+        {
+            return DrawVisibleClusters(gm, *node.mesh, firstModel, node.cullBack, bindMesh, layout, batch.first) || !bindMesh;
+        }
+        node.mesh->DrawInstanced(gm, layout, batch.count, batch.first, node.lod, bindMesh);
+        return true;
     }
 
-    SceneNode& Scene::AddNode()
+    void Scene::SelectLod(NodeDrawData& node, const XMMATRIX& model, const XMFLOAT3& scale)
     {
-        return root_.AddNode();
+        unsigned int lodCount = node.mesh->GetLodCount();
+        if (lodCount <= 1 || lodProjectionScale_ <= 0.0f)
+        {
+            node.lod = 0;
+            return;
+        }
+
+        // bounding sphere of the mesh in world space, the LOD errors are relative to the diagonal of the bounds
+        const MeshBounds& bounds = node.mesh->GetBounds();
+        XMVECTOR min = XMLoadFloat3(&bounds.min);
+        XMVECTOR max = XMLoadFloat3(&bounds.max);
+        XMVECTOR center = XMVector3TransformCoord((min + max) * 0.5f, model);
+        float maxScale = std::fmaxf(std::fabs(scale.x), std::fmaxf(std::fabs(scale.y), std::fabs(scale.z)));
+        float size = XMVectorGetX(XMVector3Length(max - min)) * maxScale;
+        float distance = XMVectorGetX(XMVector3Length(center - XMLoadFloat3(&lodViewPos_))) - size * 0.5f;
+        if (distance <= 0.0f)
+        {
+            node.lod = 0;
+            return;
+        }
+        float projectedSize = size * lodProjectionScale_ / distance;
+
+        unsigned int lod = 0;
+        for (unsigned int i = lodCount - 1; i > 0; i--)
+        {
+            float limit = i > node.lod ? lodPixelError * (1.0f - lodHysteresis) : lodPixelError;
+            if (node.mesh->GetLodError(i) * projectedSize <= limit)
+            {
+                lod = i;
+                break;
+            }
+        }
+        node.lod = lod;
     }
 
+    bool Scene::DrawVisibleClusters(const mc::GraphicsManager& gm, Mesh& mesh, const XMMATRIX& model, bool backfaceCull, bool bind,
+        mc::InputLayout* instanceLayout, unsigned int instance)
+    {
+        visibleRanges_.clear();
+        ClusterCuller::Cull(mesh.GetClusters(), mesh.GetClusterCount(), model, frustum_,
+            XMLoadFloat3(&lodViewPos_), backfaceCull, visibleRanges_, clusterCullStats_);
+        if (visibleRanges_.empty())
+        {
+            return false;
+        }
+        if (instanceLayout)
+        {
+            mesh.DrawRangesInstanced(gm, instanceLayout, visibleRanges_.data(), visibleRanges_.size(), 1, instance, bind);
+        }
+        else
+        {
+            mesh.DrawRanges(gm, visibleRanges_.data(), visibleRanges_.size(), bind);
+        }
+        return true;
+    }
 
-    void Scene::Draw(const mc::GraphicsManager& gm)
+    void Scene::UpdateBatchId(NodeDrawData& node)
     {
-        gm.SetRasterizerStateCullBack();
-        root_.Draw(gm, *this);
+        node.batchId = StateId(batchIds_, std::array<const void*, 4>{ node.vs, node.ps, node.texture, node.mesh });
     }
 
 }
\ No newline at end of file
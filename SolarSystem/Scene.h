@@ -2,7 +2,16 @@
 
 #include "ConstBuffer.h"
 #include "GameConstBuffers.h"
-#include <list>
+#include "ClusterCuller.h"
+#include "TransformHierarchy.h"
+#include "RenderQueue.h"
+#include "InstanceBatcher.h"
+#include "InstanceBuffer.h"
+#include <array>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
 
 namespace mc
 {
@@ -11,51 +20,41 @@ namespace mc
     class Texture;
     class VertexShader;
     class PixelShader;
+    class InputLayout;
     class GraphicsManager;
 
+    struct SceneCullStats
+    {
+        unsigned int testedNodes;
+        unsigned int culledNodes;
+    };
+
+    // Handle to a node of a Scene, the reference returned by AddNode stays valid as long as the scene
     class SceneNode
     {
     public:
-        XMVECTOR GetPosition()
-        {
-            return position_;
-        }
+        // made by Scene::AddNode
+        SceneNode(Scene& scene, unsigned int handle) : scene_(scene), handle_(handle) {}
 
-        void SetPosition(float x, float y, float z)
-        {
-            position_ = XMVectorSet(x, y, z, 1.0f);
-        }
-        void SetRotation(XMVECTOR rotation)
-        {
-            rotation_ = rotation;
-        }
-        void SetScale(float x, float y, float z)
-        {
-            scale_ = XMVectorSet(x, y, z, 1.0f);
-        }
-        void SetMesh(mc::Mesh* mesh) { mesh_ = mesh; }
-        void SetTexture(mc::Texture* texture) { texture_ = texture; }
-        void SetVertexShader(mc::VertexShader* vs) { vs_ = vs; }
-        void SetPixelShader(mc::PixelShader* ps) { ps_ = ps; }
+        XMVECTOR GetPosition();
+        void SetPosition(float x, float y, float z);
+        void SetRotation(XMVECTOR rotation);
+        void SetScale(float x, float y, float z);
+        void SetMesh(mc::Mesh* mesh);
+        void SetTexture(mc::Texture* texture);
+        void SetVertexShader(mc::VertexShader* vs);
+        void SetPixelShader(mc::PixelShader* ps);
 
         XMVECTOR GetParentPosition();
         void SetCullBack(bool value);
+        // translucent nodes are drawn after the opaque ones, from back to front
+        void SetTranslucent(bool value);
         XMMATRIX GetModelMatrix();
         SceneNode& AddNode();
-        void Draw(const mc::GraphicsManager& gm, const Scene& scene);
 
     private:
-        mc::Mesh* mesh_{ nullptr };
-        mc::Texture* texture_{ nullptr };
-        mc::VertexShader* vs_{ nullptr };
-        mc::PixelShader* ps_{ nullptr };
-        bool cullBack_{ true };
-
-        XMVECTOR position_;
-        XMVECTOR rotation_;
-        XMVECTOR scale_;
-        std::list<SceneNode> childrens_;
-        SceneNode* parent_;
+        Scene& scene_;
+        unsigned int handle_;
     };
 
     class Scene
@@ -65,10 +64,98 @@ namespace mc
         SceneNode& AddNode();
         void Draw(const mc::GraphicsManager& gm);
 
+        // The nodes with the vertex shader vs are drawn instanced with instancedVs, which reads the model matrix
+        // and the position dequantization from ObjectInstance vertex data through instancedLayout. The nodes
+        // that share a mesh, LOD, shaders, texture and culling and are next to each other after the sort
+        // become a single draw.
+        void SetInstancedVertexShader(mc::VertexShader* vs, mc::VertexShader* instancedVs, mc::InputLayout* instancedLayout);
+
+        // camera used to pick the LOD of the nodes, projection scale is the size
+        // in pixels of one unit at distance one
+        void SetLodView(const XMFLOAT3& viewPos, float fov, float viewportHeight);
+        const XMFLOAT3& GetLodViewPos() const { return lodViewPos_; }
+        float GetLodProjectionScale() const { return lodProjectionScale_; }
+
+        // frustum used to skip the nodes outside of it and to draw only the visible clusters of the meshes,
+        // until it is set every node is drawn whole
+        void SetFrustum(const XMMATRIX& viewProj);
+        // nodes with a mesh tested against the frustum and culled by the last Draw
+        const SceneCullStats& GetNodeCullStats() const { return nodeCullStats_; }
+        // draws of meshes made by the last Draw, an instanced draw counts once
+        unsigned int GetDrawCount() const { return drawCount_; }
+        // triangles of clustered meshes tested and culled by the last Draw
+        const ClusterCullStats& GetClusterCullStats() const { return clusterCullStats_; }
+
         ObjectConstBuffer* objectCPUBuffer_;
         ConstBuffer<ObjectConstBuffer>* objectGPUBuffer_;
     private:
-        SceneNode root_;
+        friend class SceneNode;
+
+        // what a node draws, by handle
+        struct NodeDrawData
+        {
+            mc::Mesh* mesh{ nullptr };
+            mc::Texture* texture{ nullptr };
+            mc::VertexShader* vs{ nullptr };
+            mc::PixelShader* ps{ nullptr };
+            bool cullBack{ true };
+            bool translucent{ false };
+            unsigned int lod{ 0 };
+            // small numbers for the render queue keys, nodes that use the same state get the same id
+            unsigned int shaderId{ 0 };
+            unsigned int textureId{ 0 };
+            unsigned int meshId{ 0 };
+            // nodes with the same shaders, texture and mesh get the same id, without masking
+            unsigned int batchId{ 0 };
+        };
+
+        struct InstancedShader
+        {
+            mc::VertexShader* vs;
+            mc::InputLayout* layout;
+        };
+
+        SceneNode& AddNode(unsigned int parent);
+        // Returns true when the buffers of the mesh are bound after the call
+        bool DrawNode(const mc::GraphicsManager& gm, const NodeDrawData& node, const XMMATRIX& model, bool bindMesh);
+        void SelectLod(NodeDrawData& node, const XMMATRIX& model, const XMFLOAT3& scale);
+        // draws the batch of the packets from batch.first, which are also its instances in the instance buffer
+        bool DrawInstances(const mc::GraphicsManager& gm, const NodeDrawData& node, mc::InputLayout* layout,
+            const InstanceBatch& batch, const XMMATRIX& firstModel, bool bindMesh);
+        // with an instance layout the clusters of the instance at instance of the instance buffer are drawn
+        bool DrawVisibleClusters(const mc::GraphicsManager& gm, Mesh& mesh, const XMMATRIX& model, bool backfaceCull, bool bind,
+            mc::InputLayout* instanceLayout = nullptr, unsigned int instance = 0);
+        void UpdateBatchId(NodeDrawData& node);
+
+        TransformHierarchy transforms_;
+        // a deque so the references to the nodes stay valid when more are added
+        std::deque<SceneNode> nodes_;
+        std::vector<NodeDrawData> drawData_;
+        // by index of the transforms, the node or one of its parents draws without back face culling
+        std::vector<unsigned char> cullNone_;
+        // by index of the transforms, the bounding sphere of the node touches the frustum
+        std::vector<unsigned char> inFrustum_;
+        // indices of the nodes to draw this frame
+        std::vector<unsigned int> visibleNodes_;
+        RenderQueue renderQueue_;
+        std::map<std::pair<const void*, const void*>, unsigned int> shaderIds_;
+        std::map<const void*, unsigned int> textureIds_;
+        std::map<const void*, unsigned int> meshIds_;
+        std::map<std::array<const void*, 4>, unsigned int> batchIds_;
+        std::map<const mc::VertexShader*, InstancedShader> instancedShaders_;
+        // by packet of the render queue
+        std::vector<unsigned long long> batchKeys_;
+        std::vector<ObjectInstance> instances_;
+        std::vector<InstanceBatch> batches_;
+        std::unique_ptr<InstanceBuffer> instanceBuffer_;
+        unsigned int drawCount_{ 0 };
+        SceneCullStats nodeCullStats_{};
+        XMFLOAT3 lodViewPos_{ 0.0f, 0.0f, 0.0f };
+        float lodProjectionScale_{ 0.0f };
+        Frustum frustum_;
+        bool hasFrustum_{ false };
+        std::vector<IndexRange> visibleRanges_;
+        ClusterCullStats clusterCullStats_{};
     };
 }
 
@@ -1,127 +1,94 @@
 #include "Ship.h"
-#include "GeometryGenerator.h"
+#include "ShipPhysics.h"
+#include "ShipCollision.h"
 
-#include <utility>
-#include <iostream>
-#include <algorithm>
+#include <cmath>
 namespace mc
 {
     Ship::Ship(const XMFLOAT3& position, float mass, float radio)
-        : pos_(XMLoadFloat3(&position)), mass_(mass), radio_(radio)
+        : pos_(XMLoadFloat3(&position)), radio_(radio)
     {
+        tuning_.mass = mass;
         right_ = XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
         up_ = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
         front_ = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
         forward_ = front_;
-        worldUp_ = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
     }
 
-    void Ship::ProcessInput(const InputManager& im, float dt)
+    ShipPose ShipPose::Lerp(const ShipPose& a, const ShipPose& b, float t)
     {
-        float rotationSpeed = 6.0f;
-        if (im.KeyDown(mc::KEY_A))
-        {
-            yawVel_ -= rotationSpeed * dt;
-        }
-        if (im.KeyDown(mc::KEY_D))
-        {
-            yawVel_ += rotationSpeed * dt;
-        }
-        if (im.KeyDown(mc::KEY_W))
-        {
-            thrustMagnitude_ = std::min(thrustMagnitude_ + (100.0f*0.016f*dt), thrustMax_);
-        }
-        else
-        {
-            thrustMagnitude_ = std::max(thrustMagnitude_ - (200.0f*0.016f*dt), 0.0f);
-        }
+        ShipPose pose;
+        pose.position = XMVectorLerp(a.position, b.position, t);
+        pose.orientation = XMQuaternionSlerp(a.orientation, b.orientation, t);
+        pose.forward = XMVector3Normalize(XMVectorLerp(a.forward, b.forward, t));
+        return pose;
     }
 
-    void Ship::ProcessVelocities(float dt)
+    XMVECTOR ShipPose::Orientation(FXMVECTOR right, FXMVECTOR up, FXMVECTOR front)
     {
-        rollVel_ = yawVel_*-0.25f;
-        forward_ = XMVector3Normalize(XMVector3Rotate(forward_, XMQuaternionRotationAxis(worldUp_, yawVel_ * dt)));
-        XMVECTOR worldRight = XMVector3Cross(worldUp_, forward_);
-        front_ = XMVector3Rotate(front_, XMQuaternionRotationAxis(worldUp_, yawVel_ * dt));
-        right_ = XMVector3Rotate(worldRight, XMQuaternionRotationAxis(forward_, rollVel_));
-        up_ = XMVector3Normalize(XMVector3Cross(front_, right_));
-
-        thrust_ = forward_ * thrustMagnitude_;
-
-        XMVECTOR noseVel = forward_ * XMVector3Length(vel_);
-
-        XMVECTOR force = XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
-        force += thrust_;
-
-        acc_ = noseVel - vel_;
-        acc_ = force / mass_;
-
-        vel_ += acc_ * dt;
-        pos_ += vel_ * dt;
-
-        float damping = std::powf(damping_, dt);
-        vel_ *= damping;
-        yawVel_ *= damping;
-        rollVel_ *= damping;
+        XMFLOAT3 x, y, z;
+        XMStoreFloat3(&x, right);
+        XMStoreFloat3(&y, up);
+        XMStoreFloat3(&z, front);
+        XMMATRIX rotMat = XMMatrixSet(
+            x.x,  x.y,  x.z, 0.0f,
+            y.x,  y.y,  y.z, 0.0f,
+            z.x,  z.y,  z.z, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        );
+        return XMQuaternionMultiply(XMQuaternionRotationRollPitchYaw(0.0f, XM_PI, 0.0f),
+            XMQuaternionRotationMatrix(rotMat));
     }
 
-    void Ship::ProcessCollision(CollisionData* collisionData, float dt)
+    void Ship::ProcessInput(const ShipInput& input, float dt)
     {
-        for (size_t i = 0; i < collisionData->quads.size(); i++)
-        { 
-            const CollisionQuad& quad = collisionData->quads[i];
-            // TODO: store the collision quad directly using XMVECTOR
-            XMVECTOR a = XMLoadFloat3(&quad.vertices[0]);
-            XMVECTOR b = XMLoadFloat3(&quad.vertices[1]);
-            XMVECTOR c = XMLoadFloat3(&quad.vertices[2]);
-            XMVECTOR d = XMLoadFloat3(&quad.vertices[3]);
-            XMVECTOR n = XMLoadFloat3(&quad.normal);
-
-            float width = XMVectorGetX(XMVector3Length(b - a));
-            float height = XMVectorGetX(XMVector3Length(d - a));
+        ApplyShipInput(input, dt, tuning_, yawVel_, thrustMagnitude_);
+    }
 
-            // first we have to get a basis for this quad
-            XMVECTOR origin = XMVectorSet(quad.vertices[0].x, quad.vertices[0].y, quad.vertices[0].z, 1.0f) + (n * radio_);
-            XMVECTOR right = XMVector3Normalize(b - a);
-            XMVECTOR up = n;
-            XMVECTOR front = XMVector3Normalize(d - a);
-            XMMATRIX basisMatrix = XMMATRIX(right, up, front, origin);
+    void Ship::ProcessVelocities(float dt)
+    {
+        // same integration as ShipFleet, one ship in the float lane
+        XMFLOAT3 pos, vel, forward, front;
+        XMStoreFloat3(&pos, pos_);
+        XMStoreFloat3(&vel, vel_);
+        XMStoreFloat3(&forward, forward_);
+        XMStoreFloat3(&front, front_);
+        ShipMotion<float> motion{
+            pos.x, pos.y, pos.z,
+            vel.x, vel.y, vel.z,
+            forward.x, forward.y, forward.z,
+            front.x, front.y, front.z,
+            0.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 0.0f,
+            thrustMagnitude_, yawVel_ };
+        IntegrateShip(motion, dt, tuning_.mass, std::powf(tuning_.damping, dt));
+
+        pos_ = XMVectorSet(motion.posX, motion.posY, motion.posZ, 0.0f);
+        vel_ = XMVectorSet(motion.velX, motion.velY, motion.velZ, 0.0f);
+        forward_ = XMVectorSet(motion.forwardX, motion.forwardY, motion.forwardZ, 0.0f);
+        front_ = XMVectorSet(motion.frontX, motion.frontY, motion.frontZ, 0.0f);
+        right_ = XMVectorSet(motion.rightX, motion.rightY, motion.rightZ, 0.0f);
+        up_ = XMVectorSet(motion.upX, motion.upY, motion.upZ, 0.0f);
+        yawVel_ = motion.yawVel;
+    }
 
-            XMVECTOR relPos_ = XMVector3Transform(pos_, XMMatrixInverse(nullptr, basisMatrix));
-            XMFLOAT3 relPos;
-            XMStoreFloat3(&relPos, relPos_);
-            float penetration = relPos.y;
-            if (penetration <= 0) // posible collision
-            {
-                penetration = std::fabsf(penetration);
-                if (penetration > 1.0f)
-                {
-                    continue;
-                } 
-                XMVECTOR contactPoint_ = relPos_ + (XMVectorSet(0.0f, 1.0f, 0.0f, .0f) * penetration);;
-                XMFLOAT3 contactPoint;
-                XMStoreFloat3(&contactPoint, contactPoint_);
-                if (contactPoint.x >= 0 && contactPoint.x <= width)
-                {
-                    XMVECTOR worldContactPoint = XMVector3Transform(contactPoint_, basisMatrix);
-                    pos_ = worldContactPoint + n * 0.001f;
-                    vel_ = vel_ - n * XMVector3Dot(vel_, n);
-                }
-            }
-        }
+    void Ship::ProcessCollision(CollisionData* collisionDataArray[], unsigned int collisionDataCount, float dt)
+    {
+        ShipCollision::Body body{ pos_, vel_, prevPos_, radio_ };
+        ShipCollision::Resolve(body, dt, collisionMode_, collisionDataArray, collisionDataCount, collisionCandidates_);
+        pos_ = body.position;
+        vel_ = body.velocity;
     }
 
     void Ship::Update(
-        const InputManager& im, float dt,
+        const ShipInput& input, float dt,
         CollisionData* collisionDataArray[],
         unsigned int collisionDataCount)
     {
-        ProcessInput(im, dt);
+        prevPos_ = pos_;
+        ProcessInput(input, dt);
         ProcessVelocities(dt);
-        for (unsigned int i = 0; i < collisionDataCount; i++)
-        {
-            ProcessCollision(collisionDataArray[i], dt);
-        }
+        ProcessCollision(collisionDataArray, collisionDataCount, dt);
     }
 
     XMFLOAT3 Ship::GetPosition() const
@@ -130,20 +97,19 @@ namespace mc
         XMStoreFloat3(&position, pos_);
         return position;
     }
+    ShipPose Ship::GetPose() const
+    {
+        XMFLOAT3 position = GetPosition();
+        ShipPose pose;
+        pose.position = XMLoadFloat3(&position);
+        pose.orientation = GetOrientation();
+        pose.forward = forward_;
+        return pose;
+    }
+
     XMVECTOR Ship::GetOrientation() const
     {
-        XMFLOAT3 x, y, z;
-        XMStoreFloat3(&x, right_);
-        XMStoreFloat3(&y, up_);
-        XMStoreFloat3(&z, front_);
-        XMMATRIX rotMat = XMMatrixSet(
-            x.x,  x.y,  x.z, 0.0f,
-            y.x,  y.y,  y.z, 0.0f,
-            z.x,  z.y,  z.z, 0.0f,
-            0.0f, 0.0f, 0.0f, 1.0f
-        );
-        return XMQuaternionMultiply(XMQuaternionRotationRollPitchYaw(0.0f, XM_PI, 0.0f),
-            XMQuaternionRotationMatrix(rotMat));
+        return ShipPose::Orientation(right_, up_, front_);
     }
 
-}
\ No newline at end of file
+}
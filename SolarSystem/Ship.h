@@ -1,7 +1,7 @@
 #pragma once
 
 #include <DirectXMath.h>
-#include "InputManager.h"
+#include <vector>
 
 using namespace DirectX;
 
@@ -9,50 +9,94 @@ namespace mc
 {
     struct CollisionData;
 
+    // State of the ship controls for one physics step
+    struct ShipInput
+    {
+        bool left{ false };
+        bool right{ false };
+        bool thrust{ false };
+    };
+
+    // The numbers that set how a ship handles
+    struct ShipTuning
+    {
+        float mass{ 1.0f };
+        // fraction of the velocity and the yaw velocity left after one second
+        float damping{ 0.05f };
+        float thrustMax{ 6.4f };
+        // yaw acceleration while turning, in radians per second squared
+        float rotationSpeed{ 6.0f };
+    };
+
+    // What the scene and the camera need from the ship, so they can be drawn between two physics steps
+    struct ShipPose
+    {
+        XMVECTOR position;
+        XMVECTOR orientation;
+        XMVECTOR forward;
+
+        static ShipPose Lerp(const ShipPose& a, const ShipPose& b, float t);
+        // orientation of a ship with the given basis, the model faces -z so it is turned around
+        static XMVECTOR Orientation(FXMVECTOR right, FXMVECTOR up, FXMVECTOR front);
+    };
+
     class Ship
     {
     public:
+        enum class CollisionMode
+        {
+            // exact test against the quads near the ship
+            Quads,
+            // one sample of the baked distance field of every CollisionData, falls back to the quads without it
+            DistanceField
+        };
+
         Ship(const XMFLOAT3& position, float mass, float radio);
         void Update(
-            const InputManager& im, float dt,
+            const ShipInput& input, float dt,
             CollisionData* collisionDataArray[],
             unsigned int collisionDataCount);
         XMFLOAT3 GetPosition() const;
         XMVECTOR GetOrientation() const;
+        ShipPose GetPose() const;
         XMVECTOR GetForward() const { return forward_; }
         XMVECTOR GetFront() const { return front_; }
         XMVECTOR GetUp() const { return up_; }
         XMVECTOR GetRight() const { return right_; }
         XMVECTOR GetVelocity() const { return vel_; }
         float GetThrust() const { return thrustMagnitude_; }
-        float GetThrustMax() const { return thrustMax_; }
+        float GetThrustMax() const { return tuning_.thrustMax; }
+        const ShipTuning& GetTuning() const { return tuning_; }
+        void SetTuning(const ShipTuning& tuning) { tuning_ = tuning; }
+        CollisionMode GetCollisionMode() const { return collisionMode_; }
+        void SetCollisionMode(CollisionMode mode) { collisionMode_ = mode; }
 
     private:
-        void ProcessInput(const InputManager& im, float dt);
+        void ProcessInput(const ShipInput& input, float dt);
         void ProcessVelocities(float dt);
-        void ProcessCollision(CollisionData* collisionData, float dt);
+        void ProcessCollision(CollisionData* collisionDataArray[], unsigned int collisionDataCount, float dt);
 
         XMVECTOR pos_{};
+        // position at the start of the step, the collision sweeps the ship from it to pos_
+        XMVECTOR prevPos_{};
         XMVECTOR vel_{};
-        XMVECTOR acc_{};
-
-        XMVECTOR thrust_{};
-        float damping_{ 0.05f };
 
         XMVECTOR right_{};
         XMVECTOR up_{};
         XMVECTOR front_{};
 
         XMVECTOR forward_{};
-        XMVECTOR worldUp_{};
 
-        float mass_{};
+        ShipTuning tuning_{};
         float radio_{};
         float thrustMagnitude_{ 0.0f };
-        float thrustMax_{ 6.4f };
 
         float yawVel_{};
-        float rollVel_{};
+
+        CollisionMode collisionMode_{ CollisionMode::Quads };
+
+        // scratch for the collision queries
+        std::vector<unsigned int> collisionCandidates_;
     };
 }
 
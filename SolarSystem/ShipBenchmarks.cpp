@@ -0,0 +1,232 @@
+#include "ShipBenchmarks.h"
+#include "InputLog.h"
+#include "LapTracker.h"
+#include "Ship.h"
+#include "ShipFleet.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace mc
+{
+    namespace
+    {
+        // not a multiple of four, so the padding lanes of the fleet are used
+        const unsigned int parityShipCount = 37;
+        const unsigned int parityStepRate = 120;
+        const unsigned int paritySteps = 20 * parityStepRate;
+        // every ship changes its keys at random every this many steps
+        const unsigned int parityInputSteps = 30;
+        // the fleet integrates four ships with the same operations as Ship, the results should be the same bits
+        const float parityEpsilon = 1e-5f;
+
+        // the ship of the game, its physics rate and the most steps it runs in one frame
+        const XMFLOAT3 gameStart(-2.5f, 0.0125f, 0.0f);
+        const float gameMass = 2.0f;
+        const unsigned int gameStepRate = 120;
+        const unsigned int gameMaxFrameSteps = 8;
+        // frames from 500 down to 15 fps, for long enough to do a few laps
+        const double minFrameTime = 1.0 / 500.0;
+        const double maxFrameTime = 1.0 / 15.0;
+        const unsigned int replaySteps = 90 * gameStepRate;
+
+        float Difference(FXMVECTOR a, FXMVECTOR b)
+        {
+            return XMVectorGetX(XMVector3Length(a - b));
+        }
+
+        // Keys that turn the ship along the circle around the center of the track in the race direction with the
+        // thrust held, the rails keep it on the track
+        ShipInput Autopilot(const XMFLOAT3& position, FXMVECTOR forward)
+        {
+            XMVECTOR direction = XMVector3Normalize(XMVectorSet(position.z, 0.0f, -position.x, 0.0f));
+            float turn = XMVectorGetY(XMVector3Cross(forward, direction));
+            ShipInput input;
+            input.thrust = true;
+            input.left = turn < -0.05f;
+            input.right = turn > 0.05f;
+            return input;
+        }
+
+        bool SamePosition(const XMFLOAT3& a, const XMFLOAT3& b)
+        {
+            return a.x == b.x && a.y == b.y && a.z == b.z;
+        }
+    }
+
+// PUBLICS:
+    bool ShipBenchmarks::FleetParity(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+        float radius)
+    {
+        const float dt = 1.0f / parityStepRate;
+
+        bool passed = true;
+        for (Ship::CollisionMode mode : { Ship::CollisionMode::Quads, Ship::CollisionMode::DistanceField })
+        {
+            // every ship handles differently, around the tuning of the game
+            std::mt19937 random(1);
+            std::uniform_real_distribution<float> spread(0.75f, 1.25f);
+            ShipTuning fleetTuning;
+            fleetTuning.mass = 2.0f;
+            ShipFleet fleet(fleetTuning.mass, radius);
+            fleet.SetTuning(fleetTuning);
+            fleet.SetCollisionMode(mode);
+            std::vector<Ship> ships;
+            ships.reserve(parityShipCount);
+            for (unsigned int i = 0; i < parityShipCount; i++)
+            {
+                XMFLOAT3 start;
+                XMStoreFloat3(&start, track.GetPoint(track.GetLength() * i / parityShipCount));
+                start.y = 0.0125f;
+                ShipTuning tuning = fleetTuning;
+                tuning.mass *= spread(random);
+                tuning.damping *= spread(random);
+                tuning.thrustMax *= spread(random);
+                tuning.rotationSpeed *= spread(random);
+
+                fleet.SetTuning(fleet.AddShip(start), tuning);
+                ships.emplace_back(start, tuning.mass, radius);
+                ships.back().SetTuning(tuning);
+                ships.back().SetCollisionMode(mode);
+            }
+
+            std::vector<ShipInput> inputs(parityShipCount);
+            float maxPositionDifference = 0.0f;
+            float maxVelocityDifference = 0.0f;
+            float maxForwardDifference = 0.0f;
+            double fleetTime = 0.0;
+            double shipTime = 0.0;
+            for (unsigned int step = 0; step < paritySteps; step++)
+            {
+                if (step % parityInputSteps == 0)
+                {
+                    for (ShipInput& input : inputs)
+                    {
+                        unsigned int keys = random();
+                        input.left = (keys & 1) != 0;
+                        input.right = (keys & 2) != 0;
+                        input.thrust = (keys & 12) != 0;
+                    }
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                fleet.Update(inputs.data(), dt, collisionDataArray, collisionDataCount);
+                auto middle = std::chrono::steady_clock::now();
+                for (unsigned int i = 0; i < parityShipCount; i++)
+                {
+                    ships[i].Update(inputs[i], dt, collisionDataArray, collisionDataCount);
+                }
+                auto end = std::chrono::steady_clock::now();
+                fleetTime += std::chrono::duration<double>(middle - start).count();
+                shipTime += std::chrono::duration<double>(end - middle).count();
+
+                for (unsigned int i = 0; i < parityShipCount; i++)
+                {
+                    XMFLOAT3 fleetPosition = fleet.GetPosition(i);
+                    XMFLOAT3 shipPosition = ships[i].GetPosition();
+                    maxPositionDifference = std::max(maxPositionDifference,
+                        Difference(XMLoadFloat3(&fleetPosition), XMLoadFloat3(&shipPosition)));
+                    maxVelocityDifference = std::max(maxVelocityDifference, Difference(fleet.GetVelocity(i), ships[i].GetVelocity()));
+                    maxForwardDifference = std::max(maxForwardDifference, Difference(fleet.GetPose(i).forward, ships[i].GetForward()));
+                }
+            }
+
+            bool same = maxPositionDifference <= parityEpsilon && maxVelocityDifference <= parityEpsilon &&
+                maxForwardDifference <= parityEpsilon;
+            std::cout << (mode == Ship::CollisionMode::Quads ? "Quads" : "Distance field") << ": " << parityShipCount << " ships for "
+                << paritySteps << " steps, fleet " << fleetTime * 1e3 << " ms, ships " << shipTime * 1e3 << " ms, largest difference position "
+                << maxPositionDifference << " velocity " << maxVelocityDifference << " forward " << maxForwardDifference << ", "
+                << (same ? "same as Ship" : "DIFFERENT FROM SHIP") << "\n";
+            passed = passed && same;
+        }
+        return passed;
+    }
+
+    bool ShipBenchmarks::ReplayParity(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+        float radius)
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<double> frameTime(minFrameTime, maxFrameTime);
+
+        // the game: the ship in its default collision mode, the keys read once per frame and all the steps that fit
+        // in the frame, the time past gameMaxFrameSteps dropped
+        Ship ship(gameStart, gameMass, radius);
+        LapTracker lapTracker(track);
+        InputLog log(gameStepRate);
+        std::vector<XMFLOAT3> positions;
+        std::vector<double> lapTimes;
+        const double step = 1.0 / gameStepRate;
+        double physicsTime = 0.0;
+        unsigned int frameCount = 0;
+        while (positions.size() < replaySteps)
+        {
+            const ShipInput input = Autopilot(ship.GetPosition(), ship.GetForward());
+            physicsTime += frameTime(random);
+            unsigned int steps = 0;
+            while (physicsTime >= step && steps < gameMaxFrameSteps)
+            {
+                log.Record(input);
+                ship.Update(input, static_cast<float>(step), collisionDataArray, collisionDataCount);
+                positions.push_back(ship.GetPosition());
+                if (lapTracker.Update(ship.GetPosition(), static_cast<float>(step)) == LapTracker::Event::LapCompleted)
+                {
+                    lapTimes.push_back(lapTracker.GetLastLapTime());
+                }
+                physicsTime -= step;
+                steps++;
+            }
+            if (steps == gameMaxFrameSteps)
+            {
+                physicsTime = std::min(physicsTime, step);
+            }
+            ++frameCount;
+        }
+
+        std::filesystem::path path = std::filesystem::temp_directory_path() / "SolarSystemSimReplay.input";
+        log.Save(path.string());
+        InputLog replay(path.string());
+        std::filesystem::remove(path);
+
+        // SolarSystemSim: one ship of a fleet with the tuning of the game, one step per step of the log
+        ShipTuning tuning;
+        tuning.mass = gameMass;
+        ShipFleet fleet(tuning.mass, radius);
+        fleet.SetCollisionMode(Ship::CollisionMode::Quads);
+        fleet.SetTuning(fleet.AddShip(gameStart), tuning);
+        LapTracker replayLapTracker(track);
+        const float dt = static_cast<float>(1.0 / replay.GetStepRate());
+        size_t replayed = 0;
+        size_t mismatches = 0;
+        std::vector<double> replayLapTimes;
+        for (ShipInput input; replay.Next(input); replayed++)
+        {
+            fleet.Update(&input, dt, collisionDataArray, collisionDataCount);
+            XMFLOAT3 position = fleet.GetPosition(0);
+            mismatches += replayed < positions.size() && SamePosition(position, positions[replayed]) ? 0 : 1;
+            if (replayLapTracker.Update(position, dt) == LapTracker::Event::LapCompleted)
+            {
+                replayLapTimes.push_back(replayLapTracker.GetLastLapTime());
+            }
+        }
+
+        bool same = replayed == positions.size() && mismatches == 0 && replayLapTimes == lapTimes;
+        std::cout << positions.size() << " steps in " << frameCount << " frames, " << lapTimes.size() << " laps:";
+        for (double lapTime : lapTimes)
+        {
+            std::cout << " " << lapTime;
+        }
+        std::cout << ", replayed " << replayed << " steps with " << replayLapTimes.size() << " laps, "
+            << (same ? "same positions and lap times" : "DIFFERENT FROM THE GAME");
+        if (mismatches != 0)
+        {
+            std::cout << ": " << mismatches << " positions";
+        }
+        std::cout << "\n";
+        return same;
+    }
+}
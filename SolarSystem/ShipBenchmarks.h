@@ -0,0 +1,23 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+#include "TrackSpline.h"
+
+namespace mc
+{
+    // Headless checks of the ship physics, run by SolarSystemSim on the rails of the game with the radius of its
+    // ship, with the same arguments as CollisionBenchmarks. They return false when their check fails.
+    class ShipBenchmarks
+    {
+    public:
+        // Drives ships of the given radius and of different tunings around the track with random keys as one ShipFleet
+        // and as one Ship each, in both collision modes, and checks that every ship of the fleet stays where its Ship is
+        static bool FleetParity(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            float radius);
+        // Drives the ship of the game around the track the way Game::UpdatePhysics does, steps of a fixed rate in frames
+        // of random length with the keys read once per frame, and records its inputs. The log is saved, loaded and
+        // replayed the way SolarSystemSim does it, the ship must go through the same positions and do the same laps.
+        static bool ReplayParity(const TrackSpline& track, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            float radius);
+    };
+}
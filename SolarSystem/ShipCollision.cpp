@@ -0,0 +1,136 @@
+#include "ShipCollision.h"
+#include "CollisionBVH.h"
+#include "CollisionSDF.h"
+#include "CollisionKernel.h"
+#include "CollisionSweep.h"
+
+namespace mc
+{
+// PUBLICS:
+    void ShipCollision::Resolve(Body& body, float dt, Ship::CollisionMode mode,
+        CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+        std::vector<unsigned int>& candidates)
+    {
+        ResolveSwept(body, collisionDataArray, collisionDataCount, candidates);
+        for (unsigned int i = 0; i < collisionDataCount; i++)
+        {
+            const CollisionData& collisionData = *collisionDataArray[i];
+            if (mode == Ship::CollisionMode::DistanceField && !collisionData.distanceField.bricks.empty())
+            {
+                ResolveDistanceField(body, collisionData);
+            }
+            else
+            {
+                ResolveQuads(body, collisionData, dt, candidates);
+            }
+        }
+    }
+
+// PRIVATES:
+    void ShipCollision::ResolveSwept(Body& body, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+        std::vector<unsigned int>& candidates)
+    {
+        // a fast ship or a long step can take the ship past a rail before the contact tests see it, so the ship is
+        // swept from where the step started and stopped at the first rail it crosses. The rest of the motion slides
+        // along the rail and is swept again, if it still hits a rail after the last sweep the ship stays at the contact
+        const int maxSweeps = 4;
+        XMVECTOR from = body.previousPosition;
+        for (int i = 0; i < maxSweeps; i++)
+        {
+            XMVECTOR motion = body.position - from;
+            float travel = XMVectorGetX(XMVector3Length(motion));
+            if (travel <= 0.0f)
+            {
+                return;
+            }
+
+            const CollisionQuadBasis* hitQuad = nullptr;
+            float firstToi = 1.0f;
+            for (unsigned int c = 0; c < collisionDataCount; c++)
+            {
+                const CollisionData& collisionData = *collisionDataArray[c];
+                CollisionBVH::QuerySphere(collisionData, from + motion * 0.5f, body.radius + travel * 0.5f, candidates);
+                float toi;
+                unsigned int quad;
+                if (CollisionSweep::SweepSphere(collisionData, candidates, from, body.position, body.radius, toi, quad) &&
+                    (hitQuad == nullptr || toi < firstToi))
+                {
+                    hitQuad = &collisionData.bases[quad];
+                    firstToi = toi;
+                }
+            }
+            if (hitQuad == nullptr)
+            {
+                return;
+            }
+
+            XMVECTOR contact = from + motion * firstToi;
+            XMVECTOR remaining = body.position - contact;
+            remaining = remaining - hitQuad->up * XMVector3Dot(remaining, hitQuad->up);
+            from = contact + hitQuad->up * 0.001f;
+            body.position = i + 1 < maxSweeps ? from + remaining : from;
+            body.velocity = body.velocity - hitQuad->up * XMVector3Dot(body.velocity, hitQuad->up);
+        }
+    }
+
+    void ShipCollision::ResolveQuads(Body& body, const CollisionData& collisionData, float dt,
+        std::vector<unsigned int>& candidates)
+    {
+        // only the quads near the ship or near where it moved this frame can push it
+        float queryRadius = body.radius + XMVectorGetX(XMVector3Length(body.velocity)) * dt;
+        CollisionBVH::QuerySphere(collisionData, body.position, queryRadius, candidates);
+
+        // the candidates are sorted, so the ones in the same block are tested together. Contacts are applied
+        // in quad order and the rest of the block is tested again from the new position, like one quad at a time
+        size_t candidateCount = candidates.size();
+        size_t i = 0;
+        while (i < candidateCount)
+        {
+            unsigned int block = candidates[i] / CollisionKernel::blockSize;
+            unsigned int lanes = 0;
+            for (; i < candidateCount && candidates[i] / CollisionKernel::blockSize == block; i++)
+            {
+                lanes |= 1u << (candidates[i] % CollisionKernel::blockSize);
+            }
+            while (lanes != 0)
+            {
+                unsigned int hits = CollisionKernel::TestBlock(collisionData.quadBlocks[block], body.position, body.radius) & lanes;
+                if (hits == 0)
+                {
+                    break;
+                }
+                unsigned int lane = CollisionKernel::FirstLane(hits);
+                ApplyQuadContact(body, collisionData.bases[block * CollisionKernel::blockSize + lane]);
+                lanes &= ~((2u << lane) - 1u);
+            }
+        }
+    }
+
+    void ShipCollision::ResolveDistanceField(Body& body, const CollisionData& collisionData)
+    {
+        float distance;
+        XMVECTOR normal;
+        if (!CollisionSDF::Sample(collisionData.distanceField, body.position, distance, normal))
+        {
+            return;
+        }
+        // same response as the quads, the gradient takes the place of the normal of the closest quad
+        float penetration = distance - body.radius;
+        if (penetration <= 0)
+        {
+            body.position += normal * (0.001f - penetration);
+            body.velocity = body.velocity - normal * XMVector3Dot(body.velocity, normal);
+        }
+    }
+
+    void ShipCollision::ApplyQuadContact(Body& body, const CollisionQuadBasis& quad)
+    {
+        // contact point on the quad, moved up by the radius of the ship
+        XMVECTOR relPos = body.position - quad.origin;
+        float x = XMVectorGetX(XMVector3Dot(relPos, quad.inverseRight));
+        float z = XMVectorGetX(XMVector3Dot(relPos, quad.inverseFront));
+        XMVECTOR worldContactPoint = quad.origin + quad.up * body.radius + quad.right * x + quad.front * z;
+        body.position = worldContactPoint + quad.up * 0.001f;
+        body.velocity = body.velocity - quad.up * XMVector3Dot(body.velocity, quad.up);
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+#include "Ship.h"
+
+#include <vector>
+
+namespace mc
+{
+    class ShipCollision
+    {
+    public:
+        // What the collision of one ship reads and moves
+        struct Body
+        {
+            XMVECTOR position;
+            XMVECTOR velocity;
+            // position at the start of the step, the body is swept from it to position
+            XMVECTOR previousPosition;
+            float radius;
+        };
+
+        // Sweeps the body against all the collision datas and pushes it out of the rails it touches.
+        // Used by Ship and by every ship of a ShipFleet, candidates is scratch for the queries.
+        static void Resolve(Body& body, float dt, Ship::CollisionMode mode,
+            CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            std::vector<unsigned int>& candidates);
+
+    private:
+        static void ResolveSwept(Body& body, CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            std::vector<unsigned int>& candidates);
+        static void ResolveQuads(Body& body, const CollisionData& collisionData, float dt,
+            std::vector<unsigned int>& candidates);
+        static void ResolveDistanceField(Body& body, const CollisionData& collisionData);
+        static void ApplyQuadContact(Body& body, const CollisionQuadBasis& quad);
+    };
+}
@@ -0,0 +1,200 @@
+#include "ShipFleet.h"
+#include "ShipCollision.h"
+#include "ThreadPool.h"
+
+#include <cmath>
+
+namespace mc
+{
+    namespace
+    {
+        const unsigned int laneCount = 4;
+        // ships per collision job, enough to pay for the dispatch
+        const unsigned int collisionChunkSize = 16;
+
+        // calls function once for every pair of matching fields
+        template <typename A, typename B, typename Function>
+        void ForEachField(ShipMotion<A>& a, ShipMotion<B>& b, Function function)
+        {
+            function(a.posX, b.posX);
+            function(a.posY, b.posY);
+            function(a.posZ, b.posZ);
+            function(a.velX, b.velX);
+            function(a.velY, b.velY);
+            function(a.velZ, b.velZ);
+            function(a.forwardX, b.forwardX);
+            function(a.forwardY, b.forwardY);
+            function(a.forwardZ, b.forwardZ);
+            function(a.frontX, b.frontX);
+            function(a.frontY, b.frontY);
+            function(a.frontZ, b.frontZ);
+            function(a.rightX, b.rightX);
+            function(a.rightY, b.rightY);
+            function(a.rightZ, b.rightZ);
+            function(a.upX, b.upX);
+            function(a.upY, b.upY);
+            function(a.upZ, b.upZ);
+            function(a.thrust, b.thrust);
+            function(a.yawVel, b.yawVel);
+        }
+    }
+
+// PUBLICS:
+    ShipFleet::ShipFleet(float mass, float radio)
+        : radio_(radio)
+    {
+        tuning_.mass = mass;
+    }
+
+    unsigned int ShipFleet::AddShip(const XMFLOAT3& position)
+    {
+        unsigned int ship = shipCount_++;
+        if (ship % laneCount == 0)
+        {
+            // a new group of four, filled with ships at rest facing +z like a new Ship
+            ShipMotion<float> rest{
+                0.0f, 0.0f, 0.0f,
+                0.0f, 0.0f, 0.0f,
+                0.0f, 0.0f, 1.0f,
+                0.0f, 0.0f, 1.0f,
+                1.0f, 0.0f, 0.0f,
+                0.0f, 1.0f, 0.0f,
+                0.0f, 0.0f };
+            ForEachField(motion_, rest, [](std::vector<float>& field, float value)
+            {
+                field.resize(field.size() + laneCount, value);
+            });
+            prevPosX_.resize(prevPosX_.size() + laneCount, 0.0f);
+            prevPosY_.resize(prevPosY_.size() + laneCount, 0.0f);
+            prevPosZ_.resize(prevPosZ_.size() + laneCount, 0.0f);
+            mass_.resize(mass_.size() + laneCount, 1.0f);
+            damping_.resize(damping_.size() + laneCount, 1.0f);
+            stepDamping_.resize(stepDamping_.size() + laneCount, 1.0f);
+        }
+        motion_.posX[ship] = position.x;
+        motion_.posY[ship] = position.y;
+        motion_.posZ[ship] = position.z;
+        tunings_.push_back(tuning_);
+        SetTuning(ship, tuning_);
+        return ship;
+    }
+
+    void ShipFleet::SetTuning(const ShipTuning& tuning)
+    {
+        tuning_ = tuning;
+        for (unsigned int i = 0; i < shipCount_; i++)
+        {
+            SetTuning(i, tuning);
+        }
+    }
+
+    void ShipFleet::SetTuning(unsigned int ship, const ShipTuning& tuning)
+    {
+        tunings_[ship] = tuning;
+        mass_[ship] = tuning.mass;
+        damping_[ship] = tuning.damping;
+    }
+
+    void ShipFleet::Update(
+        const ShipInput* inputs, float dt,
+        CollisionData* collisionDataArray[],
+        unsigned int collisionDataCount)
+    {
+        prevPosX_ = motion_.posX;
+        prevPosY_ = motion_.posY;
+        prevPosZ_ = motion_.posZ;
+        ProcessInput(inputs, dt);
+        ProcessVelocities(dt);
+        ProcessCollision(collisionDataArray, collisionDataCount, dt);
+    }
+
+    XMFLOAT3 ShipFleet::GetPosition(unsigned int ship) const
+    {
+        return XMFLOAT3(motion_.posX[ship], motion_.posY[ship], motion_.posZ[ship]);
+    }
+
+    XMVECTOR ShipFleet::GetVelocity(unsigned int ship) const
+    {
+        return XMVectorSet(motion_.velX[ship], motion_.velY[ship], motion_.velZ[ship], 0.0f);
+    }
+
+    ShipPose ShipFleet::GetPose(unsigned int ship) const
+    {
+        ShipPose pose;
+        pose.position = XMVectorSet(motion_.posX[ship], motion_.posY[ship], motion_.posZ[ship], 0.0f);
+        pose.orientation = ShipPose::Orientation(
+            XMVectorSet(motion_.rightX[ship], motion_.rightY[ship], motion_.rightZ[ship], 0.0f),
+            XMVectorSet(motion_.upX[ship], motion_.upY[ship], motion_.upZ[ship], 0.0f),
+            XMVectorSet(motion_.frontX[ship], motion_.frontY[ship], motion_.frontZ[ship], 0.0f));
+        pose.forward = XMVectorSet(motion_.forwardX[ship], motion_.forwardY[ship], motion_.forwardZ[ship], 0.0f);
+        return pose;
+    }
+
+// PRIVATES:
+    void ShipFleet::ProcessInput(const ShipInput* inputs, float dt)
+    {
+        for (unsigned int i = 0; i < shipCount_; i++)
+        {
+            ApplyShipInput(inputs[i], dt, tunings_[i], motion_.yawVel[i], motion_.thrust[i]);
+        }
+    }
+
+    void ShipFleet::ProcessVelocities(float dt)
+    {
+        // the same pow as Ship, once per ship
+        for (unsigned int i = 0; i < shipCount_; i++)
+        {
+            stepDamping_[i] = std::powf(damping_[i], dt);
+        }
+        size_t paddedCount = motion_.posX.size();
+        for (size_t i = 0; i < paddedCount; i += laneCount)
+        {
+            ShipMotion<FloatX4> lanes;
+            ForEachField(lanes, motion_, [i](FloatX4& lane, std::vector<float>& field)
+            {
+                lane = _mm_loadu_ps(field.data() + i);
+            });
+            IntegrateShip(lanes, dt, FloatX4(_mm_loadu_ps(mass_.data() + i)), FloatX4(_mm_loadu_ps(stepDamping_.data() + i)));
+            ForEachField(lanes, motion_, [i](FloatX4& lane, std::vector<float>& field)
+            {
+                _mm_storeu_ps(field.data() + i, lane.v);
+            });
+        }
+    }
+
+    void ShipFleet::ProcessCollision(CollisionData* collisionDataArray[], unsigned int collisionDataCount, float dt)
+    {
+        // the ships only read the collision datas and write their own slots, so the chunks need no locking
+        size_t chunkCount = (shipCount_ + collisionChunkSize - 1) / collisionChunkSize;
+        if (collisionCandidates_.size() < chunkCount)
+        {
+            collisionCandidates_.resize(chunkCount);
+        }
+        ThreadPool::Get().ParallelFor(chunkCount, [&](size_t chunk)
+        {
+            std::vector<unsigned int>& candidates = collisionCandidates_[chunk];
+            unsigned int first = static_cast<unsigned int>(chunk) * collisionChunkSize;
+            unsigned int last = std::min(first + collisionChunkSize, shipCount_);
+            for (unsigned int i = first; i < last; i++)
+            {
+                ShipCollision::Body body{
+                    XMVectorSet(motion_.posX[i], motion_.posY[i], motion_.posZ[i], 0.0f),
+                    XMVectorSet(motion_.velX[i], motion_.velY[i], motion_.velZ[i], 0.0f),
+                    XMVectorSet(prevPosX_[i], prevPosY_[i], prevPosZ_[i], 0.0f),
+                    radio_ };
+                ShipCollision::Resolve(body, dt, collisionMode_, collisionDataArray, collisionDataCount, candidates);
+
+                XMFLOAT3 position;
+                XMFLOAT3 velocity;
+                XMStoreFloat3(&position, body.position);
+                XMStoreFloat3(&velocity, body.velocity);
+                motion_.posX[i] = position.x;
+                motion_.posY[i] = position.y;
+                motion_.posZ[i] = position.z;
+                motion_.velX[i] = velocity.x;
+                motion_.velY[i] = velocity.y;
+                motion_.velZ[i] = velocity.z;
+            }
+        });
+    }
+}
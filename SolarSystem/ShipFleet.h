@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Ship.h"
+#include "ShipPhysics.h"
+
+#include <vector>
+
+namespace mc
+{
+    // Many ships with the same radius stepped together. The state is kept one array per field so the
+    // motion of four ships is integrated at a time, and the collision is split across the thread pool.
+    // Every ship moves exactly like a Ship with its tuning given the same inputs.
+    class ShipFleet
+    {
+    public:
+        ShipFleet(float mass, float radio);
+        // returns the index of the new ship, it gets the tuning of the fleet
+        unsigned int AddShip(const XMFLOAT3& position);
+        // inputs holds one entry per ship
+        void Update(
+            const ShipInput* inputs, float dt,
+            CollisionData* collisionDataArray[],
+            unsigned int collisionDataCount);
+
+        unsigned int GetShipCount() const { return shipCount_; }
+        XMFLOAT3 GetPosition(unsigned int ship) const;
+        XMVECTOR GetVelocity(unsigned int ship) const;
+        ShipPose GetPose(unsigned int ship) const;
+        float GetThrust(unsigned int ship) const { return motion_.thrust[ship]; }
+        // the tuning of the fleet, given to the ships added after
+        const ShipTuning& GetTuning() const { return tuning_; }
+        // sets the tuning of the fleet and of all its ships
+        void SetTuning(const ShipTuning& tuning);
+        const ShipTuning& GetTuning(unsigned int ship) const { return tunings_[ship]; }
+        void SetTuning(unsigned int ship, const ShipTuning& tuning);
+        Ship::CollisionMode GetCollisionMode() const { return collisionMode_; }
+        void SetCollisionMode(Ship::CollisionMode mode) { collisionMode_ = mode; }
+
+    private:
+        void ProcessInput(const ShipInput* inputs, float dt);
+        void ProcessVelocities(float dt);
+        void ProcessCollision(CollisionData* collisionDataArray[], unsigned int collisionDataCount, float dt);
+
+        // the arrays are padded to a multiple of four with still ships that are never read back
+        ShipMotion<std::vector<float>> motion_;
+        std::vector<float> prevPosX_;
+        std::vector<float> prevPosY_;
+        std::vector<float> prevPosZ_;
+        unsigned int shipCount_{ 0 };
+
+        ShipTuning tuning_{};
+        std::vector<ShipTuning> tunings_;
+        // the mass and the damping per second of every ship padded like the motion, the padding ships have 1
+        std::vector<float> mass_;
+        std::vector<float> damping_;
+        // damping_ for the dt of the step
+        std::vector<float> stepDamping_;
+        float radio_{};
+
+        Ship::CollisionMode collisionMode_{ Ship::CollisionMode::Quads };
+
+        // scratch for the collision queries, one per collision job
+        std::vector<std::vector<unsigned int>> collisionCandidates_;
+    };
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "Ship.h"
+
+#include <cmath>
+#include <algorithm>
+#include <emmintrin.h>
+
+namespace mc
+{
+    // Four floats in one SSE register, the lane type of ShipFleet. The operators are the plain SSE
+    // instructions, so every lane gives the same bits as the same operation done on a float.
+    struct FloatX4
+    {
+        __m128 v;
+
+        FloatX4() = default;
+        FloatX4(__m128 value) : v(value) {}
+        FloatX4(float value) : v(_mm_set1_ps(value)) {}
+    };
+
+    inline FloatX4 operator+(FloatX4 a, FloatX4 b) { return _mm_add_ps(a.v, b.v); }
+    inline FloatX4 operator-(FloatX4 a, FloatX4 b) { return _mm_sub_ps(a.v, b.v); }
+    inline FloatX4 operator*(FloatX4 a, FloatX4 b) { return _mm_mul_ps(a.v, b.v); }
+    inline FloatX4 operator/(FloatX4 a, FloatX4 b) { return _mm_div_ps(a.v, b.v); }
+    inline FloatX4 operator-(FloatX4 a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+    inline FloatX4 Sqrt(FloatX4 a) { return _mm_sqrt_ps(a.v); }
+    // round to the nearest integer, ties to even like std::nearbyint with the default rounding mode
+    inline FloatX4 Round(FloatX4 a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)); }
+    inline FloatX4 SelectGreater(FloatX4 a, FloatX4 b, FloatX4 ifGreater, FloatX4 otherwise)
+    {
+        __m128 mask = _mm_cmpgt_ps(a.v, b.v);
+        return _mm_or_ps(_mm_and_ps(mask, ifGreater.v), _mm_andnot_ps(mask, otherwise.v));
+    }
+
+    inline float Sqrt(float a) { return std::sqrt(a); }
+    inline float Round(float a) { return std::nearbyint(a); }
+    inline float SelectGreater(float a, float b, float ifGreater, float otherwise) { return a > b ? ifGreater : otherwise; }
+
+    // Polynomial sine and cosine with the same coefficients as XMScalarSinCos, written once for float and FloatX4
+    template <typename T>
+    void ShipSinCos(T angle, T& sine, T& cosine)
+    {
+        const float pi = 3.141592654f;
+        const float twoPi = 6.283185307f;
+        const float halfPi = 1.570796327f;
+
+        // map the angle to [-pi, pi] and then to [-pi/2, pi/2], where the cosine changes its sign
+        T quotient = Round(angle * (1.0f / twoPi));
+        T x = angle - quotient * twoPi;
+        T sign = 1.0f;
+        sign = SelectGreater(x, halfPi, -1.0f, sign);
+        x = SelectGreater(x, halfPi, T(pi) - x, x);
+        sign = SelectGreater(-halfPi, x, -1.0f, sign);
+        x = SelectGreater(-halfPi, x, T(-pi) - x, x);
+
+        T x2 = x * x;
+        sine = (((((T(-2.3889859e-08f) * x2 + 2.7525562e-06f) * x2 - 0.00019840874f) * x2 + 0.0083333310f) * x2 - 0.16666667f) * x2 + 1.0f) * x;
+        cosine = (((((T(-2.6051615e-07f) * x2 + 2.4760495e-05f) * x2 - 0.0013888378f) * x2 + 0.041666638f) * x2 - 0.5f) * x2 + 1.0f) * sign;
+    }
+
+    // Motion state of ships, one lane per ship. Ship uses it with float and ShipFleet with FloatX4
+    // for four ships at a time, both through IntegrateShip so they move the same bit for bit.
+    template <typename T>
+    struct ShipMotion
+    {
+        T posX, posY, posZ;
+        T velX, velY, velZ;
+        T forwardX, forwardY, forwardZ;
+        T frontX, frontY, frontZ;
+        T rightX, rightY, rightZ;
+        T upX, upY, upZ;
+        T thrust;
+        T yawVel;
+    };
+
+    // Turning and thrust from the controls, the same for Ship and every ship of a ShipFleet
+    inline void ApplyShipInput(const ShipInput& input, float dt, const ShipTuning& tuning, float& yawVel, float& thrust)
+    {
+        if (input.left)
+        {
+            yawVel -= tuning.rotationSpeed * dt;
+        }
+        if (input.right)
+        {
+            yawVel += tuning.rotationSpeed * dt;
+        }
+        if (input.thrust)
+        {
+            thrust = std::min(thrust + (100.0f*0.016f*dt), tuning.thrustMax);
+        }
+        else
+        {
+            thrust = std::max(thrust - (200.0f*0.016f*dt), 0.0f);
+        }
+    }
+
+    // One step of the ship motion: yaw around the world up axis, roll around forward by the yaw velocity,
+    // thrust along forward and the damping. damping is pow(damping per second, dt), mass and damping are
+    // per lane so every ship of a fleet can have its own tuning.
+    template <typename T>
+    void IntegrateShip(ShipMotion<T>& s, float dt, T mass, T damping)
+    {
+        T rollVel = s.yawVel * -0.25f;
+
+        T yawSin;
+        T yawCos;
+        ShipSinCos(s.yawVel * dt, yawSin, yawCos);
+        T forwardX = s.forwardX * yawCos + s.forwardZ * yawSin;
+        T forwardY = s.forwardY;
+        T forwardZ = s.forwardZ * yawCos - s.forwardX * yawSin;
+        T forwardLength = Sqrt((forwardX * forwardX + forwardY * forwardY) + forwardZ * forwardZ);
+        s.forwardX = forwardX / forwardLength;
+        s.forwardY = forwardY / forwardLength;
+        s.forwardZ = forwardZ / forwardLength;
+
+        T frontX = s.frontX * yawCos + s.frontZ * yawSin;
+        T frontZ = s.frontZ * yawCos - s.frontX * yawSin;
+        s.frontX = frontX;
+        s.frontZ = frontZ;
+
+        // the world right is cross(world up, forward), it is perpendicular to forward so the roll is
+        // right = worldRight * cos + cross(forward, worldRight) * sin
+        T rollSin;
+        T rollCos;
+        ShipSinCos(rollVel, rollSin, rollCos);
+        T worldRightX = s.forwardZ;
+        T worldRightZ = -s.forwardX;
+        s.rightX = worldRightX * rollCos - (s.forwardY * s.forwardX) * rollSin;
+        s.rightY = (s.forwardZ * s.forwardZ + s.forwardX * s.forwardX) * rollSin;
+        s.rightZ = worldRightZ * rollCos - (s.forwardY * s.forwardZ) * rollSin;
+
+        T upX = s.frontY * s.rightZ - s.frontZ * s.rightY;
+        T upY = s.frontZ * s.rightX - s.frontX * s.rightZ;
+        T upZ = s.frontX * s.rightY - s.frontY * s.rightX;
+        T upLength = Sqrt((upX * upX + upY * upY) + upZ * upZ);
+        s.upX = upX / upLength;
+        s.upY = upY / upLength;
+        s.upZ = upZ / upLength;
+
+        T thrustScale = s.thrust / mass;
+        s.velX = s.velX + (s.forwardX * thrustScale) * dt;
+        s.velY = s.velY + (s.forwardY * thrustScale) * dt;
+        s.velZ = s.velZ + (s.forwardZ * thrustScale) * dt;
+        s.posX = s.posX + s.velX * dt;
+        s.posY = s.posY + s.velY * dt;
+        s.posZ = s.posZ + s.velZ * dt;
+
+        s.velX = s.velX * damping;
+        s.velY = s.velY * damping;
+        s.velZ = s.velZ * damping;
+        s.yawVel = s.yawVel * damping;
+    }
+}
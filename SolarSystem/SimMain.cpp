@@ -0,0 +1,363 @@
+#include "Ship.h"
+#include "ShipFleet.h"
+#include "LapTracker.h"
+#include "InputLog.h"
+#include "GeometryGenerator.h"
+#include "CollisionSDF.h"
+#include "CollisionBenchmarks.h"
+#include "ShipBenchmarks.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+// Headless lap simulation to tune the ship: no window, graphics or audio, the physics runs as fast as the cores allow.
+//   SolarSystemSim (--replay file.input | --script file.txt) [--loop] [--laps n] [--time seconds] [--rate hz]
+//                  [--mass list] [--damping list] [--thrust list] [--rotation list] [--collision quads|sdf]
+// Every combination of the comma separated lists is one run with its own ship, the ships are stepped in fleets
+// spread over all the cores. The ships collide with the quads like in the game, or with the distance fields
+// of the rails baked at start with --collision sdf.
+//   SolarSystemSim [--ray-benchmark] [--quad-benchmark] [--bvh-benchmark] [--sdf-test] [--kernel-test] [--tunnelling-test]
+//                  [--fleet-test] [--replay-test]
+// Runs the benchmarks and checks of the collision and the ship given instead, and exits with 1 when the check of any
+// of them fails.
+// The benchmarks of the renderer are in SolarSystemBench, this target only links the ship and the collision.
+
+namespace
+{
+    // same start as the ship of the game
+    const XMFLOAT3 startPosition(-2.5f, 0.0125f, 0.0f);
+    const float shipRadius = 0.04f;
+    // enough ships to fill the lanes of a fleet, few enough to keep every core busy on small sweeps
+    const size_t runsPerFleet = 16;
+
+    struct SimRun
+    {
+        mc::ShipTuning tuning;
+        unsigned int lapCount{ 0 };
+        double bestLapTime{ 0.0 };
+        double totalLapTime{ 0.0 };
+        double simulatedTime{ 0.0 };
+    };
+
+    struct Benchmark
+    {
+        const char* option;
+        // false when the check of the benchmark failed
+        bool (*run)(const mc::TrackSpline& track, mc::CollisionData* collisionDataArray[], unsigned int collisionDataCount,
+            float radius);
+    };
+
+    const Benchmark benchmarks[] = {
+        { "--ray-benchmark", mc::CollisionBenchmarks::Rays },
+        { "--quad-benchmark", mc::CollisionBenchmarks::QuadBasis },
+        { "--bvh-benchmark", mc::CollisionBenchmarks::BVHScaling },
+        { "--sdf-test", mc::CollisionBenchmarks::DistanceField },
+        { "--kernel-test", mc::CollisionBenchmarks::KernelParity },
+        { "--tunnelling-test", mc::CollisionBenchmarks::Tunnelling },
+        { "--fleet-test", mc::ShipBenchmarks::FleetParity },
+        { "--replay-test", mc::ShipBenchmarks::ReplayParity }
+    };
+
+    std::vector<float> ParseList(const std::string& option, const std::string& list)
+    {
+        std::vector<float> values;
+        std::istringstream stream(list);
+        std::string value;
+        while (std::getline(stream, value, ','))
+        {
+            try
+            {
+                values.push_back(std::stof(value));
+            }
+            catch (std::exception&)
+            {
+                throw std::runtime_error("Error invalid value for " + option + ": " + value);
+            }
+        }
+        if (values.empty())
+        {
+            throw std::runtime_error("Error empty list for " + option);
+        }
+        return values;
+    }
+
+    // Runs a slice of the runs as one ShipFleet, every ship with the tuning of its run and the same inputs.
+    // A ship that finished its laps keeps moving with the fleet but its run is not updated any more.
+    void Simulate(SimRun* runs, size_t runCount, const mc::InputLog& inputs, bool loop, unsigned int laps, double maxTime,
+        mc::Ship::CollisionMode collisionMode, const mc::TrackSpline& track, mc::CollisionData* collisionDataArray[],
+        unsigned int collisionDataCount)
+    {
+        mc::ShipFleet fleet(runs[0].tuning.mass, shipRadius);
+        fleet.SetCollisionMode(collisionMode);
+        std::vector<mc::LapTracker> lapTrackers;
+        lapTrackers.reserve(runCount);
+        for (size_t i = 0; i < runCount; i++)
+        {
+            fleet.SetTuning(fleet.AddShip(startPosition), runs[i].tuning);
+            lapTrackers.emplace_back(track);
+        }
+        mc::InputLog runInputs = inputs;
+        std::vector<mc::ShipInput> shipInputs(runCount);
+
+        // the same step as the game so a recorded run is repeated bit for bit, when it collides with the quads
+        const double step = 1.0 / inputs.GetStepRate();
+        const float dt = static_cast<float>(step);
+        const unsigned long long maxSteps = static_cast<unsigned long long>(maxTime * inputs.GetStepRate());
+        unsigned long long steps = 0;
+        size_t running = runCount;
+        for (; steps < maxSteps && running > 0; steps++)
+        {
+            mc::ShipInput input;
+            if (!runInputs.Next(input))
+            {
+                if (!loop || runInputs.GetStepCount() == 0)
+                {
+                    break;
+                }
+                runInputs.Rewind();
+                runInputs.Next(input);
+            }
+            std::fill(shipInputs.begin(), shipInputs.end(), input);
+            fleet.Update(shipInputs.data(), dt, collisionDataArray, collisionDataCount);
+            for (size_t i = 0; i < runCount; i++)
+            {
+                if (lapTrackers[i].GetLapCount() >= laps)
+                {
+                    continue;
+                }
+                SimRun& run = runs[i];
+                if (lapTrackers[i].Update(fleet.GetPosition(static_cast<unsigned int>(i)), dt) == mc::LapTracker::Event::LapCompleted)
+                {
+                    run.totalLapTime += lapTrackers[i].GetLastLapTime();
+                }
+                if (lapTrackers[i].GetLapCount() >= laps)
+                {
+                    run.simulatedTime = (steps + 1) * step;
+                    --running;
+                }
+            }
+        }
+        for (size_t i = 0; i < runCount; i++)
+        {
+            runs[i].lapCount = lapTrackers[i].GetLapCount();
+            runs[i].bestLapTime = lapTrackers[i].GetBestLapTime();
+            if (runs[i].lapCount < laps)
+            {
+                runs[i].simulatedTime = steps * step;
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        std::string replayPath;
+        std::string scriptPath;
+        bool loop = false;
+        std::vector<const Benchmark*> selected;
+        unsigned int laps = 3;
+        double maxTime = 300.0;
+        unsigned int stepRate = 120;
+        mc::Ship::CollisionMode collisionMode = mc::Ship::CollisionMode::Quads;
+        mc::ShipTuning defaultTuning;
+        defaultTuning.mass = 2.0f;
+        std::vector<float> masses = { defaultTuning.mass };
+        std::vector<float> dampings = { defaultTuning.damping };
+        std::vector<float> thrusts = { defaultTuning.thrustMax };
+        std::vector<float> rotations = { defaultTuning.rotationSpeed };
+
+        for (int i = 1; i < argc; i++)
+        {
+            std::string option(argv[i]);
+            if (option == "--loop")
+            {
+                loop = true;
+                continue;
+            }
+            const Benchmark* found = nullptr;
+            for (const Benchmark& benchmark : benchmarks)
+            {
+                if (option == benchmark.option)
+                {
+                    found = &benchmark;
+                }
+            }
+            if (found)
+            {
+                selected.push_back(found);
+                continue;
+            }
+            if (i + 1 >= argc)
+            {
+                throw std::runtime_error("Error missing value for " + option);
+            }
+            std::string value(argv[++i]);
+            if (option == "--replay")
+            {
+                replayPath = value;
+            }
+            else if (option == "--script")
+            {
+                scriptPath = value;
+            }
+            else if (option == "--laps")
+            {
+                laps = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (option == "--time")
+            {
+                maxTime = std::stod(value);
+            }
+            else if (option == "--rate")
+            {
+                stepRate = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (option == "--mass")
+            {
+                masses = ParseList(option, value);
+            }
+            else if (option == "--damping")
+            {
+                dampings = ParseList(option, value);
+            }
+            else if (option == "--thrust")
+            {
+                thrusts = ParseList(option, value);
+            }
+            else if (option == "--rotation")
+            {
+                rotations = ParseList(option, value);
+            }
+            else if (option == "--collision")
+            {
+                if (value != "quads" && value != "sdf")
+                {
+                    throw std::runtime_error("Error invalid value for " + option + ": " + value);
+                }
+                collisionMode = value == "sdf" ? mc::Ship::CollisionMode::DistanceField : mc::Ship::CollisionMode::Quads;
+            }
+            else
+            {
+                throw std::runtime_error("Error unknown option: " + option);
+            }
+        }
+        if (selected.empty() && replayPath.empty() == scriptPath.empty())
+        {
+            throw std::runtime_error("Error give one of --replay file.input or --script file.txt");
+        }
+
+        mc::CollisionData collisionDataOuter;
+        mc::CollisionData collisionDataInner;
+        mc::GeometryGenerator::LoadCollisionDataFromOBJFile(collisionDataOuter, "assets/mesh/track_outer_col.obj");
+        mc::GeometryGenerator::LoadCollisionDataFromOBJFile(collisionDataInner, "assets/mesh/track_inner_col.obj");
+        mc::CollisionData* collisionDataArray[] = { &collisionDataOuter, &collisionDataInner };
+        // The checks of the collision also test the distance field mode. The ship radius is two voxels,
+        // the band covers the radius plus more than a frame of travel.
+        if (collisionMode == mc::Ship::CollisionMode::DistanceField || !selected.empty())
+        {
+            for (mc::CollisionData* collisionData : collisionDataArray)
+            {
+                mc::CollisionSDF::Bake(*collisionData, 0.02f, 0.1f);
+            }
+        }
+        // same finish line as the game
+        mc::TrackSpline track;
+        track.Bake(collisionDataInner, collisionDataOuter,
+            XMVectorSet(0.0f, 0.0f, 1.6f, 0.0f), XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), 8);
+        if (!selected.empty())
+        {
+            std::vector<const char*> failed;
+            for (const Benchmark* benchmark : selected)
+            {
+                std::cout << benchmark->option + 2 << ":\n";
+                if (!benchmark->run(track, collisionDataArray, 2, shipRadius))
+                {
+                    failed.push_back(benchmark->option + 2);
+                }
+            }
+            for (const char* name : failed)
+            {
+                std::cout << "FAILED " << name << "\n";
+            }
+            return failed.empty() ? 0 : 1;
+        }
+        mc::InputLog inputs = replayPath.empty() ? mc::InputLog::LoadScript(scriptPath, stepRate) : mc::InputLog(replayPath);
+
+        // one run per combination of the tuning lists
+        std::vector<SimRun> runs;
+        for (float mass : masses)
+        {
+            for (float damping : dampings)
+            {
+                for (float thrust : thrusts)
+                {
+                    for (float rotation : rotations)
+                    {
+                        SimRun run;
+                        run.tuning.mass = mass;
+                        run.tuning.damping = damping;
+                        run.tuning.thrustMax = thrust;
+                        run.tuning.rotationSpeed = rotation;
+                        runs.push_back(run);
+                    }
+                }
+            }
+        }
+
+        // the runs are split in fleets spread over the cores, the collision of a fleet then runs on the thread of its job
+        mc::ThreadPool& threadPool = mc::ThreadPool::Get();
+        size_t fleetCount = (runs.size() + runsPerFleet - 1) / runsPerFleet;
+        std::cout << "Simulating " << runs.size() << " runs of " << laps << " laps in " << fleetCount << " fleets on "
+            << threadPool.GetThreadCount() << " threads\n";
+        auto start = std::chrono::steady_clock::now();
+        threadPool.ParallelFor(fleetCount, [&](size_t i)
+        {
+            size_t first = i * runsPerFleet;
+            size_t count = std::min(runsPerFleet, runs.size() - first);
+            Simulate(&runs[first], count, inputs, loop, laps, maxTime, collisionMode, track, collisionDataArray, 2);
+        });
+        double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double simulatedTime = 0.0;
+        unsigned long long lapCount = 0;
+        const SimRun* bestRun = nullptr;
+        for (const SimRun& run : runs)
+        {
+            std::cout << "mass " << run.tuning.mass << " damping " << run.tuning.damping
+                << " thrust " << run.tuning.thrustMax << " rotation " << run.tuning.rotationSpeed << ": ";
+            if (run.lapCount > 0)
+            {
+                std::cout << run.lapCount << " laps best " << run.bestLapTime << " mean " << run.totalLapTime / run.lapCount << "\n";
+                if (!bestRun || run.bestLapTime < bestRun->bestLapTime)
+                {
+                    bestRun = &run;
+                }
+            }
+            else
+            {
+                std::cout << "no lap in " << run.simulatedTime << " s\n";
+            }
+            simulatedTime += run.simulatedTime;
+            lapCount += run.lapCount;
+        }
+        if (bestRun)
+        {
+            std::cout << "Best lap " << bestRun->bestLapTime << ": mass " << bestRun->tuning.mass << " damping " << bestRun->tuning.damping
+                << " thrust " << bestRun->tuning.thrustMax << " rotation " << bestRun->tuning.rotationSpeed << "\n";
+        }
+        std::cout << lapCount << " laps, " << simulatedTime << " simulated s in " << wallTime << " wall s: "
+            << simulatedTime / wallTime << " simulated s per wall s\n";
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -78,7 +78,7 @@ namespace mc
 
         unsigned int stride = sizeof(Vertex);
         unsigned int offset = 0;
-        GetDeviceContext(gm)->IASetVertexBuffers(0, 1, vertexBuffer_.GetAddressOf(), &stride, &offset);
+        GetStateCache(gm).SetVertexBuffer(0, vertexBuffer_.Get(), stride, offset);
         GetDeviceContext(gm)->Draw(used_ * 6, 0);
         texture_.Unbind(gm, 0);
 
@@ -58,12 +58,11 @@ namespace mc
 
     void Texture::Bind(const GraphicsManager& gm, int slot)
     {
-        GetDeviceContext(gm)->PSSetShaderResources(slot, 1, shaderResourceView_.GetAddressOf());
+        GetStateCache(gm).SetShaderResource(ShaderStage::Pixel, slot, shaderResourceView_.Get());
     }
 
     void Texture::Unbind(const GraphicsManager& gm, int slot)
     {
-        ID3D11ShaderResourceView* null[] = { nullptr };
-        GetDeviceContext(gm)->PSSetShaderResources(slot, 1, null);
+        GetStateCache(gm).SetShaderResource(ShaderStage::Pixel, slot, nullptr);
     }
 }
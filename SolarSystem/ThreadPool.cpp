@@ -0,0 +1,129 @@
+#include "ThreadPool.h"
+
+namespace mc
+{
+    namespace
+    {
+        thread_local bool insideJob = false;
+    }
+
+    ThreadPool::ThreadPool(unsigned int workerCount)
+    {
+        workers_.reserve(workerCount);
+        for (unsigned int i = 0; i < workerCount; i++)
+        {
+            workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            quit_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& job)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        if (workers_.empty() || count == 1 || insideJob)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                job(i);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> dispatch(dispatchMutex_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &job;
+            count_ = count;
+            next_ = 0;
+            busy_ = static_cast<unsigned int>(workers_.size());
+            exception_ = nullptr;
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        RunJobs();
+
+        std::exception_ptr exception;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [this] { return busy_ == 0; });
+            job_ = nullptr;
+            exception = exception_;
+        }
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    ThreadPool& ThreadPool::Get()
+    {
+        static ThreadPool threadPool;
+        return threadPool;
+    }
+
+// PRIVATES:
+    void ThreadPool::WorkerLoop()
+    {
+        unsigned long long seenGeneration = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return quit_ || generation_ != seenGeneration; });
+                if (quit_)
+                {
+                    return;
+                }
+                seenGeneration = generation_;
+            }
+
+            RunJobs();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--busy_ == 0)
+                {
+                    done_.notify_one();
+                }
+            }
+        }
+    }
+
+    void ThreadPool::RunJobs()
+    {
+        insideJob = true;
+        size_t i;
+        while ((i = next_.fetch_add(1)) < count_)
+        {
+            try
+            {
+                (*job_)(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!exception_)
+                {
+                    exception_ = std::current_exception();
+                }
+            }
+        }
+        insideJob = false;
+    }
+}
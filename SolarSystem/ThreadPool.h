@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <algorithm>
+
+namespace mc
+{
+    class ThreadPool
+    {
+    public:
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // the thread that calls ParallelFor also runs jobs, so by default we create one worker less than cores
+        ThreadPool(unsigned int workerCount = std::max(std::thread::hardware_concurrency(), 1u) - 1);
+        ~ThreadPool();
+
+        // Calls job(i) for every i in [0, count) across the workers and waits until all of them are done.
+        // Calls made from inside a job run serially on the calling thread.
+        void ParallelFor(size_t count, const std::function<void(size_t)>& job);
+        unsigned int GetThreadCount() const { return static_cast<unsigned int>(workers_.size()) + 1; }
+
+        static ThreadPool& Get();
+
+    private:
+        void WorkerLoop();
+        void RunJobs();
+
+        std::vector<std::thread> workers_;
+        std::mutex dispatchMutex_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+
+        const std::function<void(size_t)>* job_{ nullptr };
+        size_t count_{ 0 };
+        std::atomic<size_t> next_{ 0 };
+        unsigned int busy_{ 0 };
+        unsigned long long generation_{ 0 };
+        bool quit_{ false };
+        std::exception_ptr exception_;
+    };
+}
@@ -0,0 +1,237 @@
+#include "TrackSpline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <stdexcept>
+
+namespace mc
+{
+    namespace
+    {
+        // Middle of the bottom edge of every quad of a rail, in the order they follow each other along the rail.
+        // The quads are not stored in order, so from the end of each quad we go to the closest start of the rest.
+        std::vector<XMVECTOR> ChainRail(const CollisionData& rail)
+        {
+            size_t quadCount = rail.bases.size();
+            std::vector<XMVECTOR> chain;
+            std::vector<bool> used(quadCount, false);
+            size_t current = 0;
+            for (size_t i = 0; i < quadCount; i++)
+            {
+                const CollisionQuadBasis& basis = rail.bases[current];
+                used[current] = true;
+                chain.push_back(basis.origin + basis.right * (basis.width * 0.5f));
+
+                XMVECTOR end = basis.origin + basis.right * basis.width;
+                float best = FLT_MAX;
+                for (size_t j = 0; j < quadCount; j++)
+                {
+                    float distanceSq = XMVectorGetX(XMVector3LengthSq(rail.bases[j].origin - end));
+                    if (!used[j] && distanceSq < best)
+                    {
+                        best = distanceSq;
+                        current = j;
+                    }
+                }
+            }
+            return chain;
+        }
+
+        XMVECTOR ClosestPointOnLoop(const std::vector<XMVECTOR>& loop, FXMVECTOR point)
+        {
+            XMVECTOR closest = loop[0];
+            float best = FLT_MAX;
+            for (size_t i = 0; i < loop.size(); i++)
+            {
+                XMVECTOR a = loop[i];
+                XMVECTOR ab = loop[(i + 1) % loop.size()] - a;
+                float lengthSq = XMVectorGetX(XMVector3LengthSq(ab));
+                float t = lengthSq > 0.0f ? std::clamp(XMVectorGetX(XMVector3Dot(point - a, ab)) / lengthSq, 0.0f, 1.0f) : 0.0f;
+                XMVECTOR candidate = a + ab * t;
+                float distanceSq = XMVectorGetX(XMVector3LengthSq(point - candidate));
+                if (distanceSq < best)
+                {
+                    best = distanceSq;
+                    closest = candidate;
+                }
+            }
+            return closest;
+        }
+    }
+
+// PUBLICS:
+    void TrackSpline::Bake(const CollisionData& innerRail, const CollisionData& outerRail,
+        FXMVECTOR finishLine, FXMVECTOR raceDirection, unsigned int subdivisions)
+    {
+        std::vector<XMVECTOR> inner = ChainRail(innerRail);
+        std::vector<XMVECTOR> outer = ChainRail(outerRail);
+        if (inner.size() < 3 || outer.size() < 3 || subdivisions == 0)
+        {
+            throw std::runtime_error("Error baking the track spline: the rails need at least three quads");
+        }
+
+        // the control points are halfway between the inner rail and the closest point of the outer rail
+        std::vector<XMVECTOR> controls;
+        float halfWidth = 0.0f;
+        for (XMVECTOR point : inner)
+        {
+            XMVECTOR across = ClosestPointOnLoop(outer, point);
+            controls.push_back((point + across) * 0.5f);
+            halfWidth = std::max(halfWidth, XMVectorGetX(XMVector3Length(across - point)) * 0.5f);
+        }
+        size_t controlCount = controls.size();
+
+        size_t finish = 0;
+        float best = FLT_MAX;
+        for (size_t i = 0; i < controlCount; i++)
+        {
+            float distanceSq = XMVectorGetX(XMVector3LengthSq(controls[i] - finishLine));
+            if (distanceSq < best)
+            {
+                best = distanceSq;
+                finish = i;
+            }
+        }
+        XMVECTOR tangent = controls[(finish + 1) % controlCount] - controls[(finish + controlCount - 1) % controlCount];
+        if (XMVectorGetX(XMVector3Dot(tangent, raceDirection)) < 0.0f)
+        {
+            std::reverse(controls.begin(), controls.end());
+        }
+
+        points_.clear();
+        for (size_t i = 0; i < controlCount; i++)
+        {
+            XMVECTOR p0 = controls[(i + controlCount - 1) % controlCount];
+            XMVECTOR p1 = controls[i];
+            XMVECTOR p2 = controls[(i + 1) % controlCount];
+            XMVECTOR p3 = controls[(i + 2) % controlCount];
+            for (unsigned int s = 0; s < subdivisions; s++)
+            {
+                XMFLOAT3 point;
+                XMStoreFloat3(&point, XMVectorCatmullRom(p0, p1, p2, p3, static_cast<float>(s) / subdivisions));
+                points_.push_back(point);
+            }
+        }
+
+        // the loop starts exactly where the finish line crosses it
+        float t;
+        float distanceSq;
+        unsigned int segment = FindClosestSegment(finishLine, t, distanceSq);
+        XMVECTOR a = XMLoadFloat3(&points_[segment]);
+        XMVECTOR b = XMLoadFloat3(&points_[(segment + 1) % points_.size()]);
+        XMFLOAT3 start;
+        XMStoreFloat3(&start, XMVectorLerp(a, b, t));
+        std::rotate(points_.begin(), points_.begin() + (segment + 1) % points_.size(), points_.end());
+        if (t > 0.0f && t < 1.0f)
+        {
+            points_.insert(points_.begin(), start);
+        }
+
+        distances_.assign(1, 0.0f);
+        for (size_t i = 0; i < points_.size(); i++)
+        {
+            XMVECTOR from = XMLoadFloat3(&points_[i]);
+            XMVECTOR to = XMLoadFloat3(&points_[(i + 1) % points_.size()]);
+            distances_.push_back(distances_.back() + XMVectorGetX(XMVector3Length(to - from)));
+        }
+        length_ = distances_.back();
+        searchRadius_ = halfWidth * 1.5f;
+    }
+
+    TrackLocation TrackSpline::Project(FXMVECTOR position, unsigned int segmentHint) const
+    {
+        float t;
+        float distanceSq;
+        unsigned int segment;
+        if (segmentHint < points_.size())
+        {
+            segment = WalkToClosestSegment(position, segmentHint, t, distanceSq);
+            if (distanceSq > searchRadius_ * searchRadius_)
+            {
+                segment = FindClosestSegment(position, t, distanceSq);
+            }
+        }
+        else
+        {
+            segment = FindClosestSegment(position, t, distanceSq);
+        }
+
+        TrackLocation location;
+        location.distance = distances_[segment] + (distances_[segment + 1] - distances_[segment]) * t;
+        if (location.distance >= length_)
+        {
+            location.distance -= length_;
+        }
+        location.offset = std::sqrt(distanceSq);
+        location.segment = segment;
+        return location;
+    }
+
+    XMVECTOR TrackSpline::GetPoint(float distance) const
+    {
+        distance = std::fmod(distance, length_);
+        if (distance < 0.0f)
+        {
+            distance += length_;
+        }
+        size_t segment = std::upper_bound(distances_.begin(), distances_.end(), distance) - distances_.begin() - 1;
+        segment = std::min(segment, points_.size() - 1);
+        float segmentLength = distances_[segment + 1] - distances_[segment];
+        float t = segmentLength > 0.0f ? (distance - distances_[segment]) / segmentLength : 0.0f;
+        return XMVectorLerp(XMLoadFloat3(&points_[segment]), XMLoadFloat3(&points_[(segment + 1) % points_.size()]), t);
+    }
+
+// PRIVATES:
+    float TrackSpline::SegmentDistanceSq(unsigned int segment, FXMVECTOR position, float& t) const
+    {
+        XMVECTOR a = XMLoadFloat3(&points_[segment]);
+        XMVECTOR ab = XMLoadFloat3(&points_[(segment + 1) % points_.size()]) - a;
+        float lengthSq = XMVectorGetX(XMVector3LengthSq(ab));
+        t = lengthSq > 0.0f ? std::clamp(XMVectorGetX(XMVector3Dot(position - a, ab)) / lengthSq, 0.0f, 1.0f) : 0.0f;
+        return XMVectorGetX(XMVector3LengthSq(position - (a + ab * t)));
+    }
+
+    unsigned int TrackSpline::FindClosestSegment(FXMVECTOR position, float& t, float& distanceSq) const
+    {
+        unsigned int closest = 0;
+        distanceSq = FLT_MAX;
+        for (unsigned int i = 0; i < points_.size(); i++)
+        {
+            float segmentT;
+            float segmentDistanceSq = SegmentDistanceSq(i, position, segmentT);
+            if (segmentDistanceSq < distanceSq)
+            {
+                distanceSq = segmentDistanceSq;
+                t = segmentT;
+                closest = i;
+            }
+        }
+        return closest;
+    }
+
+    unsigned int TrackSpline::WalkToClosestSegment(FXMVECTOR position, unsigned int start, float& t, float& distanceSq) const
+    {
+        // the distance only gets smaller, so the walk ends at the first segment closer than both neighbours
+        unsigned int count = static_cast<unsigned int>(points_.size());
+        unsigned int segment = start;
+        distanceSq = SegmentDistanceSq(segment, position, t);
+        for (unsigned int step : { 1u, count - 1 })
+        {
+            for (;;)
+            {
+                unsigned int next = (segment + step) % count;
+                float nextT;
+                float nextDistanceSq = SegmentDistanceSq(next, position, nextT);
+                if (nextDistanceSq >= distanceSq)
+                {
+                    break;
+                }
+                segment = next;
+                t = nextT;
+                distanceSq = nextDistanceSq;
+            }
+        }
+        return segment;
+    }
+}
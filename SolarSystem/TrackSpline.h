@@ -0,0 +1,56 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+
+#include <vector>
+
+namespace mc
+{
+    // Where a point is along the track
+    struct TrackLocation
+    {
+        // arc length from the finish line in the race direction, in [0, length)
+        float distance;
+        // distance from the centerline
+        float offset;
+        // segment of the centerline closest to the point, pass it back as the hint of the next query
+        unsigned int segment;
+    };
+
+    // Centerline of the track as a closed polyline, a Catmull-Rom spline through the middle of the two rails
+    // tessellated when the collision geometry is loaded, with the arc length at every vertex.
+    class TrackSpline
+    {
+    public:
+        static const unsigned int noSegment = ~0u;
+
+        // The rails are chained from their collision quads. The centerline starts at the point closest to
+        // finishLine and runs so that it goes along raceDirection there.
+        void Bake(const CollisionData& innerRail, const CollisionData& outerRail,
+            FXMVECTOR finishLine, FXMVECTOR raceDirection, unsigned int subdivisions);
+
+        // Projects the position on the centerline. The search walks from segmentHint to the closest segment,
+        // O(1) for a point that moved a little since the last query, and falls back to testing every segment
+        // when the hint is noSegment or the walk ends farther from the centerline than any part of the track.
+        TrackLocation Project(FXMVECTOR position, unsigned int segmentHint) const;
+        // Point of the centerline at the arc length, found by a binary search of the arc length table
+        XMVECTOR GetPoint(float distance) const;
+
+        float GetLength() const { return length_; }
+        size_t GetSegmentCount() const { return points_.size(); }
+
+    private:
+        // squared distance from the position to the segment, t is where the closest point is along it
+        float SegmentDistanceSq(unsigned int segment, FXMVECTOR position, float& t) const;
+        unsigned int FindClosestSegment(FXMVECTOR position, float& t, float& distanceSq) const;
+        unsigned int WalkToClosestSegment(FXMVECTOR position, unsigned int start, float& t, float& distanceSq) const;
+
+        // points_[i] to points_[i + 1] is segment i, the last one closes the loop back to points_[0]
+        std::vector<XMFLOAT3> points_;
+        // arc length at the start of every segment, one more entry with the length of the loop
+        std::vector<float> distances_;
+        float length_{ 0.0f };
+        // half the widest part of the track plus a margin, farther than this the walk did not find the track
+        float searchRadius_{ 0.0f };
+    };
+}
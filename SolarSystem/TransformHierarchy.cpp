@@ -0,0 +1,134 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mc
+{
+// PUBLICS:
+    unsigned int TransformHierarchy::Add(unsigned int parent)
+    {
+        unsigned int count = static_cast<unsigned int>(parents_.size());
+        unsigned int parentIndex = parent == noNode ? noNode : indices_[parent];
+        // after the last node of the subtree of the parent
+        unsigned int index = parent == noNode ? count : parentIndex + subtreeSizes_[parentIndex];
+        unsigned int handle = static_cast<unsigned int>(indices_.size());
+
+        handles_.insert(handles_.begin() + index, handle);
+        parents_.insert(parents_.begin() + index, parentIndex);
+        subtreeSizes_.insert(subtreeSizes_.begin() + index, 1);
+        positions_.insert(positions_.begin() + index, XMFLOAT3(0.0f, 0.0f, 0.0f));
+        rotations_.insert(rotations_.begin() + index, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+        scales_.insert(scales_.begin() + index, XMFLOAT3(1.0f, 1.0f, 1.0f));
+        worldPositions_.insert(worldPositions_.begin() + index, XMFLOAT3(0.0f, 0.0f, 0.0f));
+        worlds_.insert(worlds_.begin() + index, XMFLOAT4X4());
+        boundsCenters_.insert(boundsCenters_.begin() + index, XMFLOAT3(0.0f, 0.0f, 0.0f));
+        boundsRadii_.insert(boundsRadii_.begin() + index, -1.0f);
+        sphereX_.insert(sphereX_.begin() + index, 0.0f);
+        sphereY_.insert(sphereY_.begin() + index, 0.0f);
+        sphereZ_.insert(sphereZ_.begin() + index, 0.0f);
+        sphereRadius_.insert(sphereRadius_.begin() + index, -1.0f);
+        dirty_.insert(dirty_.begin() + index, 1);
+        indices_.push_back(index);
+
+        // the nodes after the new one moved one place
+        for (unsigned int i = index + 1; i <= count; i++)
+        {
+            indices_[handles_[i]] = i;
+            if (parents_[i] != noNode && parents_[i] >= index)
+            {
+                ++parents_[i];
+            }
+        }
+        for (unsigned int ancestor = parentIndex; ancestor != noNode; ancestor = parents_[ancestor])
+        {
+            ++subtreeSizes_[ancestor];
+        }
+        firstDirty_ = std::min(firstDirty_, index);
+        return handle;
+    }
+
+    void TransformHierarchy::SetPosition(unsigned int node, const XMFLOAT3& position)
+    {
+        unsigned int index = indices_[node];
+        positions_[index] = position;
+        MarkDirty(index);
+    }
+
+    void TransformHierarchy::SetRotation(unsigned int node, const XMFLOAT4& rotation)
+    {
+        unsigned int index = indices_[node];
+        rotations_[index] = rotation;
+        MarkDirty(index);
+    }
+
+    void TransformHierarchy::SetScale(unsigned int node, const XMFLOAT3& scale)
+    {
+        unsigned int index = indices_[node];
+        scales_[index] = scale;
+        MarkDirty(index);
+    }
+
+    unsigned int TransformHierarchy::GetParent(unsigned int node) const
+    {
+        unsigned int parentIndex = parents_[indices_[node]];
+        return parentIndex == noNode ? noNode : handles_[parentIndex];
+    }
+
+    void TransformHierarchy::SetBounds(unsigned int node, const XMFLOAT3& center, float radius)
+    {
+        unsigned int index = indices_[node];
+        boundsCenters_[index] = center;
+        boundsRadii_[index] = radius;
+        MarkDirty(index);
+    }
+
+    void TransformHierarchy::Update()
+    {
+        unsigned int count = static_cast<unsigned int>(parents_.size());
+        unsigned int index = firstDirty_;
+        while (index < count)
+        {
+            if (!dirty_[index])
+            {
+                ++index;
+                continue;
+            }
+            // the parents of the subtree are either clean or updated before their children
+            unsigned int end = index + subtreeSizes_[index];
+            for (unsigned int i = index; i < end; i++)
+            {
+                XMVECTOR position = XMLoadFloat3(&positions_[i]);
+                if (parents_[i] != noNode)
+                {
+                    position += XMLoadFloat3(&worldPositions_[parents_[i]]);
+                }
+                XMStoreFloat3(&worldPositions_[i], position);
+                XMMATRIX trans = XMMatrixTranslationFromVector(position);
+                XMMATRIX rot = XMMatrixRotationQuaternion(XMLoadFloat4(&rotations_[i]));
+                XMMATRIX scale = XMMatrixScalingFromVector(XMLoadFloat3(&scales_[i]));
+                XMMATRIX world = scale * rot * trans;
+                XMStoreFloat4x4(&worlds_[i], world);
+
+                // the radius grows with the largest axis scale so the sphere stays conservative
+                XMVECTOR center = XMVector3Transform(XMLoadFloat3(&boundsCenters_[i]), world);
+                const XMFLOAT3& axisScale = scales_[i];
+                float maxScale = std::max(std::fabs(axisScale.x), std::max(std::fabs(axisScale.y), std::fabs(axisScale.z)));
+                sphereX_[i] = XMVectorGetX(center);
+                sphereY_[i] = XMVectorGetY(center);
+                sphereZ_[i] = XMVectorGetZ(center);
+                sphereRadius_[i] = boundsRadii_[i] < 0.0f ? -1.0f : boundsRadii_[i] * maxScale;
+                dirty_[i] = 0;
+            }
+            index = end;
+        }
+        firstDirty_ = count;
+    }
+
+// PRIVATES:
+    void TransformHierarchy::MarkDirty(unsigned int index)
+    {
+        dirty_[index] = 1;
+        firstDirty_ = std::min(firstDirty_, index);
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace mc
+{
+    // Transforms of a tree of nodes in flat arrays. The nodes are stored in depth first order, so a parent is always
+    // before its children and a subtree is the range [index, index + subtree size). A node only inherits the position
+    // of its parents: its world matrix is scale * rotation * translation(position + world position of the parent).
+    // The world matrices are cached and Update recomputes only the subtrees of the nodes changed since the last call,
+    // along with a world bounding sphere per node for culling.
+    //
+    // Nodes are named by a handle that does not change when nodes are added, the index of a node in the arrays does.
+    class TransformHierarchy
+    {
+    public:
+        static const unsigned int noNode = ~0u;
+
+        // Adds a node as the last child of parent, or as the last root for noNode, and returns its handle.
+        // Adding under a node of the last branch of the tree appends to the arrays, anywhere else moves the
+        // nodes after it.
+        unsigned int Add(unsigned int parent);
+
+        void SetPosition(unsigned int node, const XMFLOAT3& position);
+        void SetRotation(unsigned int node, const XMFLOAT4& rotation);
+        void SetScale(unsigned int node, const XMFLOAT3& scale);
+        const XMFLOAT3& GetPosition(unsigned int node) const { return positions_[indices_[node]]; }
+        const XMFLOAT4& GetRotation(unsigned int node) const { return rotations_[indices_[node]]; }
+        const XMFLOAT3& GetScale(unsigned int node) const { return scales_[indices_[node]]; }
+        unsigned int GetParent(unsigned int node) const;
+        // bounding sphere of what the node draws in its own space, a negative radius when it draws nothing
+        void SetBounds(unsigned int node, const XMFLOAT3& center, float radius);
+
+        // Recomputes the world transforms of the dirty subtrees in one pass over the arrays
+        void Update();
+        // only valid after Update
+        const XMFLOAT3& GetWorldPosition(unsigned int node) const { return worldPositions_[indices_[node]]; }
+        const XMFLOAT4X4& GetWorld(unsigned int node) const { return worlds_[indices_[node]]; }
+
+        // the nodes in depth first order
+        size_t GetCount() const { return parents_.size(); }
+        unsigned int GetNodeAt(size_t index) const { return handles_[index]; }
+        const XMFLOAT4X4& GetWorldAt(size_t index) const { return worlds_[index]; }
+        // index of the parent of the node at index, or noNode
+        unsigned int GetParentAt(size_t index) const { return parents_[index]; }
+        // world bounding spheres of the nodes in depth first order, in structure of arrays form
+        const float* GetSphereX() const { return sphereX_.data(); }
+        const float* GetSphereY() const { return sphereY_.data(); }
+        const float* GetSphereZ() const { return sphereZ_.data(); }
+        const float* GetSphereRadius() const { return sphereRadius_.data(); }
+
+    private:
+        void MarkDirty(unsigned int index);
+
+        // by handle
+        std::vector<unsigned int> indices_;
+
+        // by index
+        std::vector<unsigned int> handles_;
+        std::vector<unsigned int> parents_;
+        std::vector<unsigned int> subtreeSizes_;
+        std::vector<XMFLOAT3> positions_;
+        std::vector<XMFLOAT4> rotations_;
+        std::vector<XMFLOAT3> scales_;
+        std::vector<XMFLOAT3> worldPositions_;
+        std::vector<XMFLOAT4X4> worlds_;
+        std::vector<XMFLOAT3> boundsCenters_;
+        std::vector<float> boundsRadii_;
+        std::vector<float> sphereX_;
+        std::vector<float> sphereY_;
+        std::vector<float> sphereZ_;
+        std::vector<float> sphereRadius_;
+        // the subtree of the node needs its world transforms recomputed
+        std::vector<unsigned char> dirty_;
+        // no node before this one is dirty
+        unsigned int firstDirty_{ 0 };
+    };
+}
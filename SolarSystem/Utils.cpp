@@ -1,5 +1,6 @@
 #include "Utils.h"
 #include <fstream>
+#include <windows.h>
 
 namespace mc
 {
@@ -29,6 +30,62 @@ namespace mc
         delete[] data;
     }
 
+    MappedFile::MappedFile(const std::string& filepath)
+        : data{ nullptr }, size{ 0 }, file_{ INVALID_HANDLE_VALUE }, mapping_{ nullptr }
+    {
+        file_ = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Error reading file: " + filepath);
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file_, &fileSize))
+        {
+            CloseHandle(file_);
+            throw std::runtime_error("Error reading file size: " + filepath);
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+
+        // empty files can not be mapped
+        if (size == 0)
+        {
+            return;
+        }
+
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_)
+        {
+            data = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (!data)
+        {
+            if (mapping_)
+            {
+                CloseHandle(mapping_);
+            }
+            CloseHandle(file_);
+            throw std::runtime_error("Error mapping file: " + filepath);
+        }
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (data)
+        {
+            UnmapViewOfFile(data);
+        }
+        if (mapping_)
+        {
+            CloseHandle(mapping_);
+        }
+        if (file_ != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file_);
+        }
+    }
+
     float Utils::RandF()
     {
         return (float)(rand()) / (float)RAND_MAX;
@@ -73,4 +130,54 @@ namespace mc
         return Lerp(outMin, outMax, t);
 
     }
+
+    XMVECTOR Utils::ClosestPointOnTriangle(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c)
+    {
+        XMVECTOR ab = b - a;
+        XMVECTOR ac = c - a;
+        XMVECTOR ap = p - a;
+        float d1 = XMVectorGetX(XMVector3Dot(ab, ap));
+        float d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+        if (d1 <= 0.0f && d2 <= 0.0f)
+        {
+            return a;
+        }
+
+        XMVECTOR bp = p - b;
+        float d3 = XMVectorGetX(XMVector3Dot(ab, bp));
+        float d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+        if (d3 >= 0.0f && d4 <= d3)
+        {
+            return b;
+        }
+
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        {
+            return a + ab * (d1 / (d1 - d3));
+        }
+
+        XMVECTOR cp = p - c;
+        float d5 = XMVectorGetX(XMVector3Dot(ab, cp));
+        float d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+        if (d6 >= 0.0f && d5 <= d6)
+        {
+            return c;
+        }
+
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        {
+            return a + ac * (d2 / (d2 - d6));
+        }
+
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        {
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+
+        float denominator = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denominator) + ac * (vc * denominator);
+    }
 }
\ No newline at end of file
@@ -17,6 +17,22 @@ namespace mc
         size_t size;
     };
 
+    // Read only view of a whole file mapped in memory. The data is not null terminated.
+    class MappedFile
+    {
+    public:
+        MappedFile(const std::string& filepath);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* data;
+        size_t size;
+    private:
+        void* file_;
+        void* mapping_;
+    };
+
     class Utils
     {
     public:
@@ -26,5 +42,7 @@ namespace mc
         static float Lerp(float a, float b, float t);
         static float InverseLerp(float a, float b, float v);
         static float Remap(float v, float inMin, float inMax, float outMin, float outMax);
+        // Real-Time Collision Detection, 5.1.5
+        static XMVECTOR ClosestPointOnTriangle(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c);
     };
 }
\ No newline at end of file
@@ -3,7 +3,7 @@
 
 namespace mc
 {
-    VertexBuffer::VertexBuffer(const GraphicsManager& gm, void* vertices, unsigned int count, unsigned int stride)
+    VertexBuffer::VertexBuffer(const GraphicsManager& gm, const void* vertices, unsigned int count, unsigned int stride)
         : verticesCount(count), stride(stride), offset(0)
     {
         D3D11_BUFFER_DESC vertexDesc;
@@ -23,6 +23,6 @@ namespace mc
 
     void VertexBuffer::Bind(const GraphicsManager& gm)
     {
-        GetDeviceContext(gm)->IASetVertexBuffers(0, 1, buffer.GetAddressOf(), &stride, &offset);
+        GetStateCache(gm).SetVertexBuffer(0, buffer.Get(), stride, offset);
     }
 }
\ No newline at end of file
@@ -10,7 +10,7 @@ namespace mc
         VertexBuffer(const VertexBuffer&) = delete;
         VertexBuffer& operator=(const VertexBuffer&) = delete;
 
-        VertexBuffer(const GraphicsManager& gm, void *vertices, unsigned int count, unsigned int stride);
+        VertexBuffer(const GraphicsManager& gm, const void *vertices, unsigned int count, unsigned int stride);
         void Bind(const GraphicsManager& gm);
     private:
         Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
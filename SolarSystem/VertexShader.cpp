@@ -51,6 +51,6 @@ namespace mc
 
     void VertexShader::Bind(const GraphicsManager& gm)
     {
-        GetDeviceContext(gm)->VSSetShader(shader_.Get(), 0, 0);
+        GetStateCache(gm).SetVertexShader(shader_.Get());
     }
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+cbuffer Object : register(b0) 
+{
+    matrix model;
+    float4 positionScale;
+    float4 positionOffset;
+};
+
+cbuffer Camera : register(b1)
+{
+    matrix view;
+    matrix proj;
+    float3 viewPos;
+    float pad;
+};
+
+// mc::PackedVertex, the formats of the input layout already convert to float
+struct VS_Input {
+    float4 pos : POSITION; // R16G16B16A16_UNORM
+    float2 nor : NORMAL;   // R16G16_SNORM octahedral
+    float2 tan : TEXCOORD0;// R16G16_SNORM octahedral
+    float2 uv  : TEXCOORD1;// R16G16_FLOAT
+};
+
+struct PS_Input {
+    float4 pos : SV_POSITION;
+    float3 nor : NORMAL;
+    float2 uv : TEXCOORD0;
+    float3 viewDir : TEXCOORD1;
+    float3 fragPos : TEXCOORD2;
+};
+
+float3 OctDecode(float2 e)
+{
+    float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+PS_Input vs_main(VS_Input i) {
+    PS_Input o = (PS_Input)0;
+    
+    float3 pos = i.pos.xyz * positionScale.xyz + positionOffset.xyz;
+    float4 wPos = mul(model, float4(pos, 1.0f));
+    float3 fragPos = float3(wPos.xyz);
+    wPos = mul(view, wPos);
+    wPos = mul(proj, wPos);
+    
+    float3 wNor = mul((float3x3) model, OctDecode(i.nor));
+    wNor = normalize(wNor);
+    
+    o.pos = wPos;
+    o.nor = wNor;
+    o.uv = i.uv;
+    o.viewDir = fragPos - viewPos;
+    o.fragPos = fragPos;
+    
+    return o;
+}
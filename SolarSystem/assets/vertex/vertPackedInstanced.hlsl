@@ -0,0 +1,58 @@
+cbuffer Camera : register(b1)
+{
+    matrix view;
+    matrix proj;
+    float3 viewPos;
+    float pad;
+};
+
+// mc::PackedVertex from slot 0 and mc::ObjectInstance from slot 1, the formats of the input layout already convert to float
+struct VS_Input {
+    float4 pos : POSITION; // R16G16B16A16_UNORM
+    float2 nor : NORMAL;   // R16G16_SNORM octahedral
+    float2 tan : TEXCOORD0;// R16G16_SNORM octahedral
+    float2 uv  : TEXCOORD1;// R16G16_FLOAT
+    float4 model0 : MODEL0; // first three rows of the transposed model matrix
+    float4 model1 : MODEL1;
+    float4 model2 : MODEL2;
+    float4 positionScale : POSITIONSCALE;
+    float4 positionOffset : POSITIONOFFSET;
+};
+
+struct PS_Input {
+    float4 pos : SV_POSITION;
+    float3 nor : NORMAL;
+    float2 uv : TEXCOORD0;
+    float3 viewDir : TEXCOORD1;
+    float3 fragPos : TEXCOORD2;
+};
+
+float3 OctDecode(float2 e)
+{
+    float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+PS_Input vs_main(VS_Input i) {
+    PS_Input o = (PS_Input)0;
+    
+    float4 pos = float4(i.pos.xyz * i.positionScale.xyz + i.positionOffset.xyz, 1.0f);
+    float3 fragPos = float3(dot(i.model0, pos), dot(i.model1, pos), dot(i.model2, pos));
+    float4 wPos = mul(view, float4(fragPos, 1.0f));
+    wPos = mul(proj, wPos);
+    
+    float3 nor = OctDecode(i.nor);
+    float3 wNor = float3(dot(i.model0.xyz, nor), dot(i.model1.xyz, nor), dot(i.model2.xyz, nor));
+    wNor = normalize(wNor);
+    
+    o.pos = wPos;
+    o.nor = wNor;
+    o.uv = i.uv;
+    o.viewDir = fragPos - viewPos;
+    o.fragPos = fragPos;
+    
+    return o;
+}